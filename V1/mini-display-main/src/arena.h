@@ -0,0 +1,153 @@
+// per-task bump arenas
+//
+// fetching the weather allocates the HTTP payload and then a cJSON node for every value in
+// it, a few dozen small blocks that get freed in whatever order the tree is torn down. that
+// happens every minute from loop() and whenever the settings page changes the city, from the
+// web server's task, and over weeks it leaves the heap in pieces.
+//
+// instead, each task that opens an arenascope gets an arena of its own (bound on first use, up
+// to ARENA_TASKS of them, so no locking between tasks). inside a scope arenaAlloc() just moves
+// a pointer forward, arenaFree() of an arena block does nothing, and when the scope closes,
+// at the end of the handler once its response is done, the whole arena goes back to where it
+// was. cJSON is hooked up to it, so a JSONVar that lives inside a scope lives in the arena.
+// a request that doesn't fit, or an allocation outside any scope, goes to the heap as before.
+//
+// the buffer itself is one heap block, taken when the task's outermost scope opens and given
+// back when it closes, so between fetches the arenas hold no RAM. sim_arena found no less
+// fragmentation with two buffers kept for good, only 7 KB less heap, so they aren't.
+// if the heap can't spare the block the scope runs on the heap, counted as fallbacks.
+//
+// each arena keeps its high-water mark and how often it had to fall back, GET /arena.
+
+#include <ESPAsyncWebServer.h>
+#include "cjson/cJSON.h"
+
+#define ARENA_TASKS 2   // loop() and the web server
+#define ARENA_SIZE 3584 // bytes per scope, the measured high-water mark (2660 B) plus a third
+#define ARENA_ALIGN 8
+
+typedef struct
+{
+  TaskHandle_t task; // NULL while the slot is free
+  const char *name;
+  size_t used, high;
+  uint8_t depth;      // open scopes
+  uint32_t scopes;    // scopes opened
+  uint32_t fallbacks; // allocations that went to the heap
+  size_t fallbackBytes;
+  uint8_t *buf;        // from the heap while a scope is open, else NULL
+} arena;
+
+arena arenas[ARENA_TASKS];
+portMUX_TYPE arenaMux = portMUX_INITIALIZER_UNLOCKED;
+
+// the calling task's arena, bound to a free slot the first time. NULL when there's none left
+arena *arenaMine()
+{
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < ARENA_TASKS; i++)
+    if (arenas[i].task == me)
+      return &arenas[i];
+
+  arena *a = NULL;
+  portENTER_CRITICAL(&arenaMux);
+  for (int i = 0; i < ARENA_TASKS && !a; i++)
+    if (!arenas[i].task)
+    {
+      a = &arenas[i];
+      a->task = me;
+    }
+  portEXIT_CRITICAL(&arenaMux);
+  if (a)
+    a->name = pcTaskGetName(me);
+  return a;
+}
+
+void *arenaAlloc(size_t n)
+{
+  arena *a = arenaMine();
+  if (a && a->depth)
+  {
+    if (a->buf)
+    {
+      // the heap only promises 4, so it's the address that gets aligned, not the offset
+      uintptr_t end = ((uintptr_t)a->buf + a->used + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+      size_t at = end - (uintptr_t)a->buf;
+      if (at + n <= ARENA_SIZE)
+      {
+        a->used = at + n;
+        if (a->used > a->high)
+          a->high = a->used;
+        return a->buf + at;
+      }
+    }
+    a->fallbacks++;
+    a->fallbackBytes += n;
+  }
+  return malloc(n);
+}
+
+void arenaFree(void *p)
+{
+  for (int i = 0; i < ARENA_TASKS; i++)
+  {
+    uint8_t *buf = arenas[i].buf;
+    if (buf && (uint8_t *)p >= buf && (uint8_t *)p < buf + ARENA_SIZE)
+      return; // goes with its scope
+  }
+  free(p);
+}
+
+// everything allocated from the calling task's arena while this is alive is released with it.
+// declare it before the objects that use the arena, so they're gone first
+struct arenascope
+{
+  arena *a;
+  size_t mark;
+
+  arenascope() : a(arenaMine()), mark(a ? a->used : 0)
+  {
+    if (a)
+    {
+      if (!a->depth++)
+        a->buf = (uint8_t *)malloc(ARENA_SIZE);
+      a->scopes++;
+    }
+  }
+  ~arenascope()
+  {
+    if (a)
+    {
+      a->used = mark;
+      if (!--a->depth)
+      {
+        free(a->buf);
+        a->buf = NULL;
+      }
+    }
+  }
+};
+
+// GET /arena: [{"task","size","used","high","scopes","fallbacks","fallbackBytes"},..]
+void handleArena(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->print("[");
+  for (int i = 0, n = 0; i < ARENA_TASKS; i++)
+  {
+    const arena &a = arenas[i];
+    if (!a.task)
+      continue;
+    response->printf("%s{\"task\":\"%s\",\"size\":%u,\"used\":%u,\"high\":%u,\"scopes\":%lu,\"fallbacks\":%lu,\"fallbackBytes\":%u}",
+                     n++ ? "," : "", a.name, ARENA_SIZE, (unsigned)a.used, (unsigned)a.high, (unsigned long)a.scopes,
+                     (unsigned long)a.fallbacks, (unsigned)a.fallbackBytes);
+  }
+  response->print("]");
+  request->send(response);
+}
+
+void arenaBegin()
+{
+  cJSON_Hooks hooks = {arenaAlloc, arenaFree};
+  cJSON_InitHooks(&hooks);
+}
@@ -0,0 +1,90 @@
+// boot timeline
+//
+// setup() only starts things: the 7-seg shows the time from the first loop(), storage and
+// the history replay run in their own task, and WiFi and the web server are brought up by
+// bootStep() from loop() as the phases they depend on finish. each phase records when it
+// started and finished (esp_timer, so the time before setup() counts too). the timeline is
+// printed once everything is up, and served as JSON on GET /boot.
+
+#include <ESPAsyncWebServer.h>
+#include "esp_timer.h"
+
+typedef enum
+{
+  BOOT_CLOCK,   // first time on the 7-seg
+  BOOT_DISPLAY, // OLED up, splash shown
+  BOOT_STORAGE, // SPIFFS mounted, preferences and alarms loaded
+  BOOT_HISTORY, // flash log replayed into the history
+  BOOT_WIFI,    // connected, or gave up and opened the AP
+  BOOT_WEB,     // server listening
+  BOOT_PHASES
+} bootphase;
+
+const char *bootNames[BOOT_PHASES] = {"clock", "display", "storage", "history", "wifi", "web"};
+
+#define BOOT_ALL ((1 << BOOT_PHASES) - 1)
+
+typedef struct
+{
+  int64_t start, end; // us since boot, 0 while not started / not done
+} bootspan;
+
+bootspan bootTimeline[BOOT_PHASES];
+EventGroupHandle_t bootEvents;
+
+void bootStart(bootphase p)
+{
+  bootTimeline[p].start = esp_timer_get_time();
+}
+
+void bootDone(bootphase p)
+{
+  bootTimeline[p].end = esp_timer_get_time();
+  if (!bootTimeline[p].start)
+    bootTimeline[p].start = bootTimeline[p].end;
+  xEventGroupSetBits(bootEvents, 1 << p);
+}
+
+bool bootStarted(bootphase p)
+{
+  return bootTimeline[p].start != 0;
+}
+
+// true once every phase in mask (1 << bootphase bits) is done
+bool bootReady(uint32_t mask)
+{
+  return (xEventGroupGetBits(bootEvents) & mask) == mask;
+}
+
+void bootPrint()
+{
+  char line[80];
+  for (int p = 0; p < BOOT_PHASES; p++)
+  {
+    const bootspan &s = bootTimeline[p];
+    sprintf(line, "[CODE] Boot %-8s %6ld ms .. %6ld ms", bootNames[p], (long)(s.start / 1000), (long)(s.end / 1000));
+    Serial.println(line);
+  }
+}
+
+// GET /boot: {"clock":[start,end],...} in ms since boot, null for a phase not done yet
+void handleBoot(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->print("{");
+  for (int p = 0; p < BOOT_PHASES; p++)
+  {
+    const bootspan &s = bootTimeline[p];
+    if (s.end)
+      response->printf("%s\"%s\":[%ld,%ld]", p ? "," : "", bootNames[p], (long)(s.start / 1000), (long)(s.end / 1000));
+    else
+      response->printf("%s\"%s\":null", p ? "," : "", bootNames[p]);
+  }
+  response->print("}");
+  request->send(response);
+}
+
+void bootBegin()
+{
+  bootEvents = xEventGroupCreate();
+}
@@ -0,0 +1,184 @@
+// downsampled history for the chart on the main page
+//
+// GET /chart?from=<unix>&to=<unix>&points=<n> picks the finest history ring that still
+// covers from, and merges consecutive buckets so at most n points come out (never more than
+// CHART_MAX_POINTS), each one the min and max of what it covers. min/max keeps the spikes a
+// plain average would hide, and the answer is bounded by points, not by the range.
+//
+// response: chartheader, then the temperature series, then the humidity series. per point:
+//   varint zigzag(min - previous min) + 1, or a single 0 for a point without data
+//   varint (max - min)
+// so a flat stretch costs two bytes a point. values are x scale, like the history.
+
+#include <ESPAsyncWebServer.h>
+
+#define CHART_MAGIC "CHT1"
+#define CHART_MAX_POINTS 500
+#define CHART_DEFAULT_POINTS 200
+#define CHART_DEFAULT_RANGE 86400 // s, when from is missing
+
+typedef struct
+{
+  char magic[4];  // CHART_MAGIC
+  uint8_t res;    // histres the points were built from
+  uint8_t series; // 2: temperature, humidity
+  uint16_t points;
+  uint32_t start; // unix time of the first point
+  uint32_t step;  // seconds per point
+  uint16_t scale; // HIST_SCALE
+  uint16_t reserved;
+} chartheader;
+
+typedef struct
+{
+  uint8_t res;
+  uint32_t first, last; // source keys
+  uint32_t step;        // source buckets per point
+  uint16_t points;
+} chartrange;
+
+typedef struct
+{
+  int16_t min, max;
+  bool has;
+} chartpoint;
+
+// picks the ring and the bucket grouping for [from, to]. false if there is nothing in range
+bool chartPlan(uint32_t from, uint32_t to, uint16_t points, chartrange &r)
+{
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  r.res = HIST_DAY;
+  for (uint8_t res = HIST_MINUTE; res < HIST_DAY; res++)
+  {
+    uint32_t newest = histNewest[res];
+    if (newest != 0 && (from + histOffset) / histPeriod[res] + histSize[res] > newest)
+    {
+      r.res = res;
+      break;
+    }
+  }
+  uint32_t newest = histNewest[r.res];
+  xSemaphoreGive(histLock);
+  if (newest == 0)
+    return false;
+
+  uint32_t period = histPeriod[r.res];
+  uint32_t oldest = newest - histSize[r.res] + 1;
+  r.first = max((from + histOffset) / period, oldest);
+  r.last = min((to + histOffset) / period, newest);
+  if (r.last < r.first)
+    return false;
+
+  uint32_t count = r.last - r.first + 1;
+  r.step = (count + points - 1) / points;
+  r.points = (count + r.step - 1) / r.step;
+  return true;
+}
+
+// min/max of point j of a series (0 temperature, 1 humidity)
+chartpoint chartPoint(const chartrange &r, uint8_t series, uint16_t j)
+{
+  chartpoint p = {};
+  uint32_t from = r.first + j * r.step;
+  uint32_t to = min(from + r.step - 1, r.last);
+
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  for (uint32_t key = from; key <= to; key++)
+  {
+    int16_t lo, hi;
+    if (r.res == HIST_MINUTE)
+    {
+      histsample s;
+      if (!histSlotMinute(key, s))
+        continue;
+      lo = hi = series ? s.hum : s.temp;
+    }
+    else
+    {
+      histbucket b;
+      if (!histSlotBucket(r.res, key, b))
+        continue;
+      const histstat &st = series ? b.hum : b.temp;
+      lo = st.min;
+      hi = st.max;
+    }
+    p.min = (!p.has || lo < p.min) ? lo : p.min;
+    p.max = (!p.has || hi > p.max) ? hi : p.max;
+    p.has = true;
+  }
+  xSemaphoreGive(histLock);
+  return p;
+}
+
+size_t chartVarint(uint8_t *out, uint32_t v)
+{
+  size_t n = 0;
+  while (v >= 0x80)
+  {
+    out[n++] = v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = v;
+  return n;
+}
+
+// at most 6 bytes
+size_t chartEncode(const chartpoint &p, int16_t &prev, uint8_t *out)
+{
+  if (!p.has)
+  {
+    out[0] = 0;
+    return 1;
+  }
+  int32_t delta = p.min - prev;
+  uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31); // shifted unsigned, a negative int32_t << 1 is UB
+  size_t n = chartVarint(out, zigzag + 1);
+  n += chartVarint(out + n, p.max - p.min);
+  prev = p.min;
+  return n;
+}
+
+void handleChart(AsyncWebServerRequest *request)
+{
+  uint32_t to = time(NULL), from = 0;
+  int points = CHART_DEFAULT_POINTS;
+  uint8_t seen = 0;
+  forEachParam(request, [&](uint32_t hash, AsyncWebParameter *p)
+               {
+    switch (hash) {
+    PARAM_CASE(seen, "from", 1 << 0)   from = strtoul(p->value().c_str(), NULL, 10); break;
+    PARAM_CASE(seen, "to", 1 << 1)     to = strtoul(p->value().c_str(), NULL, 10); break;
+    PARAM_CASE(seen, "points", 1 << 2) points = p->value().toInt(); break;
+    default: break;
+    } });
+  if (from == 0)
+    from = to - CHART_DEFAULT_RANGE;
+  points = constrain(points, 1, CHART_MAX_POINTS);
+
+  chartrange r;
+  if (from > to || !chartPlan(from, to, points, r))
+  {
+    request->send(204);
+    return;
+  }
+
+  chartheader h = {};
+  memcpy(h.magic, CHART_MAGIC, 4);
+  h.res = r.res;
+  h.series = 2;
+  h.points = r.points;
+  h.start = histKeyTime(r.res, r.first);
+  h.step = r.step * histPeriod[r.res];
+  h.scale = HIST_SCALE;
+
+  AsyncResponseStream *response = request->beginResponseStream("application/octet-stream");
+  response->write((const uint8_t *)&h, sizeof(h));
+  uint8_t buf[6];
+  for (uint8_t series = 0; series < 2; series++)
+  {
+    int16_t prev = 0;
+    for (uint16_t j = 0; j < r.points; j++)
+      response->write(buf, chartEncode(chartPoint(r, series, j), prev, buf));
+  }
+  request->send(response);
+}
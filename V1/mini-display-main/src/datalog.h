@@ -0,0 +1,126 @@
+// persistent sensor and event log
+//
+// the flashlog ring (flashlog.h) on the "datalog" partition from partitions.csv. anyone can
+// queue a record with logRecord(), it never blocks; a low priority task does the flash
+// writes, and once the queue is empty it compacts the oldest sector ahead of time whenever
+// fewer than LOG_RESERVE erased sectors are left, so appends don't wait on compaction.
+//
+// the history rings log one record per closed minute, hour and day. compaction keeps hour
+// and day rollups for as long as history.h keeps them, everything else simply ages out with
+// its sector (with 64 sectors that's a bit over a week of minutes).
+
+#include "esp_partition.h"
+#include "flashlog.h"
+
+#define LOG_PARTITION "datalog"
+#define LOG_QUEUE_LEN 16
+#define LOG_STACK_SIZE 3072
+#define LOG_RESERVE 2                  // erased sectors kept ahead of the writer
+#define LOG_KEEP_HOURS (30 * 86400UL)  // how long compaction keeps LOG_HOUR records
+#define LOG_KEEP_DAYS (366 * 86400UL)  // and LOG_DAY records
+#define LOG_VALID_AFTER 1672531200UL   // 2023-01-01, an earlier clock just hasn't been set yet
+
+typedef enum
+{
+  LOG_MINUTE = 1, // data: temp, hum (x100)
+  LOG_HOUR,       // data: temp min/avg/max, hum min/avg/max (x100)
+  LOG_DAY,        // same as LOG_HOUR
+  LOG_ALARM,      // data: alarm index, song
+  LOG_WEATHER,    // data: temp (K x100), humidity, pressure, icon, wind (m/s x100)
+} logtype;
+
+flog logStore;
+const esp_partition_t *logPartition;
+QueueHandle_t logQueue;
+TaskHandle_t logTask;
+volatile uint32_t logDropped; // records lost to a full queue
+
+bool logRead(void *ctx, uint32_t addr, void *buf, size_t len)
+{
+  return esp_partition_read((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+bool logWrite(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+  return esp_partition_write((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+bool logErase(void *ctx, uint32_t addr)
+{
+  return esp_partition_erase_range((const esp_partition_t *)ctx, addr, FLOG_SECTOR) == ESP_OK;
+}
+
+// what compaction copies forward, ctx points at the current unix time
+bool logKeep(const flogrecord &r, void *ctx)
+{
+  uint32_t now = *(const uint32_t *)ctx;
+  if (r.type != LOG_HOUR && r.type != LOG_DAY)
+    return false;
+  if (now < LOG_VALID_AFTER)
+    return true; // after a power cut the clock sits in 1970 until NTP answers, can't tell the age
+  if (r.time > now)
+    return false; // clock went back
+  return now - r.time < (r.type == LOG_HOUR ? LOG_KEEP_HOURS : LOG_KEEP_DAYS);
+}
+
+void logWriter(void *param)
+{
+  flogrecord r;
+  for (;;)
+  {
+    xQueueReceive(logQueue, &r, portMAX_DELAY);
+    flogAppend(logStore, r);
+
+    uint32_t now = time(NULL);
+    while (uxQueueMessagesWaiting(logQueue) == 0 && flogFree(logStore) < LOG_RESERVE)
+      if (!flogReclaim(logStore, logKeep, &now))
+        break;
+  }
+}
+
+// queues a record for the writer, safe from any task. returns false if it was dropped
+bool logRecord(uint8_t type, uint32_t time, int16_t d0 = 0, int16_t d1 = 0, int16_t d2 = 0, int16_t d3 = 0, int16_t d4 = 0, int16_t d5 = 0)
+{
+  if (!logQueue)
+    return false;
+  flogrecord r = {time, type, 0, {d0, d1, d2, d3, d4, d5}, 0};
+  if (xQueueSend(logQueue, &r, 0) != pdTRUE)
+  {
+    logDropped++;
+    return false;
+  }
+  return true;
+}
+
+// mounts the log, hands every stored record to replay (oldest first), then starts the writer
+void logBegin(void (*replay)(const flogrecord &, void *))
+{
+  logPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, LOG_PARTITION);
+  if (!logPartition)
+  {
+    Serial.println("[CODE] No " LOG_PARTITION " partition, history won't survive a restart");
+    return;
+  }
+
+  flashdev dev = {logRead, logWrite, logErase, (void *)logPartition, logPartition->size};
+  if (!flogMount(logStore, dev))
+  {
+    Serial.println("[CODE] Could not mount the data log");
+    return;
+  }
+  unsigned long start = millis();
+  flogForEach(logStore, replay, NULL);
+  char line[80];
+  sprintf(line, "[CODE] Data log: %u sectors, %u free, replayed in %lums", logStore.sectors, flogFree(logStore), millis() - start);
+  Serial.println(line);
+
+  logQueue = xQueueCreate(LOG_QUEUE_LEN, sizeof(flogrecord));
+  xTaskCreatePinnedToCore(
+      logWriter,      /* Task function. */
+      "Data Log",     /* name of task. */
+      LOG_STACK_SIZE, /* Stack size of task */
+      NULL,           /* parameter of the task */
+      1,              /* priority of the task */
+      &logTask,       /* Task handle to keep track of created task */
+      0);             /* pin task to core 0 */
+}
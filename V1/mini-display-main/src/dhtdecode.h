@@ -0,0 +1,93 @@
+// DHT22 frame decoder
+//
+// turns a captured pulse train into a reading. it only looks at (level, width) pairs, so it
+// works on whatever captured them: the RMT receiver on the badge or a recorded trace on a PC.
+//
+// what the line looks like after the host start pulse:
+//   sensor response  low ~80us, high ~80us
+//   40 bits, MSB first, each  low ~50us, then high ~27us for a 0 or ~70us for a 1
+//   end of frame  low ~50us, then the line floats high
+// the bytes are humidity (x10), temperature (x10, bit 15 = negative) and a checksum.
+
+#ifndef DHTDECODE_H
+#define DHTDECODE_H
+
+#include <stdint.h>
+
+#define DHT_BITS 40
+
+typedef struct
+{
+  uint8_t level;
+  uint16_t us;
+} dhtpulse;
+
+typedef enum
+{
+  DHT_DECODE_OK,
+  DHT_DECODE_NO_RESPONSE, // never saw the 80us low/high response
+  DHT_DECODE_TRUNCATED,   // frame ended before 40 bits
+  DHT_DECODE_TIMING,      // a pulse was far outside the datasheet widths
+  DHT_DECODE_CHECKSUM,
+} dhtdecodestatus;
+
+typedef struct
+{
+  uint8_t status;
+  uint8_t bytes[5];
+  int16_t temp10; // C x10
+  uint16_t hum10; // % x10
+} dhtframe;
+
+// pulse width windows, loose enough for the sensor's slow edges and the capture filter
+bool dhtIsResponse(const dhtpulse &p) { return p.us >= 60 && p.us <= 110; }
+bool dhtIsBitLow(const dhtpulse &p) { return p.level == 0 && p.us >= 30 && p.us <= 80; }
+bool dhtIsBitHigh(const dhtpulse &p) { return p.level == 1 && p.us >= 10 && p.us <= 100; }
+#define DHT_ONE_THRESHOLD 48 // us, high pulses longer than this are 1s
+
+dhtframe dhtDecode(const dhtpulse *pulses, int count)
+{
+  dhtframe f = {};
+
+  // the response is the first low/high pair of ~80us
+  int i = 0;
+  while (i + 1 < count && !(pulses[i].level == 0 && dhtIsResponse(pulses[i]) && pulses[i + 1].level == 1 && dhtIsResponse(pulses[i + 1])))
+    i++;
+  if (i + 1 >= count)
+  {
+    f.status = DHT_DECODE_NO_RESPONSE;
+    return f;
+  }
+  i += 2;
+
+  for (int bit = 0; bit < DHT_BITS; bit++, i += 2)
+  {
+    if (i + 1 >= count)
+    {
+      f.status = DHT_DECODE_TRUNCATED;
+      return f;
+    }
+    if (!dhtIsBitLow(pulses[i]) || !dhtIsBitHigh(pulses[i + 1]))
+    {
+      f.status = DHT_DECODE_TIMING;
+      return f;
+    }
+    if (pulses[i + 1].us > DHT_ONE_THRESHOLD)
+      f.bytes[bit / 8] |= 0x80 >> (bit % 8);
+  }
+
+  if ((uint8_t)(f.bytes[0] + f.bytes[1] + f.bytes[2] + f.bytes[3]) != f.bytes[4])
+  {
+    f.status = DHT_DECODE_CHECKSUM;
+    return f;
+  }
+
+  f.hum10 = f.bytes[0] << 8 | f.bytes[1];
+  f.temp10 = (f.bytes[2] & 0x7f) << 8 | f.bytes[3];
+  if (f.bytes[2] & 0x80)
+    f.temp10 = -f.temp10;
+  f.status = DHT_DECODE_OK;
+  return f;
+}
+
+#endif
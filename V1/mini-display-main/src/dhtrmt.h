@@ -0,0 +1,82 @@
+// DHT22 driver on the RMT receiver
+//
+// the Adafruit library times the 40 bits by busy-looping with interrupts off for ~5ms. here
+// the RMT peripheral records the edges instead and we only decode the captured widths
+// afterwards (dhtdecode.h), so interrupts stay on and the CPU is free during the transfer.
+
+#include "driver/rmt.h"
+#include "driver/gpio.h"
+#include "dhtdecode.h"
+
+#define DHT_RMT_CHANNEL RMT_CHANNEL_4
+#define DHT_RMT_IDLE 5000  // us without an edge that ends the capture, longer than our start pulse
+#define DHT_RMT_FILTER 100 // APB ticks (80 MHz), glitches shorter than ~1.25us are ignored
+#define DHT_RMT_TIMEOUT 20 // ms to wait for a frame
+#define DHT_MAX_PULSES 100 // start + response + 80 bit pulses + end, with some slack
+
+gpio_num_t dhtPin;
+RingbufHandle_t dhtRing;
+powerlock dhtPower;
+
+bool dhtRMTBegin(uint8_t pin)
+{
+  dhtPin = (gpio_num_t)pin;
+
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX(dhtPin, DHT_RMT_CHANNEL);
+  config.clk_div = 80; // 1 tick = 1us
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = DHT_RMT_FILTER;
+  config.rx_config.idle_threshold = DHT_RMT_IDLE;
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(DHT_RMT_CHANNEL, 1024, 0) != ESP_OK)
+  {
+    Serial.println("[MODULE] DHT RMT init failed");
+    return false;
+  }
+  rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &dhtRing);
+  powerLockCreate(dhtPower, "dht");
+
+  // open drain with the input still routed to the RMT, so we can pull the line low ourselves
+  gpio_set_direction(dhtPin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode(dhtPin, GPIO_PULLUP_ONLY);
+  gpio_set_level(dhtPin, 1);
+  return true;
+}
+
+// returns the decoded frame; status is DHT_DECODE_NO_RESPONSE if nothing came back in time
+dhtframe dhtRMTRead()
+{
+  size_t size = 0;
+  void *stale;
+  while ((stale = xRingbufferReceive(dhtRing, &size, 0)) != NULL)
+    vRingbufferReturnItem(dhtRing, stale); // leftovers from a read that timed out
+
+  // the capture starts while we hold the line low, so it is already running when the sensor
+  // answers 20-40us after we let go. light sleep would stop the RMT halfway
+  powerHold(dhtPower, true);
+  gpio_set_level(dhtPin, 0);
+  rmt_rx_start(DHT_RMT_CHANNEL, true);
+  vTaskDelay(pdMS_TO_TICKS(2)); // start pulse, at least 1ms
+  gpio_set_level(dhtPin, 1);
+
+  dhtpulse pulses[DHT_MAX_PULSES];
+  int count = 0;
+
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(dhtRing, &size, pdMS_TO_TICKS(DHT_RMT_IDLE / 1000 + DHT_RMT_TIMEOUT));
+  rmt_rx_stop(DHT_RMT_CHANNEL);
+  powerHold(dhtPower, false);
+  if (items)
+  {
+    for (size_t i = 0; i < size / sizeof(rmt_item32_t) && count + 2 <= DHT_MAX_PULSES; i++)
+    {
+      if (items[i].duration0 == 0)
+        break;
+      pulses[count++] = {(uint8_t)items[i].level0, (uint16_t)items[i].duration0};
+      if (items[i].duration1 == 0)
+        break; // a zero duration marks the end of the capture
+      pulses[count++] = {(uint8_t)items[i].level1, (uint16_t)items[i].duration1};
+    }
+    vRingbufferReturnItem(dhtRing, items);
+  }
+
+  return dhtDecode(pulses, count);
+}
@@ -0,0 +1,144 @@
+// background DHT22 sampler
+//
+// a low priority task reads the sensor once per period through the RMT driver (dhtrmt.h), so
+// loop() and the web callbacks never wait on a read. raw readings go through a median-of-5
+// window, which throws away the single-sample glitches the DHT22 likes to produce, then
+// through an EMA to smooth the 0.1 steps. failed reads are dropped. everyone else only ever
+// sees a published snapshot. everything is integer hundredths, see fixedpoint.h.
+
+#include "dhtrmt.h"
+#include "fixedpoint.h"
+#include "history.h"
+
+#define DHT_PERIOD 5000     // ms between reads, the DHT22 needs at least 2 s
+#define DHT_STALE_AFTER 6   // failed reads in a row before the snapshot is marked stale
+#define DHT_MEDIAN 5        // raw samples in the median window
+#define DHT_EMA_SHIFT 2     // EMA weight of a new sample is 1 / 2^shift
+#define DHT_STACK_SIZE 3072
+
+typedef enum
+{
+  DHT_NO_DATA, // no good read since boot
+  DHT_GOOD,
+  DHT_STALE, // the last DHT_STALE_AFTER reads failed, values are old
+} dhtquality;
+
+typedef struct
+{
+  // all x100, e.g. 2534 = 25.34C, only meaningful once quality isn't DHT_NO_DATA
+  int16_t temp; // C
+  int16_t hum;  // %
+  int16_t hi;   // heat index, C
+  int16_t dew;  // dew point, C
+  unsigned long millis; // when the newest sample that went into this was taken
+  uint8_t quality;
+  uint32_t samples; // good reads since boot
+  uint32_t failures;
+  uint8_t lastError; // dhtdecodestatus of the last failed read
+} dhtsnapshot;
+
+typedef struct
+{
+  int16_t values[DHT_MEDIAN];
+  uint8_t count, next;
+  int32_t ema; // x256
+} dhtfilter;
+
+dhtsnapshot dhtPublished = {0, 0, 0, 0, 0, DHT_NO_DATA, 0, 0, DHT_DECODE_OK};
+portMUX_TYPE dhtMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t dhtTask;
+
+// copy of the latest snapshot, safe from any task
+dhtsnapshot dhtLatest()
+{
+  portENTER_CRITICAL(&dhtMux);
+  dhtsnapshot s = dhtPublished;
+  portEXIT_CRITICAL(&dhtMux);
+  return s;
+}
+
+void dhtPublish(const dhtsnapshot &s)
+{
+  portENTER_CRITICAL(&dhtMux);
+  dhtPublished = s;
+  portEXIT_CRITICAL(&dhtMux);
+}
+
+// raw and result x100
+int16_t dhtFilter(dhtfilter &f, int16_t raw)
+{
+  f.values[f.next] = raw;
+  f.next = (f.next + 1) % DHT_MEDIAN;
+  if (f.count < DHT_MEDIAN)
+    f.count++;
+
+  // insertion sort, it's five values
+  int16_t sorted[DHT_MEDIAN];
+  for (int i = 0; i < f.count; i++)
+  {
+    int j = i;
+    for (; j > 0 && sorted[j - 1] > f.values[i]; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = f.values[i];
+  }
+  int32_t median = sorted[f.count / 2] << 8;
+
+  if (f.count == 1)
+    f.ema = median;
+  else
+    f.ema += (median - f.ema) >> DHT_EMA_SHIFT;
+  return (f.ema + 128) >> 8;
+}
+
+void dhtSampler(void *param)
+{
+  dhtfilter tempFilter = {}, humFilter = {};
+  dhtsnapshot s = dhtLatest();
+  int failedInARow = 0;
+
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    dhtframe frame = dhtRMTRead();
+
+    if (frame.status != DHT_DECODE_OK)
+    {
+      s.failures++;
+      s.lastError = frame.status;
+      if (++failedInARow == DHT_STALE_AFTER && s.quality == DHT_GOOD)
+      {
+        s.quality = DHT_STALE;
+        Serial.println("[MODULE] DHT sensor stopped responding");
+      }
+    }
+    else
+    {
+      failedInARow = 0;
+      s.temp = dhtFilter(tempFilter, frame.temp10 * 10);
+      s.hum = dhtFilter(humFilter, frame.hum10 * 10);
+      s.hi = fixHeatIndex(s.temp, s.hum);
+      s.dew = fixDewPoint(s.temp, s.hum);
+      s.millis = millis();
+      s.quality = DHT_GOOD;
+      s.samples++;
+      histAdd(time(NULL), s.temp, s.hum);
+    }
+    dhtPublish(s);
+
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DHT_PERIOD));
+  }
+}
+
+void dhtBegin(uint8_t pin)
+{
+  if (!dhtRMTBegin(pin))
+    return;
+  xTaskCreatePinnedToCore(
+      dhtSampler,     /* Task function. */
+      "DHT Sampler",  /* name of task. */
+      DHT_STACK_SIZE, /* Stack size of task */
+      NULL,           /* parameter of the task */
+      1,              /* priority of the task */
+      &dhtTask,       /* Task handle to keep track of created task */
+      1);             /* pin task to core 1 */
+}
@@ -0,0 +1,202 @@
+// temperature-compensated clock drift
+//
+// the ESP32's crystal runs a few tens of ppm off, more at the ends of its temperature range,
+// and a clock that never sees NTP again (AP mode) slowly wanders away. every time we get a
+// trusted time (an SNTP sync or the browser's epoch on /init?time=) we compare how far
+// esp_timer (same crystal, never adjusted) got against how much real time passed since the
+// previous one, and file that ppm under the average DHT temperature of the interval. in
+// between, driftTick() looks up the ppm for the current temperature and slews the system
+// clock with adjtime(), so the time never jumps.
+//
+// the model is one weighted mean per 2C bin, interpolated between bins we've seen, and is
+// kept in NVS so it survives restarts.
+//
+// an interval with a powerSleep() (night mode) in it isn't a sample: in light sleep esp_timer
+// runs on the RTC slow clock, not the crystal. the next reference after one only re-anchors.
+
+#include <Preferences.h>
+#include <sys/time.h>
+#include "esp_timer.h"
+
+#define DRIFT_BIN_C 2               // C per temperature bin
+#define DRIFT_BIN_MIN -10           // C, lower edge of the first bin
+#define DRIFT_BINS 30               // -10 .. 50C
+#define DRIFT_MAX_PPB 200000        // beyond 200 ppm somebody set the clock by hand, it's not drift
+#define DRIFT_MAX_WEIGHT 2592000    // s, a bin only remembers ~30 days, so crystal aging gets followed
+#define DRIFT_NTP_SPAN 3600         // s between references before we trust a sample, NTP is ~10ms good
+#define DRIFT_BROWSER_SPAN 259200   // browser epochs are whole seconds, so wait 3 days
+#define DRIFT_SLEW_US 1000          // correction is handed to adjtime() in steps of at least this
+
+typedef enum
+{
+  DRIFT_NTP,
+  DRIFT_BROWSER,
+} driftsource;
+
+typedef struct
+{
+  int32_t ppb[DRIFT_BINS];     // mean drift per bin, parts per billion, positive = clock runs fast
+  uint32_t weight[DRIFT_BINS]; // seconds of measurement behind each bin
+} driftmodel;
+
+typedef struct
+{
+  bool valid;
+  uint8_t source;
+  int64_t trueUs, monoUs; // real time and esp_timer at the last reference
+  int64_t tempSum;        // DHT temperature (x100) samples since then
+  uint32_t tempCount;
+  uint32_t sleeps; // powerStats.sleeps at the last reference
+} driftanchor;
+
+driftmodel driftModel;
+driftanchor driftAnchor;
+portMUX_TYPE driftMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool driftDirty; // model changed, save it from loop()
+int64_t driftLastTick;
+int64_t driftPendingNs; // correction not handed to adjtime() yet
+int64_t driftAppliedUs; // total slewed since boot, for the log
+Preferences driftPrefs;
+
+int driftBin(int32_t temp)
+{
+  int bin = (temp / 100 - DRIFT_BIN_MIN) / DRIFT_BIN_C;
+  return bin < 0 ? 0 : bin >= DRIFT_BINS ? DRIFT_BINS - 1 : bin;
+}
+
+// drift at temp (C x100), false if nothing has been learned yet
+bool driftPredict(int32_t temp, int32_t &ppb)
+{
+  int bin = driftBin(temp);
+  if (driftModel.weight[bin])
+  {
+    ppb = driftModel.ppb[bin];
+    return true;
+  }
+
+  int below = bin - 1, above = bin + 1;
+  while (below >= 0 && !driftModel.weight[below])
+    below--;
+  while (above < DRIFT_BINS && !driftModel.weight[above])
+    above++;
+  if (below < 0 && above >= DRIFT_BINS)
+    return false;
+  if (below < 0 || above >= DRIFT_BINS)
+  {
+    ppb = driftModel.ppb[below < 0 ? above : below];
+    return true;
+  }
+  ppb = driftModel.ppb[below] + (int64_t)(driftModel.ppb[above] - driftModel.ppb[below]) * (bin - below) / (above - below);
+  return true;
+}
+
+// what adjtime() still has to correct, us
+int64_t driftSlewLeft()
+{
+  struct timeval old;
+  if (adjtime(NULL, &old) != 0)
+    return 0;
+  return (int64_t)old.tv_sec * 1000000 + old.tv_usec;
+}
+
+// moves the clock by us through adjtime(), on top of whatever slew is still running
+// (adjtime() on its own replaces it). for the model's own small corrections; NTP measures
+// the whole offset and replaces the slew instead, see ntpApply()
+bool driftSlew(int64_t us)
+{
+  us += driftSlewLeft();
+  struct timeval delta = {(time_t)(us / 1000000), (suseconds_t)(us % 1000000)};
+  return adjtime(&delta, NULL) == 0;
+}
+
+// a trusted time just arrived: trueUs is what the clock should have read when esp_timer was
+// at monoUs (0 for now)
+void driftReference(int64_t trueUs, uint8_t source, int64_t monoUs = 0)
+{
+  int64_t mono = monoUs ? monoUs : esp_timer_get_time();
+  int32_t ppb = 0, temp = 0;
+  int64_t span = 0;
+  bool sample = false;
+
+  portENTER_CRITICAL(&driftMux);
+  driftanchor &a = driftAnchor;
+  if (a.valid && a.sleeps == powerStats.sleeps)
+  {
+    span = trueUs - a.trueUs;
+    int64_t needed = (source == DRIFT_BROWSER || a.source == DRIFT_BROWSER) ? DRIFT_BROWSER_SPAN : DRIFT_NTP_SPAN;
+    if (span >= 0 && span < needed * 1000000LL)
+    {
+      portEXIT_CRITICAL(&driftMux);
+      return; // too soon to say anything, keep measuring from the old reference
+    }
+    if (span > 0 && a.tempCount)
+    {
+      int64_t p = (mono - a.monoUs - span) * 1000000000LL / span;
+      temp = a.tempSum / a.tempCount;
+      if (p > -DRIFT_MAX_PPB && p < DRIFT_MAX_PPB)
+      {
+        ppb = p;
+        sample = true;
+        int bin = driftBin(temp);
+        uint32_t w = driftModel.weight[bin], ws = span / 1000000;
+        driftModel.ppb[bin] = ((int64_t)driftModel.ppb[bin] * w + (int64_t)ppb * ws) / (w + ws);
+        driftModel.weight[bin] = min(w + ws, (uint32_t)DRIFT_MAX_WEIGHT);
+        driftDirty = true;
+      }
+    }
+  }
+  a = {true, source, trueUs, mono, 0, 0, powerStats.sleeps};
+  portEXIT_CRITICAL(&driftMux);
+
+  if (sample)
+  {
+    char line[100];
+    sprintf(line, "[TIME] Clock drift %ld.%03ld ppm at %dC over %lds", (long)(ppb / 1000), (long)abs(ppb % 1000), (int)(temp / 100), (long)(span / 1000000));
+    Serial.println(line);
+  }
+}
+
+// called every minute from loop(): feeds the temperature and slews the clock
+void driftTick()
+{
+  int64_t mono = esp_timer_get_time();
+  int64_t dt = driftLastTick ? mono - driftLastTick : 0;
+  driftLastTick = mono;
+
+  dhtsnapshot dht = dhtLatest();
+  if (dht.quality != DHT_GOOD)
+    return;
+  portENTER_CRITICAL(&driftMux);
+  driftAnchor.tempSum += dht.temp;
+  driftAnchor.tempCount++;
+  int32_t ppb;
+  bool known = driftPredict(dht.temp, ppb);
+  portEXIT_CRITICAL(&driftMux);
+
+  if (driftDirty)
+  {
+    driftDirty = false;
+    driftPrefs.putBytes("model", &driftModel, sizeof(driftModel));
+  }
+
+  if (!known)
+    return;
+  // a clock running fast (ppb > 0) gets held back
+  driftPendingNs -= (int64_t)ppb * dt / 1000000;
+  if (driftPendingNs >= DRIFT_SLEW_US * 1000LL || driftPendingNs <= -DRIFT_SLEW_US * 1000LL)
+  {
+    int64_t us = driftPendingNs / 1000;
+    if (driftSlew(us))
+    {
+      driftPendingNs -= us * 1000;
+      driftAppliedUs += us;
+    }
+  }
+}
+
+void driftBegin()
+{
+  driftPrefs.begin("drift", false);
+  if (driftPrefs.getBytesLength("model") == sizeof(driftModel))
+    driftPrefs.getBytes("model", &driftModel, sizeof(driftModel));
+}
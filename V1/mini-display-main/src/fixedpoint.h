@@ -0,0 +1,145 @@
+// fixed-point sensor math
+//
+// temperatures and humidity are int32 in hundredths (2534 = 25.34C, 6120 = 61.20%), the same
+// scale the history uses. the ESP32's FPU is single precision only and the Adafruit heat
+// index goes through float conversions and sqrt, so these stay in integers: the heat index is
+// the same NWS formula (Steadman, then Rothfusz with its two adjustments) with the
+// coefficients scaled by 1e8 and 64-bit intermediates, and the dew point is the Magnus
+// formula with a Q16 natural log.
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <stdint.h>
+
+#define FIX_SCALE 100
+#define FIX_Q 16 // fraction bits of fixLn()
+
+// rounds a / b to nearest, b > 0
+int64_t fixDiv(int64_t a, int64_t b)
+{
+  return a >= 0 ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+int32_t fixCtoF(int32_t c)
+{
+  return fixDiv((int64_t)c * 9, 5) + 3200;
+}
+
+int32_t fixFtoC(int32_t f)
+{
+  return fixDiv((int64_t)(f - 3200) * 5, 9);
+}
+
+uint32_t fixSqrt(uint32_t v)
+{
+  uint32_t root = 0, bit = 1UL << 30;
+  while (bit > v)
+    bit >>= 2;
+  while (bit)
+  {
+    if (v >= root + bit)
+    {
+      v -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return root;
+}
+
+// heat index in C x100, from C x100 and % x100
+int32_t fixHeatIndex(int32_t c, int32_t rh)
+{
+  int64_t t = fixCtoF(c), r = rh;
+  // Steadman's simple formula first, Rothfusz only above 79F like the NWS does it
+  // (x1000 here, so the branch flips where the float version's does)
+  int64_t simple = fixDiv(10 * t + 61000 + 12 * (t - 6800) + fixDiv(r * 94, 100), 2);
+  int64_t hi = fixDiv(simple, 10);
+
+  if (simple > 79000)
+  {
+    int64_t tr = fixDiv(t * r, 100), tt = fixDiv(t * t, 100), rr = fixDiv(r * r, 100);
+    int64_t ttr = fixDiv(tt * r, 100), trr = fixDiv(t * rr, 100), ttrr = fixDiv(tt * rr, 100);
+    // coefficients x1e8, terms x100
+    hi = fixDiv(-423790000000LL + 204901523LL * t + 1014333127LL * r - 22475541LL * tr - 683783LL * tt -
+                    5481717LL * rr + 122874LL * ttr + 85282LL * trr - 199LL * ttrr,
+                100000000LL);
+
+    if (r < 1300 && t >= 8000 && t <= 11200)
+    {
+      int64_t d = 1700 - (t > 9500 ? t - 9500 : 9500 - t); // 17 - |T - 95|, x100
+      int64_t root = fixSqrt(d * 58820);                       // sqrt(d * 0.05882), x1e4
+      hi -= fixDiv((1300 - r) * 25 * root, 100 * 10000);
+    }
+    else if (r > 8500 && t >= 8000 && t <= 8700)
+      hi += fixDiv((r - 8500) * (8700 - t), 5000);
+  }
+  return fixFtoC(hi);
+}
+
+// natural log of x / 2^FIX_Q, result in Q16. x > 0
+int32_t fixLn(uint32_t x)
+{
+  // x = m * 2^e with m in [1, 2)
+  int32_t e = 0;
+  while (x >= (2UL << FIX_Q))
+  {
+    x >>= 1;
+    e++;
+  }
+  while (x < (1UL << FIX_Q))
+  {
+    x <<= 1;
+    e--;
+  }
+  // ln m = 2 (s + s^3/3 + s^5/5 + s^7/7), s = (m - 1) / (m + 1) <= 1/3
+  int64_t s = ((int64_t)(x - (1UL << FIX_Q)) << FIX_Q) / (x + (1UL << FIX_Q));
+  int64_t s2 = (s * s) >> FIX_Q;
+  int64_t term = s, sum = s;
+  for (int k = 3; k <= 7; k += 2)
+  {
+    term = (term * s2) >> FIX_Q;
+    sum += term / k;
+  }
+  return e * 45426 + 2 * sum; // ln 2 = 45426 / 2^16
+}
+
+// Magnus dew point in C x100, from C x100 and % x100
+int32_t fixDewPoint(int32_t c, int32_t rh)
+{
+  rh = rh < 1 ? 1 : rh > 10000 ? 10000 : rh;
+  // gamma = ln(rh / 100) + b T / (c + T), b = 17.62, c = 243.12C. the log is taken of rh
+  // itself and ln 10000 taken off after, rh / 10000 in Q16 loses too much at a few percent
+  int64_t gamma = fixLn((uint32_t)rh << FIX_Q) - 603610 + fixDiv((int64_t)1762 * c << FIX_Q, (int64_t)100 * (24312 + c));
+  // Td = c gamma / (b - gamma)
+  return fixDiv(24312 * gamma, 1154744 - gamma); // b = 1154744 / 2^16
+}
+
+// writes v / 10^decimals, e.g. fixFormat(buf, -512, 2) is "-5.12". returns the length
+int fixFormat(char *out, int32_t v, uint8_t decimals)
+{
+  char digits[12];
+  int n = 0, len = 0;
+  uint32_t u = v < 0 ? -(uint32_t)v : v;
+  do
+  {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u || n <= decimals);
+
+  if (v < 0)
+    out[len++] = '-';
+  while (n)
+  {
+    if (n == decimals)
+      out[len++] = '.';
+    out[len++] = digits[--n];
+  }
+  out[len] = 0;
+  return len;
+}
+
+#endif
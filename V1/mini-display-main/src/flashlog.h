@@ -0,0 +1,252 @@
+// append-only record log on raw flash
+//
+// the partition is used as a ring of 4 KB sectors. each sector starts with a header carrying
+// a sequence number and is then filled front to back with fixed-size records, every record
+// with its own CRC. when the head sector is full the writer moves on to the next one, so
+// every sector is erased exactly once per trip around the ring, which is all the wear
+// levelling a ring needs.
+//
+// recovery: the head is the valid sector with the highest sequence number and the tail is
+// found by walking back while the sequence numbers stay consecutive. inside the head the
+// first all-0xFF slot is where writing continues. a record torn by a power cut fails its CRC
+// and is skipped, a sector whose erase or header write was cut short has no valid header and
+// is simply erased again before it's used.
+//
+// compaction: before the oldest sector is given up, the records the caller still wants are
+// appended at the head, then the sector's header is zeroed (no erase needed) so it drops out
+// of the chain. a power cut in between only leaves duplicates of the copied records.
+//
+// the flash itself is behind flashdev, so this file doesn't depend on the ESP32.
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FLOG_SECTOR 4096
+#define FLOG_MAGIC 0x474f4c46 // "FLOG"
+
+typedef struct
+{
+  bool (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+  bool (*write)(void *ctx, uint32_t addr, const void *buf, size_t len);
+  bool (*erase)(void *ctx, uint32_t addr); // one FLOG_SECTOR
+  void *ctx;
+  uint32_t size;
+} flashdev;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t seq;
+  uint16_t recordSize;
+  uint16_t crc;
+  uint32_t reserved;
+} flogheader;
+
+typedef struct
+{
+  uint32_t time; // unix time, 0xFFFFFFFF never appears in a written record
+  uint8_t type;
+  uint8_t reserved;
+  int16_t data[6];
+  uint16_t crc;
+} flogrecord;
+
+#define FLOG_SLOTS ((FLOG_SECTOR - sizeof(flogheader)) / sizeof(flogrecord))
+
+typedef struct
+{
+  flashdev dev;
+  uint16_t sectors;
+  uint16_t head, tail; // sectors holding data, tail is the oldest
+  uint16_t next;       // free slot in head
+  uint32_t seq;        // of head
+  uint32_t appended, erases, compactions, errors;
+} flog;
+
+// CRC-16/CCITT-FALSE
+uint16_t flogCRC(const void *data, size_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  uint16_t crc = 0xffff;
+  while (len--)
+  {
+    crc ^= *p++ << 8;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+uint32_t flogAddr(uint16_t sector, uint16_t slot)
+{
+  return sector * FLOG_SECTOR + sizeof(flogheader) + slot * sizeof(flogrecord);
+}
+
+bool flogBlank(const void *data, size_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++)
+    if (p[i] != 0xff)
+      return false;
+  return true;
+}
+
+// seq of a sector with a good header, 0 otherwise
+uint32_t flogSectorSeq(flog &f, uint16_t sector)
+{
+  flogheader h;
+  if (!f.dev.read(f.dev.ctx, sector * FLOG_SECTOR, &h, sizeof(h)))
+    return 0;
+  if (h.magic != FLOG_MAGIC || h.recordSize != sizeof(flogrecord) || h.crc != flogCRC(&h, offsetof(flogheader, crc)))
+    return 0;
+  return h.seq;
+}
+
+bool flogStartSector(flog &f, uint16_t sector, uint32_t seq)
+{
+  f.erases++;
+  if (!f.dev.erase(f.dev.ctx, sector * FLOG_SECTOR))
+    return false;
+  flogheader h = {FLOG_MAGIC, seq, sizeof(flogrecord), 0, 0xffffffff};
+  h.crc = flogCRC(&h, offsetof(flogheader, crc));
+  if (!f.dev.write(f.dev.ctx, sector * FLOG_SECTOR, &h, sizeof(h)))
+    return false;
+  f.head = sector;
+  f.seq = seq;
+  f.next = 0;
+  return true;
+}
+
+// sectors neither holding data nor being written
+uint16_t flogFree(const flog &f)
+{
+  return f.sectors - ((f.head + f.sectors - f.tail) % f.sectors + 1);
+}
+
+bool flogValid(const flogrecord &r)
+{
+  return r.crc == flogCRC(&r, offsetof(flogrecord, crc));
+}
+
+// finds head, tail and the write position, formats the partition if it holds no log
+bool flogMount(flog &f, const flashdev &dev)
+{
+  f = {};
+  f.dev = dev;
+  f.sectors = dev.size / FLOG_SECTOR;
+  if (f.sectors < 2)
+    return false;
+
+  uint32_t best = 0;
+  for (uint16_t s = 0; s < f.sectors; s++)
+  {
+    uint32_t seq = flogSectorSeq(f, s);
+    if (seq > best)
+    {
+      best = seq;
+      f.head = s;
+    }
+  }
+  if (best == 0)
+    return flogStartSector(f, 0, 1); // empty or foreign partition, start a new log
+
+  f.seq = best;
+  f.tail = f.head;
+  for (uint16_t n = 1; n < f.sectors; n++)
+  {
+    uint16_t prev = (f.tail + f.sectors - 1) % f.sectors;
+    uint32_t seq = flogSectorSeq(f, prev);
+    if (seq == 0 || seq != best - n)
+      break;
+    f.tail = prev;
+  }
+
+  flogrecord r;
+  for (f.next = 0; f.next < FLOG_SLOTS; f.next++)
+  {
+    if (!f.dev.read(f.dev.ctx, flogAddr(f.head, f.next), &r, sizeof(r)))
+      return false;
+    if (flogBlank(&r, sizeof(r)))
+      break;
+  }
+  return true;
+}
+
+// calls fn(record, ctx) for every good record, oldest sector first
+void flogForEach(flog &f, void (*fn)(const flogrecord &, void *), void *ctx)
+{
+  for (uint16_t s = f.tail;; s = (s + 1) % f.sectors)
+  {
+    uint16_t slots = s == f.head ? f.next : FLOG_SLOTS;
+    for (uint16_t i = 0; i < slots; i++)
+    {
+      flogrecord r;
+      if (f.dev.read(f.dev.ctx, flogAddr(s, i), &r, sizeof(r)) && !flogBlank(&r, sizeof(r)) && flogValid(r))
+        fn(r, ctx);
+    }
+    if (s == f.head)
+      break;
+  }
+}
+
+bool flogReclaim(flog &f, bool (*keep)(const flogrecord &, void *), void *ctx);
+
+bool flogAppend(flog &f, flogrecord r)
+{
+  if (f.next >= FLOG_SLOTS)
+  {
+    uint16_t sector = (f.head + 1) % f.sectors;
+    if (sector == f.tail && !flogReclaim(f, NULL, NULL))
+      return false; // the caller let the free sectors run out, drop the oldest outright
+    if (!flogStartSector(f, sector, f.seq + 1))
+    {
+      f.errors++;
+      return false;
+    }
+  }
+
+  r.crc = flogCRC(&r, offsetof(flogrecord, crc));
+  uint16_t slot = f.next++; // a failed write still uses up the slot
+  if (!f.dev.write(f.dev.ctx, flogAddr(f.head, slot), &r, sizeof(r)))
+  {
+    f.errors++;
+    return false;
+  }
+  f.appended++;
+  return true;
+}
+
+// gives up the oldest sector, copying forward the records keep() asks for (at most half a
+// sector's worth, so a sector is always freed). keep == NULL drops everything
+bool flogReclaim(flog &f, bool (*keep)(const flogrecord &, void *), void *ctx)
+{
+  if (f.tail == f.head)
+    return false;
+  uint16_t sector = f.tail;
+
+  if (keep && flogFree(f) > 0)
+  {
+    uint16_t copied = 0;
+    for (uint16_t i = 0; i < FLOG_SLOTS && copied < FLOG_SLOTS / 2; i++)
+    {
+      flogrecord r;
+      if (f.dev.read(f.dev.ctx, flogAddr(sector, i), &r, sizeof(r)) && !flogBlank(&r, sizeof(r)) && flogValid(r) && keep(r, ctx))
+      {
+        flogAppend(f, r);
+        copied++;
+      }
+    }
+  }
+
+  uint32_t zero = 0;
+  f.dev.write(f.dev.ctx, sector * FLOG_SECTOR, &zero, sizeof(zero));
+  f.tail = (sector + 1) % f.sectors;
+  f.compactions++;
+  return true;
+}
+
+#endif
@@ -0,0 +1,55 @@
+// allocation-free formatting
+//
+// the little helpers used to return Strings (padZeros, getDay, getESPMac) that were then glued
+// together with +, a few heap allocations per call, and the time was printed every second.
+// over weeks of uptime that churn fragments the heap. these write into a buffer the caller
+// owns, usually on its stack, and the day names are a constant table. the lines that print a
+// date or time go through serlog.h, whose drain task formats them with snprintf, so there's
+// no tm or zero-padding formatter here.
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+constexpr const char *fmtDays[7] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+
+const char *fmtDay(int d)
+{
+  return d >= 0 && d < 7 ? fmtDays[d] : "lol?";
+}
+
+// "AA:BB:CC:DD:EE:FF", out needs 18
+void fmtMac(char *out, const uint8_t *mac)
+{
+  const char *hex = "0123456789ABCDEF";
+  for (int i = 0; i < 6; i++)
+  {
+    *out++ = hex[mac[i] >> 4];
+    *out++ = hex[mac[i] & 15];
+    *out++ = i < 5 ? ':' : 0;
+  }
+}
+
+// s with the HTML specials escaped, for text that came from outside (an uploaded file's name).
+// out needs 6 * strlen(s) + 1
+void fmtHtml(char *out, const char *s)
+{
+  for (; *s; s++)
+  {
+    switch (*s)
+    {
+    case '&': out = stpcpy(out, "&amp;"); break;
+    case '<': out = stpcpy(out, "&lt;"); break;
+    case '>': out = stpcpy(out, "&gt;"); break;
+    case '"': out = stpcpy(out, "&quot;"); break;
+    case '\'': out = stpcpy(out, "&#39;"); break;
+    default: *out++ = *s;
+    }
+  }
+  *out = 0;
+}
+
+#endif
@@ -0,0 +1,413 @@
+// temperature / humidity history
+//
+// three fixed rings, all allocated up front: one average per minute for the last 24 h, and
+// min/avg/max per hour for 30 days and per day for a year. values are int16 in hundredths
+// (0.01C, 0.01%), about 19 KB in total. the sampler feeds every good read into histAdd();
+// when a minute is finished its average is folded into running accumulators for the current
+// hour and day, and those buckets are rewritten from the accumulators straight away. so
+// nothing is ever recomputed over a range, and reading any bucket is a single slot lookup.
+//
+// buckets are keyed by minutes / hours / days since the epoch in local time, slot = key % size.
+// the newest key per ring tells which slots are still current; skipped slots are cleared to
+// HIST_EMPTY as the ring moves forward.
+//
+// every closed minute, hour and day also goes to the flash log (datalog.h), and at boot the
+// log is replayed through the same code to rebuild the rings.
+
+#include <ESPAsyncWebServer.h>
+#include "datalog.h"
+
+#define HIST_MINUTES 1440 // 24 h
+#define HIST_HOURS 720    // 30 days
+#define HIST_DAYS 366
+#define HIST_SCALE 100            // stored value = reading x 100
+#define HIST_EMPTY INT16_MIN      // no data for this bucket
+#define HIST_VALID_AFTER LOG_VALID_AFTER
+#define HIST_MAX_REWIND 60        // minutes the clock may step back before the history is cleared
+#define HIST_MAGIC "HIS1"
+
+typedef enum
+{
+  HIST_MINUTE,
+  HIST_HOUR,
+  HIST_DAY,
+  HIST_LEVELS,
+} histres;
+
+typedef struct
+{
+  int16_t temp, hum;
+} histsample;
+
+typedef struct
+{
+  int16_t min, avg, max;
+} histstat;
+
+typedef struct
+{
+  histstat temp, hum;
+} histbucket;
+
+// running min/sum/max of one value
+typedef struct
+{
+  int32_t sum;
+  int16_t min, max;
+} histrun;
+
+typedef struct
+{
+  histrun temp, hum;
+  uint16_t count;
+} histacc;
+
+// what /history sends in front of the buckets, all little endian
+typedef struct
+{
+  char magic[4];   // HIST_MAGIC
+  uint8_t res;     // histres
+  uint8_t stride;  // int16 values per bucket: temp, hum for minutes; temp min/avg/max, hum min/avg/max for rollups
+  uint16_t count;  // buckets that follow, oldest first
+  uint32_t newest; // unix time the newest bucket starts at
+  uint32_t period; // seconds per bucket
+  uint16_t scale;  // HIST_SCALE
+  uint16_t reserved;
+} histheader;
+
+histsample histMinutes[HIST_MINUTES];
+histbucket histHours[HIST_HOURS];
+histbucket histDays[HIST_DAYS];
+const uint16_t histSize[HIST_LEVELS] = {HIST_MINUTES, HIST_HOURS, HIST_DAYS};
+const uint32_t histPeriod[HIST_LEVELS] = {60, 3600, 86400};
+uint32_t histNewest[HIST_LEVELS]; // key of the newest slot, 0 while the ring is empty
+histacc histMinuteAcc, histHourAcc, histDayAcc;
+int32_t histOffset; // seconds added to UTC before cutting minutes, hours and days
+SemaphoreHandle_t histLock;
+bool histReplaying;     // rebuilding from the log, don't log again
+uint32_t histReplayed;  // newest minute found in the log, already closed
+
+const histsample histEmptySample = {HIST_EMPTY, HIST_EMPTY};
+const histbucket histEmptyBucket = {{HIST_EMPTY, HIST_EMPTY, HIST_EMPTY}, {HIST_EMPTY, HIST_EMPTY, HIST_EMPTY}};
+
+void histRunAdd(histrun &r, int16_t v, bool first)
+{
+  r.sum = first ? v : r.sum + v;
+  r.min = (first || v < r.min) ? v : r.min;
+  r.max = (first || v > r.max) ? v : r.max;
+}
+
+void histAccAdd(histacc &a, int16_t temp, int16_t hum)
+{
+  histRunAdd(a.temp, temp, a.count == 0);
+  histRunAdd(a.hum, hum, a.count == 0);
+  a.count++;
+}
+
+histstat histRunStat(const histrun &r, uint16_t count)
+{
+  return {r.min, (int16_t)(r.sum / count), r.max};
+}
+
+histbucket histAccBucket(const histacc &a)
+{
+  return {histRunStat(a.temp, a.count), histRunStat(a.hum, a.count)};
+}
+
+// moves a ring's newest key forward to key, clearing the slots in between
+template <typename T>
+void histAdvance(T *slots, uint16_t size, uint32_t &newest, uint32_t key, const T &empty)
+{
+  if (newest != 0)
+    for (uint32_t k = newest + 1; k <= key && k - newest <= size; k++)
+      slots[k % size] = empty;
+  newest = key;
+}
+
+void histClear()
+{
+  for (int i = 0; i < HIST_MINUTES; i++)
+    histMinutes[i] = histEmptySample;
+  for (int i = 0; i < HIST_HOURS; i++)
+    histHours[i] = histEmptyBucket;
+  for (int i = 0; i < HIST_DAYS; i++)
+    histDays[i] = histEmptyBucket;
+  for (int i = 0; i < HIST_LEVELS; i++)
+    histNewest[i] = 0;
+  histMinuteAcc = histHourAcc = histDayAcc = {};
+  histReplayed = 0;
+}
+
+// unix time a bucket starts at
+uint32_t histKeyTime(uint8_t res, uint32_t key)
+{
+  return key * histPeriod[res] - histOffset;
+}
+
+void histLogBucket(uint8_t type, uint8_t res, uint32_t key, const histbucket &b)
+{
+  logRecord(type, histKeyTime(res, key), b.temp.min, b.temp.avg, b.temp.max, b.hum.min, b.hum.avg, b.hum.max);
+}
+
+// folds the finished minute into the hour and day it belongs to
+void histCloseMinute(uint32_t minute)
+{
+  histsample m = histMinutes[minute % HIST_MINUTES];
+  uint32_t hour = minute / 60, day = minute / 1440;
+
+  if (!histReplaying)
+  {
+    logRecord(LOG_MINUTE, histKeyTime(HIST_MINUTE, minute), m.temp, m.hum);
+    // the previous hour / day is final now
+    if (hour != histNewest[HIST_HOUR] && histHourAcc.count)
+      histLogBucket(LOG_HOUR, HIST_HOUR, histNewest[HIST_HOUR], histHours[histNewest[HIST_HOUR] % HIST_HOURS]);
+    if (day != histNewest[HIST_DAY] && histDayAcc.count)
+      histLogBucket(LOG_DAY, HIST_DAY, histNewest[HIST_DAY], histDays[histNewest[HIST_DAY] % HIST_DAYS]);
+  }
+
+  if (hour != histNewest[HIST_HOUR])
+    histHourAcc = {};
+  histAdvance(histHours, HIST_HOURS, histNewest[HIST_HOUR], hour, histEmptyBucket);
+  histAccAdd(histHourAcc, m.temp, m.hum);
+  histHours[hour % HIST_HOURS] = histAccBucket(histHourAcc);
+
+  if (day != histNewest[HIST_DAY])
+    histDayAcc = {};
+  histAdvance(histDays, HIST_DAYS, histNewest[HIST_DAY], day, histEmptyBucket);
+  histAccAdd(histDayAcc, m.temp, m.hum);
+  histDays[day % HIST_DAYS] = histAccBucket(histDayAcc);
+}
+
+// called by the sampler for every good read, values x100
+void histAdd(time_t now, int16_t temp, int16_t hum)
+{
+  if (now < (time_t)HIST_VALID_AFTER || !histLock)
+    return; // no real time yet, or histBegin() hasn't started
+  uint32_t minute = (now + histOffset) / 60;
+
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  uint32_t &newest = histNewest[HIST_MINUTE];
+  if (newest != 0 && minute < newest)
+  {
+    // the clock was set back. a small step just pauses the history until it catches up
+    if (newest - minute <= HIST_MAX_REWIND)
+    {
+      xSemaphoreGive(histLock);
+      return;
+    }
+    Serial.println("[CODE] Clock went back, clearing sensor history");
+    histClear();
+  }
+
+  if (minute == histReplayed)
+  {
+    xSemaphoreGive(histLock);
+    return; // restarted within the minute the log ends with, it's closed already
+  }
+
+  if (minute != newest)
+  {
+    if (histMinuteAcc.count)
+      histCloseMinute(newest);
+    histMinuteAcc = {};
+    histAdvance(histMinutes, HIST_MINUTES, newest, minute, histEmptySample);
+  }
+  histAccAdd(histMinuteAcc, temp, hum);
+  histMinutes[minute % HIST_MINUTES] = {(int16_t)(histMinuteAcc.temp.sum / histMinuteAcc.count),
+                                        (int16_t)(histMinuteAcc.hum.sum / histMinuteAcc.count)};
+  xSemaphoreGive(histLock);
+}
+
+// ------------------------------------------ QUERIES ------------------------------------------
+
+// key is minutes / hours / days since the epoch in local time; false if the bucket has
+// no data or has already rolled out of the ring. call with histLock held
+bool histSlotMinute(uint32_t key, histsample &out)
+{
+  uint32_t newest = histNewest[HIST_MINUTE];
+  if (newest == 0 || key > newest || newest - key >= HIST_MINUTES)
+    return false;
+  out = histMinutes[key % HIST_MINUTES];
+  return out.temp != HIST_EMPTY;
+}
+
+bool histSlotBucket(uint8_t res, uint32_t key, histbucket &out)
+{
+  uint32_t newest = histNewest[res];
+  if (newest == 0 || key > newest || newest - key >= histSize[res])
+    return false;
+  out = res == HIST_HOUR ? histHours[key % HIST_HOURS] : histDays[key % HIST_DAYS];
+  return out.temp.avg != HIST_EMPTY;
+}
+
+bool histGetMinute(uint32_t key, histsample &out)
+{
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  bool ok = histSlotMinute(key, out);
+  xSemaphoreGive(histLock);
+  return ok;
+}
+
+bool histGetBucket(uint8_t res, uint32_t key, histbucket &out)
+{
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  bool ok = histSlotBucket(res, key, out);
+  xSemaphoreGive(histLock);
+  return ok;
+}
+
+// ------------------------------------------ EXPORT ------------------------------------------
+
+typedef struct
+{
+  histheader h;
+  uint32_t first; // key of the first (oldest) bucket in the export
+} histexport;
+
+size_t histExportSize(const histexport &e)
+{
+  return sizeof(histheader) + (size_t)e.h.count * e.h.stride * sizeof(int16_t);
+}
+
+// false while there is nothing to export yet
+bool histExportBegin(uint8_t res, histexport &e)
+{
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  uint32_t newest = histNewest[res];
+  xSemaphoreGive(histLock);
+  if (newest == 0)
+    return false;
+
+  e = {};
+  memcpy(e.h.magic, HIST_MAGIC, 4);
+  e.h.res = res;
+  e.h.stride = res == HIST_MINUTE ? 2 : 6;
+  e.h.count = histSize[res];
+  e.h.period = histPeriod[res];
+  e.h.newest = newest * e.h.period - histOffset;
+  e.h.scale = HIST_SCALE;
+  e.first = newest - e.h.count + 1;
+  return true;
+}
+
+// AsyncWebServer filler: bytes [index, index + maxLen) of the export. the buckets are read
+// chunk by chunk, so one that rolls out of its ring mid-transfer comes out as HIST_EMPTY
+// instead of being replaced by a newer one
+size_t histExportRead(const histexport &e, uint8_t *buf, size_t maxLen, size_t index)
+{
+  size_t total = histExportSize(e), n = 0;
+  size_t stride = e.h.stride * sizeof(int16_t);
+
+  for (; n < maxLen && index + n < sizeof(histheader); n++)
+    buf[n] = ((const uint8_t *)&e.h)[index + n];
+
+  xSemaphoreTake(histLock, portMAX_DELAY);
+  while (n < maxLen && index + n < total)
+  {
+    size_t pos = index + n - sizeof(histheader);
+    uint32_t key = e.first + pos / stride;
+    int16_t values[6];
+    if (e.h.res == HIST_MINUTE)
+    {
+      histsample s;
+      if (!histSlotMinute(key, s))
+        s = histEmptySample;
+      memcpy(values, &s, sizeof(s));
+    }
+    else
+    {
+      histbucket b;
+      if (!histSlotBucket(e.h.res, key, b))
+        b = histEmptyBucket;
+      memcpy(values, &b, sizeof(b));
+    }
+
+    size_t offset = pos % stride;
+    size_t len = min(stride - offset, min(maxLen - n, total - index - n));
+    memcpy(buf + n, (uint8_t *)values + offset, len);
+    n += len;
+  }
+  xSemaphoreGive(histLock);
+  return n;
+}
+
+// GET /history?res=minute|hour|day
+void handleHistory(AsyncWebServerRequest *request)
+{
+  uint8_t res = HIST_MINUTE;
+  forEachParam(request, [&res](uint32_t hash, AsyncWebParameter *p)
+               {
+    if (hash == paramHash("res") && p->name() == "res")
+      res = p->value() == "day" ? HIST_DAY : p->value() == "hour" ? HIST_HOUR : HIST_MINUTE; });
+
+  histexport e;
+  if (!histExportBegin(res, e))
+  {
+    request->send(503, "text/plain", "no history yet, is the clock set?");
+    return;
+  }
+  AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", histExportSize(e),
+                                                            [e](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+                                                            { return histExportRead(e, buf, maxLen, index); });
+  request->send(response);
+}
+
+// ------------------------------------------ RESTORE ------------------------------------------
+
+// logBegin() replay callback. minutes go through histCloseMinute() again, which rebuilds the
+// hours and days they cover; hour and day records fill in what's older than the minutes left
+// in the log. records come oldest sector first, but compaction moves old rollups forward, so
+// anything at or before a ring's newest key is written into its slot without moving the ring
+void histRestore(const flogrecord &r, void *ctx)
+{
+  if (r.time < HIST_VALID_AFTER)
+    return;
+  uint32_t local = r.time + histOffset;
+
+  if (r.type == LOG_MINUTE)
+  {
+    uint32_t minute = local / 60;
+    uint32_t &newest = histNewest[HIST_MINUTE];
+    if (newest != 0 && minute <= newest)
+      return;
+    histAdvance(histMinutes, HIST_MINUTES, newest, minute, histEmptySample);
+    histMinutes[minute % HIST_MINUTES] = {r.data[0], r.data[1]};
+    histCloseMinute(minute);
+    histReplayed = minute;
+  }
+  else if (r.type == LOG_HOUR || r.type == LOG_DAY)
+  {
+    uint8_t res = r.type == LOG_HOUR ? HIST_HOUR : HIST_DAY;
+    histbucket *slots = res == HIST_HOUR ? histHours : histDays;
+    uint32_t key = local / histPeriod[res];
+    histbucket b = {{r.data[0], r.data[1], r.data[2]}, {r.data[3], r.data[4], r.data[5]}};
+
+    if (histNewest[res] == 0 || key > histNewest[res])
+    {
+      histAdvance(slots, histSize[res], histNewest[res], key, histEmptyBucket);
+      if (res == HIST_HOUR)
+        histHourAcc = {};
+      else
+        histDayAcc = {};
+    }
+    else if (histNewest[res] - key >= histSize[res])
+      return;
+    slots[key % histSize[res]] = b;
+  }
+}
+
+// runs at boot while the sampler is already going: the lock is published held, so its first
+// histAdd() calls wait for the replay
+void histBegin(int32_t utcOffset)
+{
+  SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+  xSemaphoreTake(lock, portMAX_DELAY);
+  histOffset = utcOffset;
+  histClear();
+  histLock = lock;
+
+  histReplaying = true;
+  logBegin(histRestore);
+  histReplaying = false;
+  xSemaphoreGive(lock);
+}
@@ -22,6 +22,7 @@ Code Instructions: https://docs.google.com/presentation/d/1Ys43l4QkvRx-jvUKnLD3N
 #include <Arduino.h>
 #include <Wire.h>
 #include <SPI.h>
+#include "serlog.h"
 
 // ------------------------------------------ SETUP DISPLAYS ------------------------------------------
 
@@ -49,6 +50,7 @@ void drawInfoBar();
 void drawAPIWeather();
 void drawSensorData();
 void drawFace();
+void drawSparklines();
 void drawScreen();
 
 // ------------------------------------------ SETUP WIFI ------------------------------------------
@@ -59,30 +61,32 @@ void drawScreen();
 // #include <ESPAsyncWebSrv.h> // https://randomnerdtutorials.com/esp32-async-web-server-espasyncwebserver-library/ // arduino IDE version. idk why anyone would want to use arduino ide over platformio even as a beginner.
 #include <ESPAsyncWebServer.h> // https://randomnerdtutorials.com/esp32-async-web-server-espasyncwebserver-library/
 #include <Arduino_JSON.h>
+#include "params.h"
+#include "boot.h"
+#include "fmt.h"
+#include "arena.h"
 
 AsyncWebServer server(80);
 String main_processor(const String &var);
 String alarm_processor(const String &var);
 String settings_processor(const String &var);
 
-String jsonBuffer;
-String httpGETRequest(const char *serverName);
+#define HTTP_MAX_PAYLOAD 8192 // bigger or chunked responses are read through a String
+char *httpGETRequest(const char *serverName);
 
 // ------------------------------------------ SETUP INPUTS/OUTPUTS ------------------------------------------
 
-#include <DHT.h>
-#define DHT_SENSOR_PIN 27 // ESP32 pin GPIO27 connected to DHT11 sensor
-#define DHT_SENSOR_TYPE DHT22
-DHT dht_sensor(DHT_SENSOR_PIN, DHT_SENSOR_TYPE);
-float dht_temp;
-float dht_hum;
-float dht_hi;
-void readDHT();
+#include "power.h"
+#include "dhtsampler.h"
+#include "chart.h"
+#include "sparkline.h"
+#define DHT_SENSOR_PIN 27 // ESP32 pin GPIO27 connected to DHT22 sensor
+void printDHT();
 void readWeatherAPI();
 
 float temperature, windspeed;
 int pressure, humidity;
-String weather_main, weather_desc;
+char weather_main[16], weather_desc[48];
 int weather_icon;
 
 #define ONBOARD_LED 2
@@ -96,26 +100,31 @@ unsigned long button_time = 0;
 unsigned long last_button_time = 0;
 int debounce_time = 333;
 
-#include "songs.h"
-void playPiezo(void *pvParameters);
-TaskHandle_t piezoTask;
+#include "piezo.h"
 
 // -------------------------------------------- SETUP TIMEKEEPING ---------------------------------------------
 
 #include <ESP32Time.h>
 #include "time.h"
-#include "esp_sntp.h"
-const char *ntp_server1 = "pool.ntp.org";
-const char *ntp_server2 = "time.nist.gov";
-int gmt_offset = 8 * 3600; // for GMT+8
-
 ESP32Time rtc;
+#include "drift.h"
+#include "wificache.h"
+#include "wifisup.h"
+#include "timesync.h"
+#include "tz.h"
+#include "night.h"
 
-unsigned long prev_wifi_millis = 0;
 unsigned long prev_temphum_millis = 0;
 unsigned long prev_time_millis = 0;
 unsigned long prev_display_millis = 0;
 
+#define BOOT_SPLASH_MS 5000
+unsigned long bootSplashMillis = 0;
+bool booting = true;         // bootStep() still has work to do
+bool bootConnecting = false; // "Connecting" is on the OLED
+bool wasOnline = false;      // what the screen last showed
+volatile bool storageFailed = false;
+
 typedef struct
 {
   int repeats;  // 0:daily; 1:weekly; 2:never
@@ -127,9 +136,7 @@ typedef struct
 alarminfo alarmData[10]; // allow ten alarms
 int numAlarms = 0;
 int currSong = 0;
-void printTM(tm t);
-String getDay(int d);
-String padZeros(int t);
+time_t nextAlarm(time_t utc);
 
 // ------------------------------------------ SETUP MEMORY/VARIABLES ------------------------------------------
 
@@ -137,27 +144,32 @@ String padZeros(int t);
 #include <Preferences.h>
 Preferences preferences;
 
-char charbuf[1000];
 String ssid, password;
-String espmac;
-String getESPMac();
+char espmac[18];
+void getESPMac(char *out);
 
-String serverPath;
+char serverPath[200];
 String city = "George Town", countryCode = "MY", openWeatherMapApiKey = "";
 
 // ------------------------------------------ SETUP FUNCTION ------------------------------------------
 
+void bootStorage(void *pvParameters);
+
 void setup()
 {
   Serial.begin(115200);
-  espmac = getESPMac();
+  slogBegin();
+  bootBegin();
+  arenaBegin();
+  getESPMac(espmac);
 
   pinMode(ONBOARD_LED, OUTPUT);
   pinMode(BUZZER_PIN, OUTPUT);
   pinMode(BUTTON_PIN, INPUT);
+  powerBegin(BUTTON_PIN);
+  piezoBegin();
 
   digitalWrite(ONBOARD_LED, LOW);
-  dht_sensor.begin();
 
   segdisplay.clear();
   segdisplay.setBrightness(segBrightness);
@@ -169,12 +181,24 @@ void setup()
       SEG_A | SEG_B | SEG_C | SEG_D};
   segdisplay.setSegments(hi);
 
-  sntp_set_time_sync_notification_cb([](struct timeval *t)
-                                     { Serial.println("[TIME] Got time adjustment from NTP!"); });
-  sntp_servermode_dhcp(1);
-
-  configTime(gmt_offset, 0, ntp_server1, ntp_server2);
-
+  tzBegin();
+  nightBegin();
+  driftBegin();
+  wifiBegin();
+  wifiSupBegin();
+  dhtBegin(DHT_SENSOR_PIN); // its first reads wait for the history replay
+
+  // SPIFFS, preferences and the history replay, while the display and WiFi come up
+  xTaskCreatePinnedToCore(
+      bootStorage,    /* Task function. */
+      "Boot Storage", /* name of task. */
+      4096,           /* Stack size of task */
+      NULL,           /* parameter of the task */
+      1,              /* priority of the task */
+      NULL,           /* Task handle to keep track of created task */
+      0);             /* pin task to core 0 */
+
+  bootStart(BOOT_DISPLAY);
   // SSD1306_SWITCHCAPVCC = generate display voltage from 3.3V internally
   if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C))
   {
@@ -187,114 +211,12 @@ void setup()
   display.setTextSize(1);
   display.setTextColor(WHITE); // Draw white text
 
-  // show CEC splash screen
+  // show CEC splash screen, bootStep() takes it down
   display.clearDisplay();
   display.drawBitmap(0, 0, bitmap_cec, 128, 64, 1);
   display.display();
-  delay(5000);
-
-  // Initialize SPIFFS
-  if (!SPIFFS.begin(true))
-  {
-    display.clearDisplay();
-    display.println("An Error has occurred while mounting SPIFFS");
-    display.display();
-    for (;;)
-      ; // loop forever
-  }
-
-  preferences.begin("pref-mem", false);
-  ssid = preferences.getString("ssid");
-  password = preferences.getString("pwd");
-  openWeatherMapApiKey = preferences.getString("apikey");
-  city = preferences.getString("city");
-  countryCode = preferences.getString("ccode");
-
-  if (city.length() == 0) {
-    city = "George Town";
-    preferences.putString("city", city);
-  }
-  if (countryCode.length() == 0) {
-    countryCode = "MY";
-    preferences.putString("ccode", countryCode);
-  }
-
-  size_t alarmLen = preferences.getBytesLength("alarm");
-  if (alarmLen == 0 || alarmLen % sizeof(alarminfo) || alarmLen > sizeof(alarmData))
-  {
-    Serial.print("[CODE] Invalid size of alarm array: ");
-    Serial.println(alarmLen);
-  }
-  else
-  {
-    preferences.getBytes("alarm", alarmData, alarmLen);
-    Serial.println("[CODE]: Read the following alarms: ");
-    for (int i = 0; i < (alarmLen / sizeof(alarminfo)); i++)
-    {
-      if (alarmData[i].song != 0)
-      {
-        Serial.print("Time: ");
-        printTM(alarmData[i].alarmTime);
-        Serial.print(" | Repeats: ");
-        Serial.print(alarmData[i].repeats);
-        Serial.print(" | Song: ");
-        Serial.println(alarmData[i].song);
-        numAlarms += 1;
-      }
-    }
-  }
-
-  // try connecting first; if waited 60sec then open wifi connect
-  if (ssid.length() != 0)
-  {
-    prev_wifi_millis = millis();
-    WiFi.mode(WIFI_AP_STA);
-    WiFi.begin(ssid, password);
-
-    display.clearDisplay();
-    display.setCursor(0, 0);
-    display.print("Connecting");
-    display.display();
-
-    while ((millis() - prev_wifi_millis < 60000) && (WiFi.status() != WL_CONNECTED) && (digitalRead(BUTTON_PIN) == NOT_PRESSED))
-    {
-      delay(500);
-      display.print(".");
-      display.display();
-    }
-  }
-
-  if (WiFi.status() != WL_CONNECTED)
-  {
-    WiFi.mode(WIFI_AP);
-
-    IPAddress apIP = IPAddress(192, 168, 4, 1);
-    WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
-    // https://github.com/espressif/arduino-esp32/issues/1832
-
-    WiFi.softAP(espmac);
-
-    IPAddress IP = WiFi.softAPIP();
-    Serial.print("[WIFI] AP IP address: ");
-    Serial.println(IP);
-  }
-  else
-  {
-    Serial.print("[WIFI] Connected to WiFi network with IP Address: ");
-    Serial.println(WiFi.localIP());
-
-    // update RTC
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo))
-      rtc.setTimeStruct(timeinfo);
-  }
-  readDHT();
-  readWeatherAPI();
-
-  display.clearDisplay();
-  drawInfoBar();
-  drawAPIWeather();
-  display.display();
+  bootSplashMillis = millis();
+  bootDone(BOOT_DISPLAY);
 
   // Route for root / web page
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
@@ -308,17 +230,19 @@ void setup()
 
   server.on("/init", HTTP_GET, [](AsyncWebServerRequest *request)
             {
-    if (request->hasParam("name") && request->hasParam("pwd")) {
-      String inputName = request->getParam("name")->value();
-      String inputPwd = request->getParam("pwd")->value();
+    initparams q;
+    parseInitParams(request, q);
+
+    if (q.has(INIT_NAME | INIT_PWD)) {
+      const String &inputName = *q.name;
+      const String &inputPwd = *q.pwd;
       
       if (inputName.length() || inputPwd.length()) {
-        sprintf(charbuf, "%s - %s", inputName, inputPwd);
-        Serial.println(charbuf);
+        SLOGI("[CODE] Received SSID: %s", inputName); // never the password
 
         if (ssid != inputName) preferences.putString("ssid", inputName);
         if (password != inputPwd) preferences.putString("pwd", inputPwd);
-        Serial.println("[CODE] Updated SSID & pwd in preferences");
+        SLOGI("[CODE] Updated SSID & pwd in preferences");
 
         display.clearDisplay();
         display.setCursor(0, 0);
@@ -331,25 +255,21 @@ void setup()
       }
     }
 
-    if (request->hasParam("apikey")) {
-      String inputApiKey = request->getParam("apikey")->value();
+    if (q.has(INIT_APIKEY)) {
+      const String &inputApiKey = *q.apikey;
       if (inputApiKey.length() && openWeatherMapApiKey != inputApiKey) {
-        Serial.print("[CODE] Received API Key: "); 
-        Serial.println(inputApiKey);
+        SLOGI("[CODE] Received API Key: %s", inputApiKey);
 
         openWeatherMapApiKey = inputApiKey;
         preferences.putString("apikey", inputApiKey);
       }
     }
 
-    if (request->hasParam("city") && request->hasParam("ccode")) {
-      String inputCity = request->getParam("city")->value();
-      String inputCCode = request->getParam("ccode")->value();
+    if (q.has(INIT_CITY | INIT_CCODE)) {
+      const String &inputCity = *q.city;
+      const String &inputCCode = *q.ccode;
       if (inputCity.length() && inputCCode.length()) {
-        Serial.print("[CODE] Received Location: "); 
-        Serial.print(inputCity);
-        Serial.print(", ");
-        Serial.println(inputCCode);
+        SLOGI("[CODE] Received Location: %s, %s", inputCity, inputCCode);
 
         city = inputCity;
         countryCode = inputCCode;
@@ -360,29 +280,45 @@ void setup()
       }
     }
 
-    if (request->hasParam("time")) {
-      String inputTime = request->getParam("time")->value();
+    if (q.has(INIT_TIME)) {
+      const String &inputTime = *q.time;
       if (inputTime.length() == 10) {
-        Serial.print("[CODE] Received time: ");
-        Serial.println(inputTime);
+        SLOGI("[CODE] Received time: %s", inputTime);
         
         // reset time
         rtc.setTime(inputTime.toInt());
+        driftReference((int64_t)inputTime.toInt() * 1000000, DRIFT_BROWSER);
       }
       else {
-        Serial.println("[CODE] Epoch time is not 10 digits, weird...");
+        SLOGW("[CODE] Epoch time is not 10 digits, weird...");
       }
     }
 
-    if (request->hasParam("repeats") && request->hasParam("alarmtime") && request->hasParam("song")) {
-      int inputRepeats = (request->getParam("repeats")->value()).toInt();
-      String inputAlarm = request->getParam("alarmtime")->value();
-      int inputSong = (request->getParam("song")->value()).toInt();
+    if (q.has(INIT_TZ)) {
+      if (tzSelect(q.tz->c_str())) {
+        SLOGI("[CODE] Time zone set to %s", tzZone->name);
+      }
+      else {
+        SLOGW("[CODE] Unknown time zone, ignored");
+      }
+    }
+
+    if (q.has(INIT_NIGHT)) {
+      if (nightSet(q.night->c_str())) {
+        SLOGI("[CODE] Night mode: %s", q.night->length() ? q.night->c_str() : "off");
+      }
+      else {
+        SLOGW("[CODE] Night mode times aren't HH:MM-HH:MM, ignored");
+      }
+    }
+
+    if (q.has(INIT_REPEATS | INIT_ALARMTIME | INIT_SONG)) {
+      int inputRepeats = q.repeats;
+      const String &inputAlarm = *q.alarmtime;
+      int inputSong = q.song;
 
       if (inputAlarm.length()) {
-        sprintf(charbuf, "[CODE] Received type %d alarm (%d): ", inputRepeats, inputSong);
-        Serial.print(charbuf);
-        Serial.println(inputAlarm);
+        SLOGI("[CODE] Received type %d alarm (%d): %s", inputRepeats, inputSong, inputAlarm);
 
         // append in array
         alarminfo newAlarm = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, false};
@@ -411,8 +347,8 @@ void setup()
       }
     }
 
-    if (request->hasParam("alarmdel")) {
-      int del = (request->getParam("alarmdel")->value()).toInt();
+    if (q.has(INIT_ALARMDEL)) {
+      int del = q.alarmdel;
       
       for (int i=0; i<10; i++) {
         if (alarmData[i].song != 0) {
@@ -426,8 +362,27 @@ void setup()
       numAlarms = max(numAlarms-1, 0);
       preferences.putBytes("alarm", alarmData, sizeof(alarmData));
 
-      sprintf(charbuf, "[CODE] Deleted %d alarm, %d remaining", del, numAlarms);
-      Serial.println(charbuf);
+      SLOGI("[CODE] Deleted %d alarm, %d remaining", del, numAlarms);
+    }
+
+    if (q.has(INIT_TUNEDEL)) {
+      int song = CUSTOM_SONG_BASE + q.tunedel;
+      if (piezoPlaying(song))
+        piezoStop();
+      bool deleted = deleteTune(q.tunedel);
+      SLOGI("[CODE] Deleted tune %d: %s", q.tunedel, deleted ? "yes" : "no");
+
+      // alarms on it would ring silently, or with whatever gets uploaded into the slot next
+      int moved = 0;
+      for (int i = 0; i < 10; i++)
+        if (deleted && alarmData[i].song == song) {
+          alarmData[i].song = -1;
+          moved++;
+        }
+      if (moved) {
+        preferences.putBytes("alarm", alarmData, sizeof(alarmData));
+        SLOGI("[CODE] %d alarms on tune %d now play a random song", moved, q.tunedel);
+      }
     }
 
     request->send(200, "text/plain", "OK"); });
@@ -436,124 +391,332 @@ void setup()
   server.on("/gpio", HTTP_GET, [](AsyncWebServerRequest *request)
             {
     // GET input1 value on <ESP_IP>/gpio?output=<inputMessage1>&state=<inputMessage2>
-    if (request->hasParam("output") && request->hasParam("state")) {
-      int inputPin = (request->getParam("output")->value()).toInt();
-      int inputState = (request->getParam("state")->value()).toInt();
+    gpioparams q;
+    parseGpioParams(request, q);
+
+    if (q.has(GPIO_OUTPUT | GPIO_STATE)) {
+      int inputPin = q.output;
+      int inputState = q.state;
       digitalWrite(inputPin, inputState);
 
-      sprintf(charbuf, "[GPIO] %d - Set to: %d - Running on Core %d", inputPin, inputState, xPortGetCoreID());
-      Serial.println(charbuf);
+      SLOGI("[GPIO] %d - Set to: %d - Running on Core %d", inputPin, inputState, xPortGetCoreID());
     }
 
-    if (request->hasParam("song")) {
-      int inputSong = (request->getParam("song")->value()).toInt();
-      currSong = 0;
-      xTaskCreatePinnedToCore(
-        playPiezo,    /* Task function. */
-        "Play Piezo", /* name of task. */
-        10000,         /* Stack size of task */
-        (void*)inputSong,         /* parameter of the task */
-        0,            /* priority of the task */
-        &piezoTask,   /* Task handle to keep track of created task */
-        0);           /* pin task to core 0 */
-    }
+    if (q.has(GPIO_SONG))
+      piezoPreview(q.song);
 
     request->send(200, "text/plain", "OK"); });
 
+  // custom ringtones, multipart upload of an RTTTL or binary tune file
+  server.on("/tune", HTTP_POST, handleTuneDone, handleTuneUpload);
+
+  // binary export of the sensor history, see history.h for the layout
+  server.on("/history", HTTP_GET, handleHistory);
+
+  // downsampled temperature / humidity for the chart on the main page
+  server.on("/chart", HTTP_GET, handleChart);
+
   server.on("/slider", HTTP_GET, [](AsyncWebServerRequest *request)
             {
-    String inputMessage;
     // GET input1 value on <ESP_IP>/slider?value=<inputMessage>
-    if (request->hasParam("value")) {
-      int sliderval = (request->getParam("value")->value()).toInt();
+    int sliderval;
+    if (parseSliderValue(request, sliderval)) {
       segBrightness = sliderval;
       segdisplay.setBrightness(sliderval);
-      sprintf(charbuf, "[GPIO] Set 7seg brightness to %d", sliderval);
-      Serial.println(charbuf);
+      SLOGI("[GPIO] Set 7seg brightness to %d", sliderval);
     }
     request->send(200, "text/plain", "OK"); });
 
+  // when each boot phase started and finished
+  server.on("/boot", HTTP_GET, handleBoot);
+
+  // WiFi connect time histograms
+  server.on("/wifistats", HTTP_GET, handleWifiStats);
+
+  // nearby networks for the settings page, from the background scan
+  server.on("/scan", HTTP_GET, handleScan);
+
+  // time loop() spent working vs idle
+  server.on("/power", HTTP_GET, handlePower);
+
+  // per-task arena use, see arena.h
+  server.on("/arena", HTTP_GET, handleArena);
+
   server.onNotFound([](AsyncWebServerRequest *request)
                     { request->redirect("/"); });
 
-  server.begin();
-  Serial.println("[WIFI] HTTP server started");
-
+  ntpBegin();
   attachInterrupt(BUTTON_PIN, isr, FALLING);
+  powerArmButton();
+}
+
+// runs once at boot on core 0, storage doesn't wait for the display or the network
+void bootStorage(void *pvParameters)
+{
+  bootStart(BOOT_STORAGE);
+  // Initialize SPIFFS
+  if (!SPIFFS.begin(true))
+  {
+    storageFailed = true; // loop() shows it
+    vTaskDelete(NULL);
+  }
+
+  preferences.begin("pref-mem", false);
+  ssid = preferences.getString("ssid");
+  password = preferences.getString("pwd");
+  openWeatherMapApiKey = preferences.getString("apikey");
+  city = preferences.getString("city");
+  countryCode = preferences.getString("ccode");
+
+  if (city.length() == 0) {
+    city = "George Town";
+    preferences.putString("city", city);
+  }
+  if (countryCode.length() == 0) {
+    countryCode = "MY";
+    preferences.putString("ccode", countryCode);
+  }
+
+  size_t alarmLen = preferences.getBytesLength("alarm");
+  if (alarmLen == 0 || alarmLen % sizeof(alarminfo) || alarmLen > sizeof(alarmData))
+  {
+    SLOGW("[CODE] Invalid size of alarm array: %u", alarmLen);
+  }
+  else
+  {
+    preferences.getBytes("alarm", alarmData, alarmLen);
+    SLOGI("[CODE]: Read the following alarms: ");
+    for (int i = 0; i < (alarmLen / sizeof(alarminfo)); i++)
+    {
+      if (alarmData[i].song != 0)
+      {
+        const alarminfo &a = alarmData[i];
+        SLOGI("Time: %d/%d/%d (%s), %02d:%02d:%02d | Repeats: %d | Song: %d", a.alarmTime.tm_mday, a.alarmTime.tm_mon + 1, a.alarmTime.tm_year + 1900,
+              fmtDay(a.alarmTime.tm_wday), a.alarmTime.tm_hour, a.alarmTime.tm_min, a.alarmTime.tm_sec, a.repeats, a.song);
+        numAlarms += 1;
+      }
+    }
+  }
+  bootDone(BOOT_STORAGE);
+
+  bootStart(BOOT_HISTORY);
+  histBegin(tzZone->standard * 60); // DST doesn't move the history's days
+  bootDone(BOOT_HISTORY);
+  vTaskDelete(NULL);
+}
+
+// the boot phases that belong to loop(), one non-blocking step per call. false once done
+bool bootStep()
+{
+  if (storageFailed)
+  {
+    display.clearDisplay();
+    display.setCursor(0, 0);
+    display.println("An Error has occurred while mounting SPIFFS");
+    display.display();
+    for (;;)
+      ; // loop forever
+  }
+
+  // try connecting first; if waited 60sec (or the button was pressed) the supervisor opens wifi connect
+  if (!bootStarted(BOOT_WIFI) && bootReady(1 << BOOT_STORAGE))
+  {
+    bootStart(BOOT_WIFI);
+    wifiSupervise(ssid, password, espmac);
+  }
+  else if (bootStarted(BOOT_WIFI) && !bootReady(1 << BOOT_WIFI))
+  {
+    if (xEventGroupGetBits(wifiEvents) & (WIFI_EV_ONLINE | WIFI_EV_AP))
+      bootDone(BOOT_WIFI);
+    else if (buttonPressed && currSong == 0)
+    {
+      buttonPressed = false;
+      wifiRequestAP();
+    }
+  }
+
+  // the server starts as soon as its files and data are there and an interface is up
+  if (!bootStarted(BOOT_WEB) && bootReady(1 << BOOT_STORAGE | 1 << BOOT_HISTORY | 1 << BOOT_WIFI))
+  {
+    bootStart(BOOT_WEB);
+    server.begin();
+    Serial.println("[WIFI] HTTP server started");
+    bootDone(BOOT_WEB);
+  }
+
+  // OLED: splash, then "Connecting...", then the first real screen
+  if (millis() - bootSplashMillis < BOOT_SPLASH_MS || currSong != 0)
+    return true;
+  if (!bootReady(1 << BOOT_WIFI))
+  {
+    if (millis() - prev_display_millis >= 500)
+    {
+      if (!bootConnecting)
+      {
+        bootConnecting = true;
+        display.clearDisplay();
+        display.setCursor(0, 0);
+        display.print("Connecting");
+      }
+      else
+        display.print(".");
+      display.display();
+      prev_display_millis = millis();
+    }
+    return true;
+  }
+  if (!bootReady(BOOT_ALL))
+    return true;
+
+  readWeatherAPI();
+  wasOnline = wifiOnline();
+
+  display.clearDisplay();
+  drawInfoBar();
+  drawAPIWeather();
+  display.display();
+  prev_display_millis = millis();
+
+  bootPrint();
+  return false;
 }
 
 // ------------------------------------------ LOOP FUNCTION ------------------------------------------
 
 // which interface should be displayed currently
 int display_state = 0;
+#define NUM_SCREENS 4
+
+// how long loop() can block before one of its timers is due
+uint32_t loopIdleMs()
+{
+  if (booting)
+    return POWER_BOOT_POLL_MS; // bootStep() polls
+  const unsigned long last[] = {prev_time_millis, prev_temphum_millis, prev_display_millis};
+  const uint32_t every[] = {1000, 60 * 1000, currSong == 0 ? 60 * 1000U : 0U};
+  return powerNextMs(millis(), last, every, 3);
+}
+
+// dark inside the night window, back up for the button, an alarm or the morning
+void nightStep()
+{
+  if (booting)
+    return;
+  time_t utc = time(NULL);
+  bool dark = nightDark(tzNow(), utc, nextAlarm(utc), currSong != 0, buttonPressed);
+  if (dark == nightActive)
+    return;
+
+  nightActive = dark;
+  prev_time_millis = 0; // 7-seg brightness and colon change with its next update, which is now
+  if (dark)
+  {
+    SLOGI("[CODE] Night mode, going dark");
+    display.ssd1306_command(SSD1306_DISPLAYOFF);
+    segdisplay.setBrightness(NIGHT_SEG_BRIGHTNESS);
+    wifiPause(true);
+  }
+  else
+  {
+    SLOGI("[CODE] Night mode, waking up");
+    segdisplay.setBrightness(segBrightness);
+    wifiPause(false);
+
+    display_state = 0;
+    display.clearDisplay();
+    drawInfoBar();
+    drawScreen();
+    display.display();
+    display.ssd1306_command(SSD1306_DISPLAYON);
+    prev_display_millis = millis();
+  }
+}
 
 void loop()
 {
+  if (booting)
+    booting = bootStep();
+  nightStep();
+
   // update 7seg every second
   if (millis() - prev_time_millis > 1 * 1000)
   {
+    tm now = tzNow();
     segdisplay.showNumberDecEx(
-        100 * rtc.getHour(1) + rtc.getMinute(),
-        (rtc.getSecond() % 2 ? 0b01000000 : 0b00000000),
+        100 * now.tm_hour + now.tm_min,
+        (nightActive || now.tm_sec % 2 ? 0b01000000 : 0b00000000), // no blinking at night, it sleeps a minute
         true, 4, 0);
-    Serial.print("[CODE] RTC Time: ");
-    printTM(rtc.getTimeStruct());
-    Serial.println();
+    if (!bootReady(1 << BOOT_CLOCK))
+      bootDone(BOOT_CLOCK);
+    SLOGD("[CODE] RTC Time: %d/%d/%d (%s), %02d:%02d:%02d", now.tm_mday, now.tm_mon + 1, now.tm_year + 1900, fmtDay(now.tm_wday),
+          now.tm_hour, now.tm_min, now.tm_sec);
 
-    if (currSong == 0) // if nothing is playing now
+    if (currSong == 0 && bootReady(1 << BOOT_STORAGE)) // if nothing is playing now
     {
       for (int i = 0; i < numAlarms; i++)
       {
         alarminfo a = alarmData[i];
         if (a.song != 0 && !a.rang)
         {
-          bool isTime = a.alarmTime.tm_hour == rtc.getHour(1) && a.alarmTime.tm_min == rtc.getMinute();
+          bool isTime = a.alarmTime.tm_hour == now.tm_hour && a.alarmTime.tm_min == now.tm_min;
 
           if (a.repeats == 1)
-            isTime = (isTime && a.alarmTime.tm_wday == rtc.getDayofWeek());
+            isTime = (isTime && a.alarmTime.tm_wday == now.tm_wday);
           if (a.repeats == 2)
-            isTime = (isTime && a.alarmTime.tm_mday == rtc.getDay() && a.alarmTime.tm_mon == rtc.getMonth() && a.alarmTime.tm_year == (rtc.getYear() - 1900));
+            isTime = (isTime && a.alarmTime.tm_mday == now.tm_mday && a.alarmTime.tm_mon == now.tm_mon && a.alarmTime.tm_year == now.tm_year);
 
           if (isTime) // current time == alarm time
           {
             if (a.song == -1)
-              currSong = (int)random(3);
+              currSong = (int)random(1, 4);
             else
               currSong = a.song;
-            rand();
             alarmData[i].rang = true;
-            xTaskCreatePinnedToCore(
-                playPiezo,    /* Task function. */
-                "Play Piezo", /* name of task. */
-                10000,        /* Stack size of task */
-                NULL,         /* parameter of the task */
-                0,            /* priority of the task */
-                &piezoTask,   /* Task handle to keep track of created task */
-                0);           /* pin task to core 0 */
+            piezoLoopSong(currSong);
+            logRecord(LOG_ALARM, time(NULL), i, currSong);
           }
         }
       }
     }
 
-    if (rtc.getHour(1) == 0 && rtc.getMinute() == 0)
+    if (now.tm_hour == 0 && now.tm_min == 0)
       for (int i = 0; i < 10; i++)
         alarmData[i].rang = false;
 
     prev_time_millis = millis();
   }
 
+  wifiRssiTick();
+
   // Update temperature & humidity data, from local and from api every min
-  if (millis() - prev_temphum_millis > 60 * 1000)
+  if (!booting && millis() - prev_temphum_millis > 60 * 1000)
   {
-    readDHT();
+    printDHT();
+    sparkUpdate();
+    driftTick();
+    wifiTick();
     readWeatherAPI();
     prev_temphum_millis = millis();
   }
 
+  // connection came or went: new weather and screen now rather than in a minute
+  bool online = wifiOnline();
+  if (!booting && !nightActive && online != wasOnline && currSong == 0)
+  {
+    wasOnline = online;
+    if (online)
+      readWeatherAPI();
+
+    display.clearDisplay();
+    drawInfoBar();
+    drawScreen();
+    display.display();
+  }
+
   // update OLED every minute
-  if (millis() - prev_display_millis > 60 * 1000 && currSong == 0)
+  if (!booting && !nightActive && millis() - prev_display_millis > 60 * 1000 && currSong == 0)
   {
-    display_state = (display_state + 1) % 3;
+    display_state = (display_state + 1) % NUM_SCREENS;
 
     display.clearDisplay();
     drawInfoBar();
@@ -572,17 +735,16 @@ void loop()
     display.display();
   }
 
-  if (buttonPressed)
+  if (buttonPressed && (!booting || currSong != 0))
   {
-    Serial.println("[CODE] Button pressed, yay");
+    SLOGI("[CODE] Button pressed, yay");
     buttonPressed = false;
 
     if (currSong != 0)
     {
-      vTaskDelete(piezoTask);
-      piezoTask = NULL;
+      piezoStop();
       currSong = 0;
-      Serial.println("[CODE] Stopped piezo");
+      SLOGI("[CODE] Stopped piezo");
 
       display_state = 0;
       display.clearDisplay();
@@ -593,7 +755,7 @@ void loop()
     }
     else
     {
-      display_state = (display_state + 1) % 3;
+      display_state = (display_state + 1) % NUM_SCREENS;
 
       display.clearDisplay();
       drawInfoBar();
@@ -603,10 +765,17 @@ void loop()
       prev_display_millis = millis();
     }
   }
+
+  // nothing to do until the next deadline, the button wakes us earlier
+  if (!nightActive)
+    powerIdle(loopIdleMs());
+  else if (powerSleep(nightMsToMinute()))
+    buttonPressed = true; // the ISR doesn't see a press that woke us
+
 }
 
 // ------------------------------------------ HELPER FUNCTIONS ------------------------------------------
-String getESPMac()
+void getESPMac(char *out)
 {
   unsigned char mac_base[6] = {0};
   esp_efuse_mac_get_default(mac_base);
@@ -616,53 +785,51 @@ String getESPMac()
   unsigned char mac_uni_base[6] = {0};
   esp_derive_local_mac(mac_local_base, mac_uni_base);
 
-  char macstring[20];
-  sprintf(macstring, "%02X:%02X:%02X:%02X:%02X:%02X", mac_base[0], mac_base[1], mac_base[2], mac_base[3], mac_base[4], mac_base[5]);
+  fmtMac(out, mac_base);
 
-  sprintf(charbuf, "[CODE] ESP MAC Address: %s", macstring);
-  Serial.println(charbuf);
-
-  return String(macstring);
+  SLOGI("[CODE] ESP MAC Address: %s", out);
 }
 
-void printTM(tm t)
+// when the next alarm rings, UTC, 0 if there's none
+time_t nextAlarm(time_t utc)
 {
-  sprintf(charbuf, "%d/%d/%d (%s), %s:%s:%s", t.tm_mday, t.tm_mon + 1, t.tm_year + 1900, getDay(t.tm_wday), padZeros(t.tm_hour), padZeros(t.tm_min), padZeros(t.tm_sec));
-  Serial.print(charbuf);
-}
-
-String padZeros(int t)
-{
-  if (t < 10)
-    return ("0" + String(t));
-  else
-    return String(t);
-}
-
-String getDay(int d)
-{
-  switch (d)
+  time_t local = tzLocal(utc), next = 0;
+  tm today;
+  gmtime_r(&local, &today);
+  for (int i = 0; i < numAlarms; i++)
   {
-  case 0:
-    return "Sunday";
-  case 1:
-    return "Monday";
-  case 2:
-    return "Tuesday";
-  case 3:
-    return "Wednesday";
-  case 4:
-    return "Thursday";
-  case 5:
-    return "Friday";
-  case 6:
-    return "Saturday";
-  default:
-    return "lol?";
+    const alarminfo &a = alarmData[i];
+    if (a.song == 0)
+      continue;
+    tm t = today;
+    t.tm_hour = a.alarmTime.tm_hour;
+    t.tm_min = a.alarmTime.tm_min;
+    t.tm_sec = 0;
+    if (a.repeats == 1)
+      t.tm_mday += (a.alarmTime.tm_wday - today.tm_wday + 7) % 7;
+    if (a.repeats == 2)
+    {
+      t.tm_mday = a.alarmTime.tm_mday;
+      t.tm_mon = a.alarmTime.tm_mon;
+      t.tm_year = a.alarmTime.tm_year;
+    }
+    time_t at = mktime(&t); // no TZ is set, so this is local time as if it were UTC
+    if (a.rang || at + 60 <= local)
+    {
+      if (a.repeats == 2)
+        continue;
+      at += a.repeats == 1 ? 7 * 86400 : 86400;
+    }
+    at -= tzOffset(at - tzOffset(utc));
+    if (!next || at < next)
+      next = at;
   }
+  return next;
 }
 
-String httpGETRequest(const char *serverName)
+// GETs serverName into a buffer from the calling task's arena (see arena.h), NULL if it
+// failed. hand it back with arenaFree()
+char *httpGETRequest(const char *serverName)
 {
   WiFiClient client;
   HTTPClient http;
@@ -673,18 +840,29 @@ String httpGETRequest(const char *serverName)
   // Send HTTP POST request
   int httpResponseCode = http.GET();
 
-  String payload = "{}";
+  char *payload = NULL;
 
   if (httpResponseCode > 0)
   {
-    Serial.print("[WIFI] HTTP Response code: ");
-    Serial.println(httpResponseCode);
-    payload = http.getString();
+    SLOGI("[WIFI] HTTP Response code: %d", httpResponseCode);
+    int len = http.getSize();
+    if (len >= 0 && len < HTTP_MAX_PAYLOAD)
+    {
+      payload = (char *)arenaAlloc(len + 1);
+      if (payload)
+        payload[http.getStream().readBytes(payload, len)] = 0;
+    }
+    else
+    {
+      String body = http.getString();
+      payload = (char *)arenaAlloc(body.length() + 1);
+      if (payload)
+        memcpy(payload, body.c_str(), body.length() + 1);
+    }
   }
   else
   {
-    Serial.print("[WIFI] Error code: ");
-    Serial.println(httpResponseCode);
+    SLOGW("[WIFI] Error code: %d", httpResponseCode);
   }
   // Free resources
   http.end();
@@ -692,13 +870,17 @@ String httpGETRequest(const char *serverName)
   return payload;
 }
 
+// the template processors have to return a String, so each placeholder builds one: sized up
+// front with reserve(), then only appended to, from pieces formatted on the stack
+
 String main_processor(const String &var)
 {
   if (var == "BUTTONPLACEHOLDER")
   {
-    String buttons = "";
-    buttons += "<h4>ESP32 Blue On Board LED</h4><label class=\"switch\"><input type=\"checkbox\" onchange=\"toggleCheckbox(this)\" id=\"2\" " + (digitalRead(ONBOARD_LED) ? String("checked") : String("")) + "><span class=\"switchslider\"></span></label>";
-    return buttons;
+    char buttons[200];
+    sprintf(buttons, "<h4>ESP32 Blue On Board LED</h4><label class=\"switch\"><input type=\"checkbox\" onchange=\"toggleCheckbox(this)\" id=\"2\" %s><span class=\"switchslider\"></span></label>",
+            digitalRead(ONBOARD_LED) ? "checked" : "");
+    return String(buttons);
   }
 
   if (var == "APIKEYPLACEHOLDER")
@@ -719,31 +901,57 @@ String alarm_processor(const String &var)
   }
   if (var == "ALARMSPLACEHOLDER")
   {
-    String currAlarms = "<div id=\"alarmlist\">";
+    String currAlarms;
+    currAlarms.reserve(32 + numAlarms * 150);
+    currAlarms += "<div id=\"alarmlist\">";
+    char line[160], when[32], song[12];
     for (int i = 0; i < (sizeof(alarmData) / sizeof(alarminfo)); i++)
     {
       if (alarmData[i].song != 0)
       {
-        currAlarms += "<div>";
-
-        tm alarmtime = alarmData[i].alarmTime;
+        const tm &alarmtime = alarmData[i].alarmTime;
         int rep = alarmData[i].repeats; // 0:daily; 1:weekly; 2:never
+        int n = sprintf(when, "%02d:%02d", alarmtime.tm_hour, alarmtime.tm_min);
         if (rep == 0)
-          currAlarms += padZeros(alarmtime.tm_hour) + ":" + padZeros(alarmtime.tm_min) + " every day";
+          strcpy(when + n, " every day");
         if (rep == 1)
-          currAlarms += padZeros(alarmtime.tm_hour) + ":" + padZeros(alarmtime.tm_min) + " every " + getDay(alarmtime.tm_wday);
+          sprintf(when + n, " every %s", fmtDay(alarmtime.tm_wday));
         if (rep == 2)
-          currAlarms += padZeros(alarmtime.tm_hour) + ":" + padZeros(alarmtime.tm_min) + " on " + padZeros(alarmtime.tm_mday) + "/" + padZeros(alarmtime.tm_mon + 1) + "/" + String(alarmtime.tm_year + 1900);
-
-        currAlarms += "&nbsp;(Song: " + (alarmData[i].song == -1 ? "Random" : String(alarmData[i].song)) + ")&nbsp;";
-        currAlarms += "<button type=\"submit\" onclick=\"deleteAlarm(" + String(i) + ")\">Delete</button>";
-        currAlarms += "</div>";
+          sprintf(when + n, " on %02d/%02d/%d", alarmtime.tm_mday, alarmtime.tm_mon + 1, alarmtime.tm_year + 1900);
+
+        if (alarmData[i].song == -1)
+          strcpy(song, "Random");
+        else
+          sprintf(song, "%d", alarmData[i].song);
+        sprintf(line, "<div>%s&nbsp;(Song: %s)&nbsp;<button type=\"submit\" onclick=\"deleteAlarm(%d)\">Delete</button></div>", when, song, i);
+        currAlarms += line;
       }
     }
     currAlarms += "</div>";
 
     return currAlarms;
   }
+  if (var == "TUNEOPTIONS" || var == "TUNEBUTTONS" || var == "TUNELIST")
+  {
+    String tunes;
+    tunes.reserve(TUNE_SLOTS * (TUNE_NAME_LEN + 80));
+    char raw[TUNE_NAME_LEN + 1], name[TUNE_NAME_LEN * 6 + 1], line[sizeof(name) + 100];
+    for (int slot = 1; slot <= TUNE_SLOTS; slot++)
+    {
+      if (!tuneName(slot, raw))
+        continue;
+      fmtHtml(name, raw); // named after the uploaded file, anything can be in there
+      int song = CUSTOM_SONG_BASE + slot;
+      if (var == "TUNEOPTIONS")
+        sprintf(line, "<option value=\"%d\">%s</option>", song, name);
+      else if (var == "TUNEBUTTONS")
+        sprintf(line, "<button type=\"submit\" onclick=\"testAlarm(%d)\">%s</button>\n", song, name);
+      else
+        sprintf(line, "<div>%s&nbsp;<button type=\"submit\" onclick=\"deleteTune(%d, this)\">Delete</button></div>", name, slot);
+      tunes += line;
+    }
+    return tunes;
+  }
 
   return String();
 }
@@ -752,14 +960,21 @@ String settings_processor(const String &var)
 {
   if (var == "CURRWIFIPLACEHOLDER")
   {
-    String info = "";
+    String info;
+    info.reserve(ssid.length() + password.length() + 48);
     if (ssid.length() != 0)
     {
-      info += "<div id=\"currwifi\">" + ssid + " (" + password + "), ";
-      if (WiFi.status() == WL_CONNECTED)
-        info += "RSSI: " + String(WiFi.RSSI()) + "</div>";
+      char rssi[24];
+      if (wifiOnline())
+        sprintf(rssi, "RSSI: %d</div>", wifiInfo.rssi);
       else
-        info += "Not Connected</div>";
+        strcpy(rssi, "Not Connected</div>");
+      info += "<div id=\"currwifi\">";
+      info += ssid;
+      info += " (";
+      info += password;
+      info += "), ";
+      info += rssi;
     }
     else
       info += "<div id=\"currwifi\">Not Found</div>";
@@ -768,60 +983,64 @@ String settings_processor(const String &var)
 
   if (var == "CURRAPIPLACEHOLDER")
   {
-    String info = "";
     if (openWeatherMapApiKey.length() == 32)
-      info += openWeatherMapApiKey;
-    else
-      info += "Not found";
-    return info;
+      return openWeatherMapApiKey;
+    return String("Not found");
   }
 
   if (var == "CURRLOCATIONPLACEHOLDER")
   {
-    String info = String(city) + ", " + String(countryCode);
+    String info;
+    info.reserve(city.length() + countryCode.length() + 2);
+    info += city;
+    info += ", ";
+    info += countryCode;
     return info;
   }
 
-  // // this crashes ESP32 when visiting /settings ☠️☠️
-  // if (var == "INPUTPLACEHOLDER")
-  // {
-  //   int n = WiFi.scanNetworks();
-  //   Serial.println("[WIFI] WiFi scan done");
-  //   String nearbyWifis = "<div><h3>" + String(n) + " networks found</h3>";
-  //   if (n == 0)
-  //     Serial.println("[WIFI] No networks found");
-  //   else
-  //   {
-  //     nearbyWifis += "<select name=\"wifis\" id=\"wifis\">";
-  //     sprintf(charbuf, "[WIFI] %d networks found:", n);
-  //     Serial.println(charbuf);
-  //     for (int i = 0; i < n; i++)
-  //     {
-  //       // Print SSID and RSSI for each network found
-  //       String info = String(i + 1) + ": " + String(WiFi.SSID(i)) + " (" + String(WiFi.RSSI(i)) + ")" + ((WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? " " : "*");
-  //       Serial.println(info);
-  //       nearbyWifis += "<option value=\"" + String(WiFi.SSID(i)) + "\">" + info + "</option>";
-  //     }
-  //   }
-  //   nearbyWifis += "</select></div><br>";
-  //   return nearbyWifis;
-  // }
+  if (var == "NIGHTSTART" || var == "NIGHTEND")
+  {
+    char hhmm[6];
+    nightFormat(hhmm, var == "NIGHTSTART" ? nightWindow.start : nightWindow.end);
+    return String(hhmm);
+  }
+
+  if (var == "TZPLACEHOLDER")
+  {
+    String info;
+    info.reserve(40 + TZ_ZONES * 100);
+    info += "<select id=\"tz\" name=\"tz\">";
+    char line[128];
+    for (int i = 0; i < TZ_ZONES; i++)
+    {
+      const tzzone &z = tzZones[i];
+      sprintf(line, "<option value=\"%s\"%s>%s (UTC%+d:%02d)</option>", z.name, &z == tzZone ? " selected" : "", z.name, z.standard / 60, abs(z.standard % 60));
+      info += line;
+    }
+    info += "</select>";
+    return info;
+  }
 
   return String();
 }
 
-void readDHT()
+void printDHT()
 {
-  dht_temp = dht_sensor.readTemperature();
-  dht_hum = dht_sensor.readHumidity();
-  dht_hi = dht_sensor.computeHeatIndex(dht_temp, dht_hum, false);
+  dhtsnapshot dht = dhtLatest();
 
-  if (isnan(dht_temp) || isnan(dht_hum))
-    Serial.println("[MODULE] Failed to read from DHT sensor!");
+  if (dht.quality == DHT_NO_DATA)
+  {
+    SLOGW("[MODULE] Failed to read from DHT sensor! Error: %u", dht.lastError);
+  }
   else
   {
-    sprintf(charbuf, "[MODULE] DHT READ: %.2fC, %.2f%, %.2fC", dht_temp, dht_hum, dht_hi);
-    Serial.println(charbuf);
+    char temp[12], hum[12], hi[12], dew[12];
+    fixFormat(temp, dht.temp, 2);
+    fixFormat(hum, dht.hum, 2);
+    fixFormat(hi, dht.hi, 2);
+    fixFormat(dew, dht.dew, 2);
+    SLOGI("[MODULE] DHT READ: %sC, %s%%, %sC, dew point %sC (%s, %lus old, %u failed reads)", temp, hum, hi, dew,
+          dht.quality == DHT_GOOD ? "good" : "stale", (millis() - dht.millis) / 1000, dht.failures);
   }
 
   return;
@@ -829,27 +1048,31 @@ void readDHT()
 
 void readWeatherAPI()
 {
-  if (WiFi.status() != WL_CONNECTED)
+  if (!wifiOnline())
   {
-    Serial.println("[CODE] Not connected, skip reading API");
+    SLOGI("[CODE] Not connected, skip reading API");
     return;
   }
   if (openWeatherMapApiKey.length() != 32)
   {
-    Serial.println("[CODE] Invalid API Key, skip reading API");
+    SLOGI("[CODE] Invalid API Key, skip reading API");
     return;
   }
 
   // TODO: put get request on the other core
   if (openWeatherMapApiKey.length() == 32)
-    serverPath = "http://api.openweathermap.org/data/2.5/weather?q=" + city + "," + countryCode + "&APPID=" + openWeatherMapApiKey;
+    snprintf(serverPath, sizeof(serverPath), "http://api.openweathermap.org/data/2.5/weather?q=%s,%s&APPID=%s", city.c_str(), countryCode.c_str(), openWeatherMapApiKey.c_str());
 
-  jsonBuffer = httpGETRequest(serverPath.c_str());
-  JSONVar jsObj = JSON.parse(jsonBuffer);
+  arenascope scope; // the payload and the JSON tree, gone when we return
+  char *payload = httpGETRequest(serverPath);
+  if (!payload)
+    return;
+  JSONVar jsObj = JSON.parse(payload);
+  arenaFree(payload);
 
   if (JSON.typeof(jsObj) == "undefined")
   {
-    Serial.println("[CODE] Parsing input failed!");
+    SLOGW("[CODE] Parsing input failed!");
     return;
   }
 
@@ -857,14 +1080,19 @@ void readWeatherAPI()
   pressure = int(jsObj["main"]["pressure"]);
   humidity = int(jsObj["main"]["humidity"]);
   windspeed = double(jsObj["wind"]["speed"]);
-  weather_main = String((const char *)jsObj["weather"][0]["main"]);
-  weather_desc = String((const char *)jsObj["weather"][0]["description"]);
-  weather_icon = String((const char *)jsObj["weather"][0]["icon"]).toInt();
-
-  sprintf(charbuf, "[CODE] Temperature: %.2f  Pressure: %u  Humidity: %u%%  Wind Speed: %.2f", temperature, pressure, humidity, windspeed);
-  Serial.println(charbuf);
-  sprintf(charbuf, "[CODE] Weather: %s (%s, %u)", weather_main, weather_desc, weather_icon);
-  Serial.println(charbuf);
+  const char *field = jsObj["weather"][0]["main"];
+  strlcpy(weather_main, field ? field : "", sizeof(weather_main));
+  field = jsObj["weather"][0]["description"];
+  strlcpy(weather_desc, field ? field : "", sizeof(weather_desc));
+  field = jsObj["weather"][0]["icon"];
+  weather_icon = field ? atoi(field) : 0; // "01d" is 1
+  logRecord(LOG_WEATHER, time(NULL), (int16_t)(temperature * 100), humidity, pressure, weather_icon, (int16_t)(windspeed * 100));
+
+  char temp[12], wind[12];
+  fixFormat(temp, lroundf(temperature * 100), 2);
+  fixFormat(wind, lroundf(windspeed * 100), 2);
+  SLOGI("[CODE] Temperature: %s  Pressure: %u  Humidity: %u%%  Wind Speed: %s", temp, pressure, humidity, wind);
+  SLOGI("[CODE] Weather: %s (%s, %u)", weather_main, weather_desc, weather_icon);
 
   return;
 }
@@ -882,6 +1110,9 @@ void drawScreen()
   case 2:
     drawFace();
     break;
+  case 3:
+    drawSparklines();
+    break;
   default:
     break;
   }
@@ -889,7 +1120,7 @@ void drawScreen()
 
 void drawInfoBar()
 {
-  if (WiFi.status() != WL_CONNECTED)
+  if (!wifiOnline())
   {
     display.setCursor(0, 64 - 8);
 
@@ -901,12 +1132,12 @@ void drawInfoBar()
     else
     {
       display.print("Web:");
-      display.println(WiFi.softAPIP());
+      display.println(IPAddress(wifiInfo.apIP));
     }
   }
   else
   { // 128x64
-    int rssi = WiFi.RSSI();
+    int rssi = wifiInfo.rssi;
     if (rssi < -90)
       display.drawLine(0, 64 - 2, 0, 64 - 2, WHITE);
     if (rssi >= -90)
@@ -923,34 +1154,40 @@ void drawInfoBar()
     if (display_state % 2)
     {
       display.print("WiFi:");
-      display.println(WiFi.SSID());
+      display.println(wifiInfo.ssid);
     }
     else
     {
       display.print("Web:");
-      display.println(WiFi.localIP());
+      display.println(IPAddress(wifiInfo.ip));
     }
   }
 }
 
 void drawSensorData()
 {
+  dhtsnapshot dht = dhtLatest();
+  char num[12];
+
   display.drawBitmap(0, 0, bitmap_temp, 25, 25, WHITE);
   display.drawBitmap(64, 0, bitmap_hum, 25, 25, WHITE);
 
   display.setCursor(25 - 2, 8); // 2px padding
-  display.print(dht_temp);
+  fixFormat(num, dht.temp, 2);
+  display.print(num);
   display.print((char)247);
   display.println("C");
   display.setCursor(64 + 25 + 2, 8); // 2px padding
-  display.print(dht_hum);
+  fixFormat(num, dht.hum, 2);
+  display.print(num);
   display.println("%");
 
   display.setCursor(0, 28);
   display.println("Feels like:");
   display.setCursor(0, 38);
   display.setTextSize(2);
-  display.print(dht_hi);
+  fixFormat(num, dht.hi, 2);
+  display.print(num);
   display.print((char)247);
   display.println("C");
   display.setTextSize(1);
@@ -958,9 +1195,44 @@ void drawSensorData()
   return;
 }
 
+void drawSparklines()
+{
+  if (sparkTemp.column == 0)
+  {
+    display.setCursor(0, 16);
+    display.println("Collecting sensor");
+    display.println("history...");
+    return;
+  }
+
+  dhtsnapshot dht = dhtLatest();
+  char num[12];
+  sparkBlit(display, sparkTemp);
+  sparkBlit(display, sparkHum);
+
+  display.setCursor(0, 0);
+  fixFormat(num, fixDiv(dht.temp, 10), 1);
+  display.print(num);
+  display.setCursor(0, 8);
+  display.print((char)247);
+  display.println("C");
+  display.setCursor(0, SPARK_H);
+  fixFormat(num, fixDiv(dht.hum, 10), 1);
+  display.print(num);
+  display.setCursor(0, SPARK_H + 8);
+  display.println("%");
+
+  display.setCursor(SPARK_X, 2 * SPARK_H);
+  display.print("-24h");
+  display.setCursor(128 - 18, 2 * SPARK_H);
+  display.print("now");
+
+  return;
+}
+
 void drawAPIWeather()
 {
-  if (WiFi.status() != WL_CONNECTED)
+  if (!wifiOnline())
   {
     display.drawBitmap(0, 0, bitmap_nowifi, 16, 16, WHITE);
     display.setCursor(24, 4);
@@ -972,7 +1244,7 @@ void drawAPIWeather()
     display.setCursor(0, 36);
     display.println("and go to:");
     display.setCursor(10, 46);
-    display.println(WiFi.softAPIP());
+    display.println(IPAddress(wifiInfo.apIP));
 
     return;
   }
@@ -986,7 +1258,7 @@ void drawAPIWeather()
     display.println("To get the weather,");
     display.setCursor(0, 40);
     display.print("go to ");
-    display.print(WiFi.localIP());
+    display.print(IPAddress(wifiInfo.ip));
     display.println("!");
     return;
   }
@@ -1052,59 +1324,6 @@ void IRAM_ATTR isr()
   {
     buttonPressed = true;
     last_button_time = button_time;
-  }
-}
-
-void playPiezo(void *param)
-{
-  // to copy paste: https://randomnerdtutorials.com/esp32-dual-core-arduino-ide/
-  // more in depth: https://www.circuitstate.com/tutorials/how-to-write-parallel-multitasking-applications-for-esp32-using-freertos-arduino/
-  Serial.print("[CODE] Piezo running on core ");
-  Serial.println(xPortGetCoreID());
-
-  if (currSong == 0 && param != NULL)
-  {
-    int testalarm = (int)param;
-    Serial.print("[CODE] Playing alarm: ");
-    Serial.println(testalarm);
-    switch (testalarm)
-    {
-    case 1:
-      song1();
-      break;
-    case 2:
-      song2();
-      break;
-    case 3:
-      song3();
-      break;
-    default:
-      break;
-    }
-    vTaskDelete(NULL);
-  }
-  else
-  {
-    Serial.print("[CODE] Playing alarm: ");
-    Serial.println(currSong);
-    while (1) // infinite loop
-    {
-      switch (currSong)
-      {
-      case 1:
-        song1();
-        break;
-      case 2:
-        song2();
-        break;
-      case 3:
-        song3();
-        break;
-      default:
-        vTaskDelete(NULL);
-        break;
-      }
-      vTaskDelay(5000);
-    }
+    powerWakeFromISR();
   }
 }
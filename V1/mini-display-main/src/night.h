@@ -0,0 +1,97 @@
+// night mode
+//
+// between the two times set on the settings page the clock goes dark: the OLED is switched
+// off, the 7-seg goes down to NIGHT_SEG_BRIGHTNESS with the colon steady, the WiFi radio is
+// switched off and the chip light-sleeps from one minute to the next (powerSleep()), only
+// waking to put the new minute on the 7-seg. the button, an alarm coming up or the end of the
+// night bring everything back. after the button it stays up for NIGHT_AWAKE_MS and then goes
+// dark again.
+//
+// light sleep and not deep sleep: the button is on GPIO5, which isn't an RTC pin and can't
+// wake the chip from deep sleep. light sleep keeps RAM, so there's no state to save and
+// restore, and coming back is just switching the OLED on again. next to the 7-seg's LEDs the
+// difference in sleep current doesn't matter.
+
+#include <Preferences.h>
+#include <sys/time.h>
+
+#define NIGHT_ALARM_LEAD 120 // s, up this long before an alarm so WiFi and NTP are back when it rings
+#define NIGHT_AWAKE_MS 60000 // ms up after a button press
+#define NIGHT_SEG_BRIGHTNESS 0
+
+typedef struct
+{
+  uint16_t start, end; // minutes after local midnight, start == end is off
+} nightwindow;
+
+nightwindow nightWindow;
+bool nightActive;               // dark right now
+unsigned long nightAwakeMillis; // last button press inside the window, 0 none
+Preferences nightPrefs;
+
+bool nightIn(const tm &t)
+{
+  const nightwindow &w = nightWindow;
+  uint16_t m = t.tm_hour * 60 + t.tm_min;
+  if (w.start == w.end)
+    return false;
+  return w.start < w.end ? m >= w.start && m < w.end : m >= w.start || m < w.end;
+}
+
+// whether it should be dark now: inside the window, nothing playing, the clock set, no alarm
+// (next one at alarm, 0 none) within NIGHT_ALARM_LEAD and no button press for NIGHT_AWAKE_MS.
+// a press inside the window is used up if it was dark, it only wakes the screen
+bool nightDark(const tm &now, time_t utc, time_t alarm, bool playing, bool &button)
+{
+  bool inside = nightIn(now);
+  if (!inside)
+    nightAwakeMillis = 0;
+  else if (button)
+  {
+    nightAwakeMillis = millis();
+    if (nightActive)
+      button = false;
+  }
+  return inside && !playing && utc >= (time_t)HIST_VALID_AFTER && !(alarm && alarm - utc <= NIGHT_ALARM_LEAD) &&
+         (!nightAwakeMillis || millis() - nightAwakeMillis > NIGHT_AWAKE_MS);
+}
+
+// "HH:MM-HH:MM", or "" for off. false if it doesn't parse
+bool nightSet(const char *s)
+{
+  nightwindow w = {0, 0};
+  if (*s)
+  {
+    unsigned sh, sm, eh, em;
+    if (sscanf(s, "%u:%u-%u:%u", &sh, &sm, &eh, &em) != 4 || sh > 23 || sm > 59 || eh > 23 || em > 59)
+      return false;
+    w = {(uint16_t)(sh * 60 + sm), (uint16_t)(eh * 60 + em)};
+  }
+  nightWindow = w;
+  nightPrefs.putBytes("window", &w, sizeof(w));
+  return true;
+}
+
+// "HH:MM" of minutes after midnight into out, empty while night mode is off
+void nightFormat(char *out, uint16_t m)
+{
+  if (nightWindow.start == nightWindow.end)
+    *out = 0;
+  else
+    sprintf(out, "%02u:%02u", m / 60, m % 60);
+}
+
+// ms until the minute on the 7-seg changes (zone offsets are whole minutes)
+uint32_t nightMsToMinute()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (59 - tv.tv_sec % 60) * 1000 + (1000 - tv.tv_usec / 1000);
+}
+
+void nightBegin()
+{
+  nightPrefs.begin("night", false);
+  if (nightPrefs.getBytesLength("window") == sizeof(nightWindow))
+    nightPrefs.getBytes("window", &nightWindow, sizeof(nightWindow));
+}
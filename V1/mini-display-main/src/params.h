@@ -0,0 +1,142 @@
+// single-pass query parameter parsing for the web handlers
+//
+// hasParam()/getParam(name) each walk the whole parameter list with String compares,
+// so a handler that checks N keys does N scans. instead we walk the list once, hash every
+// name with FNV-1a and switch on it. the case labels are hashed at compile time, so the
+// switch is a perfect hash over our key set: a collision between two keys would be a
+// duplicate case label and fail the build. anything else a client sends can still land on one
+// of our hashes, so a case only takes the parameter once the name really matches (paramTake).
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <ESPAsyncWebServer.h>
+
+constexpr uint32_t paramHash(const char *s, uint32_t h = 2166136261UL)
+{
+  return *s ? paramHash(s + 1, (h ^ (uint8_t)*s) * 16777619UL) : h;
+}
+
+// calls fn(hash, param) for every GET query parameter, in one pass
+template <typename F>
+void forEachParam(AsyncWebServerRequest *request, F fn)
+{
+  size_t n = request->params();
+  for (size_t i = 0; i < n; i++)
+  {
+    AsyncWebParameter *p = request->getParam(i);
+    if (p->isPost() || p->isFile())
+      continue; // hasParam(name) only looked at the query string too
+    fn(paramHash(p->name().c_str()), p);
+  }
+}
+
+// the case for key, taken only when the name is really key and it's the first of its kind
+// (getParam(name) returned the first one too). expects the parameter as p
+#define PARAM_CASE(seen, key, bit)     \
+  case paramHash(key):                 \
+    if (!paramTake(p, key, bit, seen)) \
+      break;
+
+template <typename T>
+bool paramTake(AsyncWebParameter *p, const char *key, uint16_t bit, T &seen)
+{
+  if ((seen & bit) || strcmp(p->name().c_str(), key))
+    return false;
+  seen |= bit;
+  return true;
+}
+
+// string fields point into the request, so they are only valid inside the handler
+enum InitParam : uint16_t
+{
+  INIT_NAME = 1 << 0,
+  INIT_PWD = 1 << 1,
+  INIT_APIKEY = 1 << 2,
+  INIT_CITY = 1 << 3,
+  INIT_CCODE = 1 << 4,
+  INIT_TIME = 1 << 5,
+  INIT_REPEATS = 1 << 6,
+  INIT_ALARMTIME = 1 << 7,
+  INIT_SONG = 1 << 8,
+  INIT_ALARMDEL = 1 << 9,
+  INIT_TUNEDEL = 1 << 10,
+  INIT_TZ = 1 << 11,
+  INIT_NIGHT = 1 << 12,
+};
+
+typedef struct
+{
+  uint16_t seen; // InitParam bits of the keys present in the request
+  const String *name, *pwd, *apikey, *city, *ccode, *time, *alarmtime, *tz, *night;
+  int repeats, song, alarmdel, tunedel;
+
+  bool has(uint16_t keys) const { return (seen & keys) == keys; }
+} initparams;
+
+void parseInitParams(AsyncWebServerRequest *request, initparams &q)
+{
+  q = {};
+  forEachParam(request, [&q](uint32_t hash, AsyncWebParameter *p)
+               {
+    const String &v = p->value();
+    switch (hash) {
+    PARAM_CASE(q.seen, "name", INIT_NAME)           q.name = &v; break;
+    PARAM_CASE(q.seen, "pwd", INIT_PWD)             q.pwd = &v; break;
+    PARAM_CASE(q.seen, "apikey", INIT_APIKEY)       q.apikey = &v; break;
+    PARAM_CASE(q.seen, "city", INIT_CITY)           q.city = &v; break;
+    PARAM_CASE(q.seen, "ccode", INIT_CCODE)         q.ccode = &v; break;
+    PARAM_CASE(q.seen, "time", INIT_TIME)           q.time = &v; break;
+    PARAM_CASE(q.seen, "repeats", INIT_REPEATS)     q.repeats = v.toInt(); break;
+    PARAM_CASE(q.seen, "alarmtime", INIT_ALARMTIME) q.alarmtime = &v; break;
+    PARAM_CASE(q.seen, "song", INIT_SONG)           q.song = v.toInt(); break;
+    PARAM_CASE(q.seen, "alarmdel", INIT_ALARMDEL)   q.alarmdel = v.toInt(); break;
+    PARAM_CASE(q.seen, "tunedel", INIT_TUNEDEL)     q.tunedel = v.toInt(); break;
+    PARAM_CASE(q.seen, "tz", INIT_TZ)               q.tz = &v; break;
+    PARAM_CASE(q.seen, "night", INIT_NIGHT)         q.night = &v; break;
+    default: break;
+    } });
+}
+
+enum GpioParam : uint8_t
+{
+  GPIO_OUTPUT = 1 << 0,
+  GPIO_STATE = 1 << 1,
+  GPIO_SONG = 1 << 2,
+};
+
+typedef struct
+{
+  uint8_t seen; // GpioParam bits
+  int output, state, song;
+
+  bool has(uint8_t keys) const { return (seen & keys) == keys; }
+} gpioparams;
+
+void parseGpioParams(AsyncWebServerRequest *request, gpioparams &q)
+{
+  q = {};
+  forEachParam(request, [&q](uint32_t hash, AsyncWebParameter *p)
+               {
+    switch (hash) {
+    PARAM_CASE(q.seen, "output", GPIO_OUTPUT) q.output = p->value().toInt(); break;
+    PARAM_CASE(q.seen, "state", GPIO_STATE)   q.state = p->value().toInt(); break;
+    PARAM_CASE(q.seen, "song", GPIO_SONG)     q.song = p->value().toInt(); break;
+    default: break;
+    } });
+}
+
+// /slider only takes ?value=, returns false if it is missing
+bool parseSliderValue(AsyncWebServerRequest *request, int &value)
+{
+  bool found = false;
+  forEachParam(request, [&](uint32_t hash, AsyncWebParameter *p)
+               {
+    if (hash == paramHash("value") && !found && p->name() == "value") {
+      value = p->value().toInt();
+      found = true;
+    } });
+  return found;
+}
+
+#endif
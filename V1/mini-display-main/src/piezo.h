@@ -0,0 +1,205 @@
+// piezo playback service
+//
+// web requests and alarms only post commands to a small queue, so rapid /gpio?song= requests
+// can no longer pile up tasks that fight over the buzzer. one persistent task on core 0
+// applies the commands and keeps the sequencer ring topped up; the notes themselves are
+// played by an esp_timer callback that programs the LEDC channel at every note boundary, so
+// nothing sits on a stack while a song plays and stopping is just cancelling the timer and
+// silencing the channel.
+//
+// songs 1-NUM_SONGS are built in, CUSTOM_SONG_BASE+1 onwards are uploaded tunes (tunestore.h)
+
+#include "songs.h"
+#include "sequencer.h"
+#include "tunestore.h"
+#include "esp_timer.h"
+
+#define PIEZO_QUEUE_LEN 4
+#define PIEZO_STACK_SIZE 4096 // room for SPIFFS reads when streaming uploaded tunes
+#define PIEZO_LOOP_GAP 5000 // ms of silence between repeats of an alarm
+#define PIEZO_LEDC_CHANNEL 0
+
+typedef enum
+{
+  PIEZO_STOP,
+  PIEZO_PLAY,    // play once
+  PIEZO_LOOP,    // repeat until stopped (alarms)
+  PIEZO_PREVIEW, // play once, but never interrupts a ringing alarm
+} piezocmd;
+
+typedef struct
+{
+  uint8_t cmd;
+  int8_t song;
+} piezomsg;
+
+QueueHandle_t piezoQueue;
+SemaphoreHandle_t piezoLock; // guards piezoNow and the send path
+TaskHandle_t piezoTask;
+piezomsg piezoNow = {PIEZO_STOP, 0};
+
+esp_timer_handle_t piezoTimer;
+sequencer piezoSeq;
+tablecursor piezoTable;
+filecursor piezoFile;
+volatile bool piezoActive = false; // cleared by the timer when a song runs out
+powerlock piezoPower;
+
+// runs on the esp_timer task at every note boundary
+void piezoTick(void *arg)
+{
+  uint16_t freq;
+  uint32_t duration;
+  if (!seqStep(piezoSeq, freq, duration))
+  {
+    ledcWriteTone(PIEZO_LEDC_CHANNEL, 0);
+    piezoActive = false;
+    powerHold(piezoPower, false);
+    return;
+  }
+
+  ledcWriteTone(PIEZO_LEDC_CHANNEL, freq); // 0 Hz writes duty 0, i.e. a rest
+  esp_timer_start_once(piezoTimer, (uint64_t)duration * 1000);
+
+  if (seqNeedsFill(piezoSeq))
+    xTaskNotifyGive(piezoTask);
+}
+
+// piezoService() has already stopped the timer and published m as piezoNow. the timer task
+// runs on core 0 above us, so a tick never gets preempted halfway by this
+void piezoStart(piezomsg m)
+{
+  ledcWriteTone(PIEZO_LEDC_CHANNEL, 0);
+  powerHold(piezoPower, false);
+  piezoFile.file.close();
+
+  if (m.cmd == PIEZO_STOP)
+    return;
+
+  notesource src;
+  if (m.song >= 1 && m.song <= NUM_SONGS)
+    src = tableSource(piezoTable, songs[m.song - 1]);
+  else if (!isCustomSong(m.song) || !fileSource(piezoFile, m.song - CUSTOM_SONG_BASE, src))
+  {
+    SLOGW("[GPIO] No such alarm song: %d", m.song);
+    piezoActive = false;
+    return;
+  }
+
+  SLOGI("[GPIO] Playing alarm: %d", m.song);
+
+  seqStart(piezoSeq, src, m.cmd == PIEZO_LOOP, PIEZO_LOOP_GAP);
+  seqFill(piezoSeq);
+  powerHold(piezoPower, true); // the LEDC stops in light sleep
+  piezoTick(NULL);
+}
+
+void piezoService(void *param)
+{
+  SLOGI("[CODE] Piezo running on core %d", xPortGetCoreID());
+
+  piezomsg m;
+  for (;;)
+  {
+    // woken by piezoSend() for commands and by piezoTick() when the ring runs low
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // taken off the queue and published in one go, so piezoSend() always sees a command
+    // either still queued or as piezoNow, never in between
+    bool got = false;
+    xSemaphoreTake(piezoLock, portMAX_DELAY);
+    while (xQueueReceive(piezoQueue, &m, 0) == pdTRUE)
+      got = true; // only the newest command matters
+    if (got)
+    {
+      esp_timer_stop(piezoTimer); // the old song can't run out and clear piezoActive now
+      piezoNow = m;
+      piezoActive = m.cmd != PIEZO_STOP;
+    }
+    xSemaphoreGive(piezoLock);
+    if (got)
+      piezoStart(m);
+
+    if (piezoActive && seqNeedsFill(piezoSeq))
+      seqFill(piezoSeq);
+  }
+}
+
+bool piezoHasSong(int song)
+{
+  return (song >= 1 && song <= NUM_SONGS) || isCustomSong(song);
+}
+
+// posts a command; duplicates of what is already playing or queued are dropped, and a full
+// queue is flushed since the task only acts on the newest command anyway
+void piezoSend(uint8_t cmd, int song)
+{
+  static piezomsg lastSent = {PIEZO_STOP, 0};
+  if (cmd != PIEZO_STOP && !piezoHasSong(song))
+  {
+    SLOGW("[GPIO] No such alarm song: %d", song);
+    return; // before it's narrowed to int8_t, where 267 would be song 11
+  }
+  piezomsg m = {cmd, (int8_t)(cmd == PIEZO_STOP ? 0 : song)};
+
+  xSemaphoreTake(piezoLock, portMAX_DELAY);
+  piezomsg current = {PIEZO_STOP, 0};
+  if (uxQueueMessagesWaiting(piezoQueue) != 0)
+    current = lastSent;
+  else if (piezoActive)
+    current = piezoNow;
+
+  bool duplicate = current.cmd == m.cmd && current.song == m.song;
+  bool alarmRinging = current.cmd == PIEZO_LOOP;
+  if (!duplicate && !(m.cmd == PIEZO_PREVIEW && alarmRinging))
+  {
+    if (xQueueSend(piezoQueue, &m, 0) != pdTRUE)
+    {
+      xQueueReset(piezoQueue);
+      xQueueSend(piezoQueue, &m, 0);
+    }
+    lastSent = m;
+    xTaskNotifyGive(piezoTask);
+  }
+  xSemaphoreGive(piezoLock);
+}
+
+// whether song is the last thing the task started, it may have just run out
+bool piezoPlaying(int song)
+{
+  xSemaphoreTake(piezoLock, portMAX_DELAY);
+  bool playing = piezoNow.cmd != PIEZO_STOP && piezoNow.song == song;
+  xSemaphoreGive(piezoLock);
+  return playing;
+}
+
+void piezoPlay(int song) { piezoSend(PIEZO_PLAY, song); }
+void piezoLoopSong(int song) { piezoSend(PIEZO_LOOP, song); }
+void piezoPreview(int song) { piezoSend(PIEZO_PREVIEW, song); }
+void piezoStop() { piezoSend(PIEZO_STOP, 0); }
+
+void piezoBegin()
+{
+  powerLockCreate(piezoPower, "piezo");
+  ledcSetup(PIEZO_LEDC_CHANNEL, 2000, 8);
+  ledcAttachPin(BUZZER_PIN, PIEZO_LEDC_CHANNEL);
+  ledcWriteTone(PIEZO_LEDC_CHANNEL, 0);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = piezoTick;
+  timerArgs.name = "piezo";
+  esp_timer_create(&timerArgs, &piezoTimer);
+
+  piezoQueue = xQueueCreate(PIEZO_QUEUE_LEN, sizeof(piezomsg));
+  piezoLock = xSemaphoreCreateMutex();
+  // to copy paste: https://randomnerdtutorials.com/esp32-dual-core-arduino-ide/
+  // more in depth: https://www.circuitstate.com/tutorials/how-to-write-parallel-multitasking-applications-for-esp32-using-freertos-arduino/
+  xTaskCreatePinnedToCore(
+      piezoService,     /* Task function. */
+      "Play Piezo",     /* name of task. */
+      PIEZO_STACK_SIZE, /* Stack size of task */
+      NULL,             /* parameter of the task */
+      1,                /* priority of the task */
+      &piezoTask,       /* Task handle to keep track of created task */
+      0);               /* pin task to core 0 */
+}
@@ -0,0 +1,193 @@
+// idle policy
+//
+// loop() used to spin flat out, although it only has work once a second (7-seg, alarms) and
+// once a minute. now it works out how long until its next deadline and blocks in powerIdle()
+// for that long, the button ISR wakes it early. with loop() blocked and the other tasks
+// waiting on their timers, FreeRTOS idles the CPU, and WiFi stays in modem sleep, waking
+// for the AP's DTIM beacons (set by the WiFi supervisor).
+//
+// with power management in the build (CONFIG_PM_ENABLE) the CPU also scales down to
+// POWER_MIN_MHZ when idle, and with tickless idle (CONFIG_FREERTOS_USE_TICKLESS_IDLE) it goes
+// into automatic light sleep between deadlines, woken by the next timer or by the button.
+// things that can't survive light sleep (an RMT capture, a song on the LEDC) hold a
+// powerlock while they run. the stock Arduino core has PM but not tickless idle, so there
+// it's the first two.
+//
+// night mode (night.h) goes further and puts the chip into light sleep by hand with powerSleep(),
+// WiFi off, between its once a minute updates.
+//
+// powerStats counts how long loop() was working vs idle, and how often it woke. GET /power.
+
+#include <ESPAsyncWebServer.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+#define POWER_MAX_MHZ 240
+#define POWER_MIN_MHZ 80 // APB stays at 80MHz, so LEDC and RMT timings don't change
+#define POWER_BOOT_POLL_MS 50
+#define POWER_FLUSH_MS 50 // longest powerSleep() waits for the serial log
+
+typedef struct
+{
+  uint64_t awakeUs, idleUs;
+  uint32_t wakes, buttonWakes;
+  uint32_t sleeps; // powerSleep() light sleeps
+} powerstats;
+
+typedef struct
+{
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_handle_t handle;
+#endif
+  bool held;
+} powerlock;
+
+powerstats powerStats;
+TaskHandle_t powerLoopTask;
+int64_t powerAwakeSince;
+bool powerLightSleep; // automatic light sleep is on
+uint8_t powerButton;
+volatile uint8_t powerHolds; // powerlocks held right now
+portMUX_TYPE powerMux = portMUX_INITIALIZER_UNLOCKED;
+
+void powerLockCreate(powerlock &l, const char *name)
+{
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, name, &l.handle);
+#endif
+  l.held = false;
+}
+
+// keeps the chip out of light sleep while on is true. idempotent, safe from any task
+void powerHold(powerlock &l, bool on)
+{
+  portENTER_CRITICAL(&powerMux);
+  if (l.held != on)
+  {
+    l.held = on;
+    powerHolds += on ? 1 : -1;
+#if CONFIG_PM_ENABLE
+    if (l.handle)
+      on ? esp_pm_lock_acquire(l.handle) : esp_pm_lock_release(l.handle);
+#endif
+  }
+  portEXIT_CRITICAL(&powerMux);
+}
+
+// from the button ISR
+void IRAM_ATTR powerWakeFromISR()
+{
+  BaseType_t woken = pdFALSE;
+  if (powerLoopTask)
+    vTaskNotifyGiveFromISR(powerLoopTask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+// ms until the first of loop()'s timers is due. timer i is due once more than every[i] ms have
+// passed since last[i], every[i] 0 leaves it out
+uint32_t powerNextMs(unsigned long now, const unsigned long *last, const uint32_t *every, size_t n)
+{
+  long next = 0x7fffffff;
+  for (size_t i = 0; i < n; i++)
+    if (every[i])
+      next = min(next, (long)every[i] + 1 - (long)(now - last[i]));
+  return next < 1 ? 1 : next;
+}
+
+// blocks loop() for up to ms, less if the button is pressed
+void powerIdle(uint32_t ms)
+{
+  int64_t start = esp_timer_get_time();
+  powerStats.awakeUs += start - powerAwakeSince;
+  bool button = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+  int64_t end = esp_timer_get_time();
+  powerStats.idleUs += end - start;
+  powerStats.wakes++;
+  powerStats.buttonWakes += button;
+  powerAwakeSince = end;
+}
+
+// light sleep for up to ms with everything stopped, the button wakes it. only for when
+// WiFi is off, it doesn't keep the connection. true if the button woke it
+bool powerSleep(uint32_t ms)
+{
+  if (powerHolds)
+  {
+    powerIdle(ms < POWER_BOOT_POLL_MS ? ms : POWER_BOOT_POLL_MS); // a capture or a song is running, let it finish
+    return false;
+  }
+  slogFlush(POWER_FLUSH_MS); // the UART stops in light sleep, get the log lines out first
+  int64_t start = esp_timer_get_time();
+  powerStats.awakeUs += start - powerAwakeSince;
+
+  // light sleep only wakes on a level, attachInterrupt()'s edge goes back afterwards
+  gpio_wakeup_enable((gpio_num_t)powerButton, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  esp_light_sleep_start();
+  bool button = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+#if !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  gpio_wakeup_disable((gpio_num_t)powerButton);
+#endif
+  gpio_set_intr_type((gpio_num_t)powerButton, GPIO_INTR_NEGEDGE);
+
+  int64_t end = esp_timer_get_time();
+  powerStats.idleUs += end - start;
+  powerStats.wakes++;
+  powerStats.sleeps++;
+  powerStats.buttonWakes += button;
+  powerAwakeSince = end;
+  return button;
+}
+
+// call after attachInterrupt() on the button, which would undo it: arms the button (pulls low)
+// to wake automatic light sleep. arming switches the pin to a level interrupt, so the edge goes
+// back afterwards like in powerSleep()
+void powerArmButton()
+{
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  if (!powerLightSleep)
+    return;
+  gpio_wakeup_enable((gpio_num_t)powerButton, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  gpio_set_intr_type((gpio_num_t)powerButton, GPIO_INTR_NEGEDGE);
+#endif
+}
+
+// GET /power: {"awakeMs","idleMs","duty" (per mille awake),"wakes","buttonWakes","sleeps","lightSleep"}
+void handlePower(AsyncWebServerRequest *request)
+{
+  powerstats s = powerStats;
+  uint64_t total = s.awakeUs + s.idleUs;
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"awakeMs\":%llu,\"idleMs\":%llu,\"duty\":%u,\"wakes\":%lu,\"buttonWakes\":%lu,\"sleeps\":%lu,\"lightSleep\":%s}",
+                   s.awakeUs / 1000, s.idleUs / 1000, total ? (unsigned)(s.awakeUs * 1000 / total) : 1000,
+                   (unsigned long)s.wakes, (unsigned long)s.buttonWakes, (unsigned long)s.sleeps, powerLightSleep ? "true" : "false");
+  request->send(response);
+}
+
+// call from setup(), it's loop()'s task that powerIdle() blocks
+void powerBegin(uint8_t buttonPin)
+{
+  powerLoopTask = xTaskGetCurrentTaskHandle();
+  powerButton = buttonPin;
+  powerAwakeSince = esp_timer_get_time();
+
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = POWER_MAX_MHZ;
+  pm.min_freq_mhz = POWER_MIN_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pm.light_sleep_enable = true;
+#endif
+  powerLightSleep = esp_pm_configure(&pm) == ESP_OK && pm.light_sleep_enable;
+#endif
+
+  Serial.println(powerLightSleep ? "[CODE] Idle policy: light sleep between deadlines" : "[CODE] Idle policy: CPU idle between deadlines");
+}
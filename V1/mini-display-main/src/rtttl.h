@@ -0,0 +1,230 @@
+// RTTTL ringtone parser
+//
+// compiles Nokia RTTTL strings ("name:d=4,o=5,b=120:8e6,8d6,4f#5,...") into packed notes
+// from tune.h. the parser is fed one character at a time and only keeps the current token,
+// so a ringtone can be compiled while it is still arriving.
+
+#ifndef RTTTL_H
+#define RTTTL_H
+
+#include "tune.h"
+
+#define RTTTL_TOKEN_LEN 12
+
+typedef enum
+{
+  RTTTL_NAME,
+  RTTTL_DEFAULTS,
+  RTTTL_NOTES,
+  RTTTL_ERROR,
+} rtttlsection;
+
+typedef struct
+{
+  uint8_t section;
+  uint8_t division; // d=, default note value
+  uint8_t octave;   // o=, default octave
+  uint16_t bpm;     // b=
+  char token[RTTTL_TOKEN_LEN + 1];
+  uint8_t tokenLen;
+} rtttlparser;
+
+void rtttlBegin(rtttlparser &p)
+{
+  p.section = RTTTL_NAME;
+  p.division = 4;
+  p.octave = 6;
+  p.bpm = 63;
+  p.tokenLen = 0;
+}
+
+// parses a decimal number at *s, returns -1 if there is none
+int rtttlNumber(const char *&s)
+{
+  if (*s < '0' || *s > '9')
+    return -1;
+  int n = 0;
+  while (*s >= '0' && *s <= '9' && n < 1000)
+    n = n * 10 + (*s++ - '0');
+  return n;
+}
+
+bool rtttlDefault(rtttlparser &p, const char *s)
+{
+  char key = *s++;
+  if (*s++ != '=')
+    return false;
+  int v = rtttlNumber(s);
+  if (v <= 0 || *s)
+    return false;
+
+  switch (key)
+  {
+  case 'd':
+    if (v > NOTE_MAX_DIV || (v & (v - 1)))
+      return false;
+    p.division = v;
+    return true;
+  case 'o':
+    if (v > 8)
+      return false;
+    p.octave = v;
+    return true;
+  case 'b':
+    if (!validBpm(v))
+      return false;
+    p.bpm = v;
+    return true;
+  default:
+    return true; // unknown keys are ignored
+  }
+}
+
+// [duration] letter [#] [.] [octave] [.]
+bool rtttlNote(rtttlparser &p, const char *s, note &out)
+{
+  int division = rtttlNumber(s);
+  if (division < 0)
+    division = p.division;
+  if (division == 0 || division > NOTE_MAX_DIV || (division & (division - 1)))
+    return false;
+
+  // semitones above C for a-g, h is the german name for b
+  static const int8_t semitones[] = {9, 11, 0, 2, 4, 5, 7, 11};
+  bool rest = *s == 'p';
+  int semitone = 0;
+  if (rest)
+    s++;
+  else if (*s >= 'a' && *s <= 'h')
+    semitone = semitones[*s++ - 'a'];
+  else
+    return false;
+
+  if (*s == '#')
+  {
+    semitone++;
+    s++;
+  }
+  bool dotted = false;
+  if (*s == '.')
+  {
+    dotted = true;
+    s++;
+  }
+  int octave = p.octave;
+  if (*s >= '0' && *s <= '9')
+    octave = *s++ - '0';
+  if (*s == '.')
+  {
+    dotted = true;
+    s++;
+  }
+  if (*s)
+    return false;
+
+  int shift = 0;
+  while ((1 << shift) < division)
+    shift++;
+
+  // pitchTable starts at B0 (midi 23) at index 1
+  int pitch = 0;
+  if (!rest)
+  {
+    pitch = 12 * (octave + 1) + semitone - 22;
+    if (pitch < 1 || pitch >= NUM_PITCHES)
+      return false;
+  }
+
+  out = packNote(pitch, shift, dotted);
+  return true;
+}
+
+// ends the current token; returns 1 if it was a note
+int rtttlToken(rtttlparser &p, note &out)
+{
+  p.token[p.tokenLen] = 0;
+  int len = p.tokenLen;
+  p.tokenLen = 0;
+
+  if (p.section == RTTTL_DEFAULTS)
+  {
+    if (len && !rtttlDefault(p, p.token))
+      p.section = RTTTL_ERROR;
+    return 0;
+  }
+  if (p.section == RTTTL_NOTES && len)
+  {
+    if (rtttlNote(p, p.token, out))
+      return 1;
+    p.section = RTTTL_ERROR;
+  }
+  return 0;
+}
+
+// feeds one character; returns 1 when a note was completed into out, 0 if not, -1 on error
+int rtttlFeed(rtttlparser &p, char c, note &out)
+{
+  if (p.section == RTTTL_ERROR)
+    return -1;
+
+  if (c == ':' && p.section != RTTTL_NOTES)
+  {
+    rtttlToken(p, out);
+    if (p.section != RTTTL_ERROR)
+      p.section++;
+  }
+  else if (c == ',')
+  {
+    if (p.section != RTTTL_NAME && rtttlToken(p, out))
+      return 1;
+  }
+  else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+    ; // whitespace is allowed anywhere
+  else if (p.section != RTTTL_NAME)
+  {
+    if (p.tokenLen == RTTTL_TOKEN_LEN)
+      p.section = RTTTL_ERROR;
+    else
+      p.token[p.tokenLen++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+  }
+
+  return p.section == RTTTL_ERROR ? -1 : 0;
+}
+
+// flushes the last note; returns like rtttlFeed, or -1 if the ringtone never got to its notes
+int rtttlEnd(rtttlparser &p, note &out)
+{
+  if (p.section != RTTTL_NOTES)
+    return -1;
+  int r = rtttlToken(p, out);
+  return p.section == RTTTL_ERROR ? -1 : r;
+}
+
+// compiles a whole ringtone; returns the number of notes, or -1 if it is malformed or longer
+// than maxNotes
+int rtttlCompile(const char *src, note *out, int maxNotes, uint16_t &bpm)
+{
+  rtttlparser p;
+  rtttlBegin(p);
+
+  int count = 0;
+  note n;
+  for (; *src; src++)
+  {
+    int r = rtttlFeed(p, *src, n);
+    if (r < 0 || (r && count == maxNotes))
+      return -1;
+    if (r)
+      out[count++] = n;
+  }
+  int r = rtttlEnd(p, n);
+  if (r < 0 || (r && count == maxNotes))
+    return -1;
+  if (r)
+    out[count++] = n;
+
+  bpm = p.bpm;
+  return count;
+}
+
+#endif
@@ -0,0 +1,138 @@
+// note sequencer
+//
+// the player side (seqStep) pops one event at a time from a small ring; the feeder side
+// (seqFill) tops the ring up from a note source, which can be a table in flash or a tune
+// file being streamed off SPIFFS. neither side knows about timers or the buzzer: the caller
+// outputs each event and schedules the next step after its duration, so the same code
+// drives the LEDC on the badge and can render a song timeline anywhere else.
+
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include "tune.h"
+
+#define SEQ_RING 32     // events, must be a power of two
+#define SEQ_UNDERRUN 10 // ms of rest to play when the feeder falls behind
+
+typedef struct
+{
+  uint16_t freq; // Hz, 0 = rest
+  uint16_t ms;
+} noteevent;
+
+// a source reads packed notes in order; read() returns how many it got, 0 at the end
+typedef struct
+{
+  int (*read)(void *ctx, note *buf, int max);
+  bool (*rewind)(void *ctx);
+  void *ctx;
+  uint16_t bpm;
+} notesource;
+
+typedef struct
+{
+  noteevent ring[SEQ_RING];
+  volatile uint16_t head; // next event to play, only moved by seqStep
+  volatile uint16_t tail; // next free slot, only moved by seqFill
+  volatile bool done;     // source is exhausted and will not be rewound
+  notesource src;
+  uint16_t loopGap; // ms of silence between repeats
+  bool loop;
+} sequencer;
+
+void seqStart(sequencer &s, const notesource &src, bool loop, uint16_t loopGap)
+{
+  s.head = s.tail = 0;
+  s.done = false;
+  s.src = src;
+  s.loop = loop;
+  s.loopGap = loopGap;
+}
+
+uint16_t seqQueued(const sequencer &s) { return (uint16_t)(s.tail - s.head); }
+
+bool seqNeedsFill(const sequencer &s) { return !s.done && seqQueued(s) <= SEQ_RING / 2; }
+
+void seqPush(sequencer &s, uint16_t freq, uint16_t ms)
+{
+  s.ring[s.tail & (SEQ_RING - 1)] = {freq, ms};
+  s.tail = s.tail + 1;
+}
+
+// tops the ring up from the source
+void seqFill(sequencer &s)
+{
+  note buf[SEQ_RING];
+  while (!s.done)
+  {
+    int space = SEQ_RING - seqQueued(s);
+    if (space == 0)
+      return;
+
+    int n = s.src.read(s.src.ctx, buf, space);
+    if (n == 0)
+    {
+      if (!s.loop || !s.src.rewind(s.src.ctx))
+      {
+        s.done = true;
+        return;
+      }
+      seqPush(s, 0, s.loopGap); // rest between repeats, then start over
+      continue;
+    }
+
+    for (int i = 0; i < n; i++)
+      seqPush(s, noteFreq(buf[i]), noteMs(buf[i], s.src.bpm));
+  }
+}
+
+// gets the next event to output; returns false once the song is over
+bool seqStep(sequencer &s, uint16_t &freq, uint32_t &duration)
+{
+  if (seqQueued(s) == 0)
+  {
+    if (s.done)
+      return false;
+    freq = 0;
+    duration = SEQ_UNDERRUN;
+    return true;
+  }
+
+  noteevent e = s.ring[s.head & (SEQ_RING - 1)];
+  s.head = s.head + 1;
+  freq = e.freq;
+  duration = e.ms;
+  return true;
+}
+
+// notesource over a tune that sits in memory (or memory-mapped flash)
+typedef struct
+{
+  const tune *t;
+  uint16_t pos;
+} tablecursor;
+
+int tableRead(void *ctx, note *buf, int max)
+{
+  tablecursor *c = (tablecursor *)ctx;
+  int n = 0;
+  while (n < max && c->pos < c->t->length)
+    buf[n++] = c->t->notes[c->pos++];
+  return n;
+}
+
+bool tableRewind(void *ctx)
+{
+  tablecursor *c = (tablecursor *)ctx;
+  c->pos = 0;
+  return c->t->length != 0;
+}
+
+notesource tableSource(tablecursor &c, const tune &t)
+{
+  c.t = &t;
+  c.pos = 0;
+  return {tableRead, tableRewind, &c, t.bpm};
+}
+
+#endif
@@ -0,0 +1,224 @@
+// asynchronous serial log
+//
+// Serial at 115200 baud takes ~87us a byte, so the RTC time line loop() prints every second
+// cost it ~4ms, and the web callbacks and the piezo task paid the same, all formatting into one
+// shared charbuf nobody locked. now a log call only copies its format pointer and its
+// arguments into a slot of a ring, and a low priority task formats and prints the lines later.
+//
+// the ring is a bounded multi-producer queue (one sequence number per slot, producers claim a
+// slot with a compare-and-swap on the head), so any task on either core can log without a lock.
+// only the drain task reads. when the ring is full the line is dropped and counted.
+//
+// arguments are 32-bit: integers, enums and strings. strings are copied into the slot (up to
+// SLOG_TEXT bytes for all of them together, enough for the longest line, the weather's two),
+// so a buffer on the caller's stack is fine. a string that doesn't fit ends in a '~'. no
+// floats or 64-bit values, everything here is fixed point anyway.
+//
+// SLOGE/W/I/D log at their level, and anything above SLOG_LEVEL isn't compiled in at all,
+// arguments included. it's SLOG_INFO unless the build says otherwise: -DSLOG_LEVEL=SLOG_DEBUG
+// brings back the once a second time line. cold paths (connecting, booting) still print
+// directly.
+
+#ifndef SERLOG_H
+#define SERLOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+#define SLOG_ERROR 1
+#define SLOG_WARN 2
+#define SLOG_INFO 3
+#define SLOG_DEBUG 4
+
+#ifndef SLOG_LEVEL
+#define SLOG_LEVEL SLOG_INFO
+#endif
+
+#define SLOG_SLOTS 64 // power of 2
+#define SLOG_ARGS 10
+#define SLOG_TEXT 64 // bytes for the copied strings of a line: weather_main and weather_desc
+#define SLOG_LINE 160
+#define SLOG_CUT 0xffff // the offset of a string there was no room for, it prints as "~"
+
+#define SLOGE(...) do { if (SLOG_ERROR <= SLOG_LEVEL) slogWrite(SLOG_ERROR, __VA_ARGS__); } while (0)
+#define SLOGW(...) do { if (SLOG_WARN <= SLOG_LEVEL) slogWrite(SLOG_WARN, __VA_ARGS__); } while (0)
+#define SLOGI(...) do { if (SLOG_INFO <= SLOG_LEVEL) slogWrite(SLOG_INFO, __VA_ARGS__); } while (0)
+#define SLOGD(...) do { if (SLOG_DEBUG <= SLOG_LEVEL) slogWrite(SLOG_DEBUG, __VA_ARGS__); } while (0)
+
+typedef struct
+{
+  std::atomic<uint32_t> seq; // == position: free for it, == position + 1: filled
+  const char *fmt;
+  uint8_t level, nargs;
+  uint16_t strs; // bit i: args[i] is an offset into text
+  uint32_t args[SLOG_ARGS];
+  char text[SLOG_TEXT];
+} slogslot;
+
+slogslot slogRing[SLOG_SLOTS];
+std::atomic<uint32_t> slogHead;
+uint32_t slogTail; // drain task only
+std::atomic<uint32_t> slogDropped;
+std::atomic<bool> slogWaiting; // drain task is blocked, the next line wakes it
+TaskHandle_t slogTask;
+
+// ------------------------------------------ WRITING ------------------------------------------
+
+void slogArg(slogslot &s, uint8_t &used, uint8_t i, const char *str)
+{
+  s.strs |= 1 << i;
+  if (!str)
+    str = "(null)";
+  if (*str && used == SLOG_TEXT - 1)
+  {
+    s.args[i] = SLOG_CUT; // no room left at all
+    return;
+  }
+  s.args[i] = used;
+  while (*str && used < SLOG_TEXT - 1)
+    s.text[used++] = *str++;
+  if (*str)
+    s.text[used - 1] = '~'; // cut short
+  s.text[used] = 0;
+  if (used < SLOG_TEXT - 1)
+    used++;
+}
+
+void slogArg(slogslot &s, uint8_t &used, uint8_t i, char *str)
+{
+  slogArg(s, used, i, (const char *)str);
+}
+
+void slogArg(slogslot &s, uint8_t &used, uint8_t i, const String &str)
+{
+  slogArg(s, used, i, str.c_str());
+}
+
+template <typename T>
+void slogArg(slogslot &s, uint8_t &used, uint8_t i, T v)
+{
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "log arguments are integers or strings");
+  static_assert(sizeof(T) <= 4, "log arguments are 32-bit");
+  s.args[i] = (uint32_t)v;
+}
+
+// claims the next free slot, NULL when the ring is full
+slogslot *slogClaim(uint32_t &pos)
+{
+  pos = slogHead.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    slogslot &s = slogRing[pos & (SLOG_SLOTS - 1)];
+    int32_t d = (int32_t)(s.seq.load(std::memory_order_acquire) - pos);
+    if (d == 0)
+    {
+      if (slogHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        return &s;
+    }
+    else if (d < 0)
+      return NULL;
+    else
+      pos = slogHead.load(std::memory_order_relaxed);
+  }
+}
+
+// fmt has to outlive the line: a string literal
+template <typename... A>
+void slogWrite(uint8_t level, const char *fmt, A... args)
+{
+  static_assert(sizeof...(A) <= SLOG_ARGS, "too many log arguments");
+  uint32_t pos;
+  slogslot *s = slogClaim(pos);
+  if (!s)
+  {
+    slogDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  s->fmt = fmt;
+  s->level = level;
+  s->nargs = sizeof...(A);
+  s->strs = 0;
+  uint8_t used = 0, i = 0;
+  int unpack[] = {0, (slogArg(*s, used, i++, args), 0)...};
+  (void)unpack;
+  s->seq.store(pos + 1, std::memory_order_release);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the drain task's, so one of us sees the other
+  if (slogWaiting.load(std::memory_order_relaxed) && slogWaiting.exchange(false))
+    xTaskNotifyGive(slogTask);
+}
+
+// ------------------------------------------ DRAINING ------------------------------------------
+
+// prints one line if there is one, false if the ring is empty
+bool slogDrainOne()
+{
+  slogslot &s = slogRing[slogTail & (SLOG_SLOTS - 1)];
+  if (s.seq.load(std::memory_order_acquire) != slogTail + 1)
+    return false;
+
+  uintptr_t a[SLOG_ARGS];
+  for (int i = 0; i < SLOG_ARGS; i++)
+    a[i] = i >= s.nargs ? 0 : !((s.strs >> i) & 1) ? s.args[i] : s.args[i] == SLOG_CUT ? (uintptr_t) "~" : (uintptr_t)(s.text + s.args[i]);
+  char line[SLOG_LINE + 2];
+  int n = snprintf(line, SLOG_LINE, s.fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+  s.seq.store(slogTail + SLOG_SLOTS, std::memory_order_release); // the slot is free again
+  slogTail++;
+
+  n = n < 0 ? 0 : n >= SLOG_LINE ? SLOG_LINE - 1 : n;
+  line[n++] = '\r';
+  line[n++] = '\n';
+  Serial.write((const uint8_t *)line, n);
+  return true;
+}
+
+void slogDrain(void *pvParameters)
+{
+  while (1)
+  {
+    while (slogDrainOne())
+      ;
+    uint32_t dropped = slogDropped.exchange(0);
+    if (dropped)
+    {
+      char line[40];
+      sprintf(line, "[LOG] %lu lines dropped", (unsigned long)dropped);
+      Serial.println(line);
+    }
+
+    slogWaiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (slogRing[slogTail & (SLOG_SLOTS - 1)].seq.load(std::memory_order_acquire) == slogTail + 1)
+    {
+      slogWaiting.store(false); // a line came in before we said we're waiting
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+// waits until everything logged so far is out, e.g. before the chip sleeps
+void slogFlush(uint32_t timeoutMs)
+{
+  unsigned long start = millis();
+  while (slogTask && slogTail != slogHead.load() && millis() - start < timeoutMs)
+    vTaskDelay(1);
+  Serial.flush();
+}
+
+void slogBegin()
+{
+  for (uint32_t i = 0; i < SLOG_SLOTS; i++)
+    slogRing[i].seq.store(i);
+  xTaskCreatePinnedToCore(
+      slogDrain,    /* Task function. */
+      "Serial Log", /* name of task. */
+      3072,         /* Stack size of task */
+      NULL,         /* parameter of the task */
+      1,            /* priority of the task */
+      &slogTask,    /* Task handle to keep track of created task */
+      0);           /* pin task to core 0 */
+}
+
+#endif
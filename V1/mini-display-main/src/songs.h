@@ -1,81 +1,84 @@
 #include "pitches.h"
+#include "tune.h"
 #define BUZZER_PIN 4
 
-// for music theory nerds: you can set duration of 500 to be a quarter note
-void song1()
-{
+// for music theory nerds: N(pitch, 4) is a quarter note, N(pitch, 8, true) a dotted eighth.
+// all three songs are written at 120 bpm, so a quarter note lasts 500ms
+constexpr note song1[] = {
     // nokia ringtone lol
-    tone(BUZZER_PIN, NOTE_E5, 125);
-    tone(BUZZER_PIN, NOTE_D5, 125);
-    tone(BUZZER_PIN, NOTE_FS4, 250);
-    tone(BUZZER_PIN, NOTE_GS4, 250);
-    tone(BUZZER_PIN, NOTE_CS5, 125);
-    tone(BUZZER_PIN, NOTE_B4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 250);
-    tone(BUZZER_PIN, NOTE_E4, 250);
-    tone(BUZZER_PIN, NOTE_B4, 125);
-    tone(BUZZER_PIN, NOTE_A4, 125);
-    tone(BUZZER_PIN, NOTE_CS4, 250);
-    tone(BUZZER_PIN, NOTE_E4, 250);
-    tone(BUZZER_PIN, NOTE_A4, 500);
-}
+    N(NOTE_E5, 16),
+    N(NOTE_D5, 16),
+    N(NOTE_FS4, 8),
+    N(NOTE_GS4, 8),
+    N(NOTE_CS5, 16),
+    N(NOTE_B4, 16),
+    N(NOTE_D4, 8),
+    N(NOTE_E4, 8),
+    N(NOTE_B4, 16),
+    N(NOTE_A4, 16),
+    N(NOTE_CS4, 8),
+    N(NOTE_E4, 8),
+    N(NOTE_A4, 4),
+};
 
-void song2()
-{
+constexpr note song2[] = {
     // mii channel theme
-    tone(BUZZER_PIN, NOTE_FS4, 500);
-    tone(BUZZER_PIN, NOTE_A4, 250);
-    tone(BUZZER_PIN, NOTE_CS5, 500);
-    tone(BUZZER_PIN, NOTE_A4, 500);
-    tone(BUZZER_PIN, NOTE_FS4, 250);
-    tone(BUZZER_PIN, NOTE_D4, 250);
-    tone(BUZZER_PIN, NOTE_D4, 250);
-    tone(BUZZER_PIN, NOTE_D4, 500);
-    tone(BUZZER_PIN, REST, 750);
-    tone(BUZZER_PIN, NOTE_CS4, 250);
+    N(NOTE_FS4, 4),
+    N(NOTE_A4, 8),
+    N(NOTE_CS5, 4),
+    N(NOTE_A4, 4),
+    N(NOTE_FS4, 8),
+    N(NOTE_D4, 8),
+    N(NOTE_D4, 8),
+    N(NOTE_D4, 4),
+    N(REST, 4, true),
+    N(NOTE_CS4, 8),
 
-    tone(BUZZER_PIN, NOTE_D4, 250);
-    tone(BUZZER_PIN, NOTE_FS4, 250);
-    tone(BUZZER_PIN, NOTE_A4, 250);
-    tone(BUZZER_PIN, NOTE_CS5, 500);
-    tone(BUZZER_PIN, NOTE_A4, 500);
-    tone(BUZZER_PIN, NOTE_FS4, 250);
+    N(NOTE_D4, 8),
+    N(NOTE_FS4, 8),
+    N(NOTE_A4, 8),
+    N(NOTE_CS5, 4),
+    N(NOTE_A4, 4),
+    N(NOTE_FS4, 8),
 
-    tone(BUZZER_PIN, NOTE_E5, 750);
-    tone(BUZZER_PIN, NOTE_DS5, 250);
-    tone(BUZZER_PIN, NOTE_D5, 500);
-}
+    N(NOTE_E5, 4, true),
+    N(NOTE_DS5, 8),
+    N(NOTE_D5, 4),
+};
 
-void song3()
-{
+constexpr note song3[] = {
     // rickrolled!!!
-    tone(BUZZER_PIN, NOTE_C4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_F4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_A4, 375);
-    tone(BUZZER_PIN, NOTE_A4, 375);
-    tone(BUZZER_PIN, NOTE_G4, 750);
+    N(NOTE_C4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_F4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_A4, 8, true),
+    N(NOTE_A4, 8, true),
+    N(NOTE_G4, 4, true),
 
-    tone(BUZZER_PIN, NOTE_C4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_F4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_G4, 375);
-    tone(BUZZER_PIN, NOTE_G4, 375);
-    tone(BUZZER_PIN, NOTE_F4, 750);
+    N(NOTE_C4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_F4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_G4, 8, true),
+    N(NOTE_G4, 8, true),
+    N(NOTE_F4, 4, true),
 
-    tone(BUZZER_PIN, NOTE_C4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_F4, 125);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_F4, 500);
-    tone(BUZZER_PIN, NOTE_G4, 250);
-    tone(BUZZER_PIN, NOTE_E4, 375);
-    tone(BUZZER_PIN, NOTE_D4, 125);
-    tone(BUZZER_PIN, NOTE_C4, 500);
+    N(NOTE_C4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_F4, 16),
+    N(NOTE_D4, 16),
+    N(NOTE_F4, 4),
+    N(NOTE_G4, 8),
+    N(NOTE_E4, 8, true),
+    N(NOTE_D4, 16),
+    N(NOTE_C4, 4),
 
-    tone(BUZZER_PIN, NOTE_C4, 250);
-    tone(BUZZER_PIN, NOTE_G4, 500);
-    tone(BUZZER_PIN, NOTE_F4, 1000);
-}
\ No newline at end of file
+    N(NOTE_C4, 8),
+    N(NOTE_G4, 4),
+    N(NOTE_F4, 2),
+};
+
+#define SONG(notes, bpm) {notes, sizeof(notes) / sizeof(note), bpm}
+const tune songs[] = {SONG(song1, 120), SONG(song2, 120), SONG(song3, 120)};
+#define NUM_SONGS (int)(sizeof(songs) / sizeof(tune))
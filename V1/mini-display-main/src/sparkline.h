@@ -0,0 +1,187 @@
+// 24 h temperature / humidity sparklines for the OLED
+//
+// each plot keeps its own bitmap in the SSD1306's layout (one byte = 8 rows of one column)
+// and is kept up to date every minute, whether it's on screen or not. a column covers
+// SPARK_MINUTES, when a new one starts the bitmap is shifted left with a memmove per page and
+// only the newest column is drawn again. showing the page is a copy into the display buffer,
+// mirrored on the way when the display is upside down (setRotation(2)).
+//
+// values map to rows with integer math. the whole plot is rebuilt from the history rings
+// only when a value falls outside the current range, and once a day so the range can shrink.
+
+#include <Adafruit_SSD1306.h>
+
+#define SPARK_X 32       // plots start here, the labels go to their left
+#define SPARK_W 96       // columns
+#define SPARK_MINUTES 15 // per column, so 96 columns are 24 h
+#define SPARK_PAGES 3    // 8-row pages per plot
+#define SPARK_H (SPARK_PAGES * 8)
+
+typedef struct
+{
+  uint8_t bits[SPARK_PAGES][SPARK_W];
+  uint8_t page;        // first display page the plot goes to
+  uint8_t series;      // 0 temperature, 1 humidity
+  int16_t minSpan;     // smallest value range the plot is scaled to
+  int16_t lo, hi;      // value range (x HIST_SCALE) of the rows
+  int16_t colMin, colMax;
+  bool colHas;         // newest column has data
+  uint32_t column;     // minutes / SPARK_MINUTES of the newest column, 0 before the first sample
+} sparkline;
+
+sparkline sparkTemp = {{}, 0, 0, 200};
+sparkline sparkHum = {{}, SPARK_PAGES, 1, 500};
+
+uint8_t sparkRow(const sparkline &s, int16_t v)
+{
+  int32_t row = (int32_t)(s.hi - v) * (SPARK_H - 1) / (s.hi - s.lo);
+  return row < 0 ? 0 : row >= SPARK_H ? SPARK_H - 1 : row;
+}
+
+// draws column x as a bar from min to max
+void sparkColumn(sparkline &s, uint8_t x, bool has, int16_t min, int16_t max)
+{
+  for (int p = 0; p < SPARK_PAGES; p++)
+    s.bits[p][x] = 0;
+  if (!has)
+    return;
+  for (uint8_t row = sparkRow(s, max); row <= sparkRow(s, min); row++)
+    s.bits[row / 8][x] |= 1 << (row % 8);
+}
+
+void sparkShift(sparkline &s, uint32_t columns)
+{
+  if (columns > SPARK_W)
+    columns = SPARK_W;
+  for (int p = 0; p < SPARK_PAGES; p++)
+  {
+    memmove(s.bits[p], s.bits[p] + columns, SPARK_W - columns);
+    memset(s.bits[p] + SPARK_W - columns, 0, columns);
+  }
+}
+
+// min/max of the history minutes in one column
+bool sparkGather(const sparkline &s, uint32_t column, int16_t &min, int16_t &max)
+{
+  bool has = false;
+  for (uint32_t minute = column * SPARK_MINUTES; minute < (column + 1) * SPARK_MINUTES; minute++)
+  {
+    histsample m;
+    if (!histGetMinute(minute, m))
+      continue;
+    int16_t v = s.series ? m.hum : m.temp;
+    min = (!has || v < min) ? v : min;
+    max = (!has || v > max) ? v : max;
+    has = true;
+  }
+  return has;
+}
+
+// rebuilds the whole plot from the history, and fits the range to it and to extra
+void sparkRedraw(sparkline &s, int16_t extra)
+{
+  int16_t mins[SPARK_W], maxs[SPARK_W];
+  bool has[SPARK_W];
+  int16_t lo = extra, hi = extra;
+  uint32_t first = s.column - (SPARK_W - 1);
+  for (int x = 0; x < SPARK_W - 1; x++) // the newest column is still being filled
+  {
+    has[x] = sparkGather(s, first + x, mins[x], maxs[x]);
+    if (has[x])
+    {
+      lo = min(lo, mins[x]);
+      hi = max(hi, maxs[x]);
+    }
+  }
+  if (s.colHas)
+  {
+    lo = min(lo, s.colMin);
+    hi = max(hi, s.colMax);
+  }
+
+  // a bit of headroom, so the next few minutes don't force another redraw
+  int16_t margin = max((int16_t)((hi - lo) / 8), (int16_t)(s.minSpan / 4));
+  s.lo = lo - margin;
+  s.hi = hi + margin;
+  if (s.hi - s.lo < s.minSpan)
+  {
+    s.lo = (s.lo + s.hi - s.minSpan) / 2;
+    s.hi = s.lo + s.minSpan;
+  }
+
+  for (int x = 0; x < SPARK_W - 1; x++)
+    sparkColumn(s, x, has[x], mins[x], maxs[x]);
+  sparkColumn(s, SPARK_W - 1, s.colHas, s.colMin, s.colMax);
+}
+
+// one new reading, value x HIST_SCALE
+void sparkAdd(sparkline &s, time_t now, int16_t v)
+{
+  uint32_t column = (now + histOffset) / 60 / SPARK_MINUTES;
+  bool redraw = s.column == 0 || column < s.column;
+  if (column != s.column)
+  {
+    if (!redraw)
+      sparkShift(s, column - s.column);
+    s.column = column;
+    s.colHas = false;
+    redraw = redraw || column % SPARK_W == 0; // once every 24 h
+  }
+  s.colMin = (!s.colHas || v < s.colMin) ? v : s.colMin;
+  s.colMax = (!s.colHas || v > s.colMax) ? v : s.colMax;
+  s.colHas = true;
+
+  if (redraw || v < s.lo || v > s.hi)
+    sparkRedraw(s, v);
+  else
+    sparkColumn(s, SPARK_W - 1, true, s.colMin, s.colMax);
+}
+
+// called every minute from loop()
+void sparkUpdate()
+{
+  dhtsnapshot dht = dhtLatest();
+  time_t now = time(NULL);
+  if (dht.quality != DHT_GOOD || now < (time_t)HIST_VALID_AFTER)
+    return;
+  sparkAdd(sparkTemp, now, dht.temp);
+  sparkAdd(sparkHum, now, dht.hum);
+}
+
+uint8_t sparkReverse(uint8_t b)
+{
+  b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+  b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+  return (b & 0xaa) >> 1 | (b & 0x55) << 1;
+}
+
+// copies the plot into the display buffer. the buffer is in the panel's own orientation, so
+// upside down the columns run right to left, the pages bottom to top and the rows in a byte
+// the other way round. the sideways rotations go through drawPixel(), they don't fit anyway
+void sparkBlit(Adafruit_SSD1306 &d, const sparkline &s)
+{
+  uint8_t *buf = d.getBuffer();
+  uint8_t rotation = d.getRotation();
+  if (rotation == 0)
+  {
+    for (int p = 0; p < SPARK_PAGES; p++)
+      memcpy(buf + (s.page + p) * d.width() + SPARK_X, s.bits[p], SPARK_W);
+  }
+  else if (rotation == 2)
+  {
+    int pages = d.height() / 8;
+    for (int p = 0; p < SPARK_PAGES; p++)
+    {
+      uint8_t *row = buf + (pages - 1 - s.page - p) * d.width() + d.width() - 1 - SPARK_X;
+      for (int x = 0; x < SPARK_W; x++)
+        row[-x] = sparkReverse(s.bits[p][x]);
+    }
+  }
+  else
+  {
+    for (int p = 0; p < SPARK_PAGES; p++)
+      for (int x = 0; x < SPARK_W; x++)
+        for (int bit = 0; bit < 8; bit++)
+          d.drawPixel(SPARK_X + x, (s.page + p) * 8 + bit, (s.bits[p][x] >> bit) & 1 ? WHITE : BLACK);
+  }
+}
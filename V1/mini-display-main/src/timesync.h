@@ -0,0 +1,233 @@
+// multi-server NTP
+//
+// instead of the lwIP SNTP client (first answer wins, clock gets stepped) a task asks every
+// server in ntpServers a few times per round and, per reply, works out
+//   offset = ((t2 - t1) + (t3 - t4)) / 2   how far our clock is off
+//   delay  = (t4 - t1) - (t3 - t2)         round trip, which bounds the offset's error
+// replies whose offset is far from the median of the round are dropped as falsetickers, and of
+// the rest the one with the lowest delay is used. small offsets are slewed with adjtime() so
+// the 7-seg and the alarms never see the time go backwards, only a clock that is behind by a
+// lot (first sync after boot) or ahead by more than NTP_BACK_SLEW_US is stepped.
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#define NTP_PORT 123
+#define NTP_LOCAL_PORT 2390
+#define NTP_PACKET 48
+#define NTP_UNIX_EPOCH 2208988800UL // 1900 -> 1970
+#define NTP_SAMPLES 2               // queries per server per round
+#define NTP_TIMEOUT 1000            // ms to wait for a reply
+#define NTP_INTERVAL 3600           // s between rounds
+#define NTP_RETRY 60                // s between rounds until one works
+#define NTP_SLEW_US 128000          // offsets up to this are always slewed (same as ntpd)
+#define NTP_BACK_SLEW_US 30000000   // a clock ahead by up to this is slewed too, rather than stepped back
+#define NTP_OUTLIER_US 50000        // farther than this (plus the reply's delay) from the median is dropped
+
+const char *ntpServers[] = {"pool.ntp.org", "time.nist.gov", "time.google.com"};
+#define NTP_SERVERS (sizeof(ntpServers) / sizeof(ntpServers[0]))
+
+typedef struct
+{
+  int64_t offset, delay; // us
+  int64_t local, mono;   // our clock and esp_timer when the reply came in
+  int64_t slew;          // what adjtime() still had to correct then
+  uint8_t server;
+} ntpsample;
+
+typedef struct
+{
+  uint32_t rounds, synced;
+  uint32_t sent, replies, dropped; // packets, over all rounds
+  uint32_t stepped, slewed;
+  int64_t offset, delay;           // us, of the last sample used
+  uint8_t server;
+  unsigned long millis;            // of the last sync, 0 before the first
+} ntpstatus;
+
+ntpstatus ntpStatus;
+WiFiUDP ntpUDP;
+
+int64_t ntpNowUs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// 64-bit NTP timestamp at p to unix us
+int64_t ntpReadTime(const uint8_t *p)
+{
+  uint32_t sec = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+  uint32_t frac = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+  return (int64_t)(sec - NTP_UNIX_EPOCH) * 1000000 + (((uint64_t)frac * 1000000) >> 32);
+}
+
+void ntpWriteTime(uint8_t *p, int64_t us)
+{
+  uint32_t sec = us / 1000000 + NTP_UNIX_EPOCH;
+  uint32_t frac = ((uint64_t)(us % 1000000) << 32) / 1000000;
+  for (int i = 0; i < 4; i++)
+  {
+    p[i] = sec >> (24 - 8 * i);
+    p[4 + i] = frac >> (24 - 8 * i);
+  }
+}
+
+// one query, false on timeout or a reply we shouldn't trust
+bool ntpQuery(uint8_t server, ntpsample &s)
+{
+  uint8_t pkt[NTP_PACKET];
+  while (ntpUDP.parsePacket() > 0) // late replies to an earlier query
+    ntpUDP.read(pkt, NTP_PACKET);
+  memset(pkt, 0, NTP_PACKET);
+  pkt[0] = 0x23; // LI 0, version 4, client
+
+  if (!ntpUDP.beginPacket(ntpServers[server], NTP_PORT))
+    return false;
+  int64_t t1 = ntpNowUs();
+  ntpWriteTime(pkt + 40, t1); // comes back as the originate time, so we know the reply is ours
+  ntpUDP.write(pkt, NTP_PACKET);
+  if (!ntpUDP.endPacket())
+    return false;
+  ntpStatus.sent++;
+
+  unsigned long start = millis();
+  while (ntpUDP.parsePacket() < NTP_PACKET)
+  {
+    if (millis() - start > NTP_TIMEOUT)
+      return false;
+    vTaskDelay(1);
+  }
+  int64_t t4 = ntpNowUs();
+  s.local = t4;
+  s.mono = esp_timer_get_time();
+  s.slew = driftSlewLeft();
+  ntpUDP.read(pkt, NTP_PACKET);
+  ntpStatus.replies++;
+
+  uint8_t li = pkt[0] >> 6, mode = pkt[0] & 7, stratum = pkt[1];
+  uint8_t sent[8];
+  ntpWriteTime(sent, t1);
+  if (li == 3 || mode != 4 || stratum == 0 || stratum > 15 || memcmp(pkt + 24, sent, 8) != 0)
+  {
+    ntpStatus.dropped++;
+    return false;
+  }
+
+  int64_t t2 = ntpReadTime(pkt + 32), t3 = ntpReadTime(pkt + 40);
+  s.offset = ((t2 - t1) + (t3 - t4)) / 2;
+  s.delay = (t4 - t1) - (t3 - t2);
+  s.server = server;
+  if (s.delay < 0)
+    s.delay = 0;
+  return true;
+}
+
+// moves the clock by the sample's offset, never backwards unless it's far ahead. the offset
+// is the whole error, a slew still running is part of it, so it replaces that slew rather than
+// adding to it. whatever the slew corrected since the reply came in is already done
+void ntpApply(const ntpsample &s)
+{
+  int64_t offset = s.offset - (s.slew - driftSlewLeft());
+  bool slew = offset > -NTP_BACK_SLEW_US && offset <= NTP_SLEW_US;
+  if (slew)
+  {
+    struct timeval delta = {(time_t)(offset / 1000000), (suseconds_t)(offset % 1000000)};
+    adjtime(&delta, NULL);
+    ntpStatus.slewed++;
+  }
+  else
+  {
+    struct timeval zero = {0, 0};
+    adjtime(&zero, NULL); // a slew still running would be wrong after the step
+    int64_t us = ntpNowUs() + offset;
+    struct timeval tv = {(time_t)(us / 1000000), (suseconds_t)(us % 1000000)};
+    settimeofday(&tv, NULL);
+    ntpStatus.stepped++;
+  }
+
+  char line[120];
+  sprintf(line, "[TIME] NTP %s: offset %lld us, delay %lld us, %s", ntpServers[s.server], (long long)offset,
+          (long long)s.delay, slew ? "slewing" : "stepped");
+  Serial.println(line);
+}
+
+// one round over all servers, true if the clock was set
+bool ntpRound()
+{
+  ntpsample samples[NTP_SERVERS * NTP_SAMPLES];
+  int n = 0;
+  ntpStatus.rounds++;
+  for (uint8_t server = 0; server < NTP_SERVERS; server++)
+    for (int i = 0; i < NTP_SAMPLES; i++)
+      if (ntpQuery(server, samples[n]))
+        n++;
+  if (n == 0)
+    return false;
+
+  // median offset (insertion sort, there are only a handful)
+  int64_t offsets[NTP_SERVERS * NTP_SAMPLES];
+  for (int i = 0; i < n; i++)
+  {
+    int j = i;
+    for (; j > 0 && offsets[j - 1] > samples[i].offset; j--)
+      offsets[j] = offsets[j - 1];
+    offsets[j] = samples[i].offset;
+  }
+  int64_t median = n % 2 ? offsets[n / 2] : (offsets[n / 2 - 1] + offsets[n / 2]) / 2;
+
+  int best = -1;
+  for (int i = 0; i < n; i++)
+  {
+    if (llabs(samples[i].offset - median) > NTP_OUTLIER_US + samples[i].delay)
+    {
+      ntpStatus.dropped++;
+      continue;
+    }
+    if (best < 0 || samples[i].delay < samples[best].delay)
+      best = i;
+  }
+  if (best < 0)
+    return false;
+
+  const ntpsample &s = samples[best];
+  // true time at the moment the reply arrived, against esp_timer at that moment
+  driftReference(s.local + s.offset, DRIFT_NTP, s.mono);
+  ntpApply(s);
+  ntpStatus.synced++;
+  ntpStatus.offset = s.offset;
+  ntpStatus.delay = s.delay;
+  ntpStatus.server = s.server;
+  ntpStatus.millis = millis();
+  return true;
+}
+
+void ntpTask(void *pvParameters)
+{
+  bool bound = false;
+  while (1)
+  {
+    xEventGroupWaitBits(wifiEvents, WIFI_EV_ONLINE, pdFALSE, pdTRUE, portMAX_DELAY);
+    if (!bound) // not before the network stack is up, this task starts before WiFi
+      bound = ntpUDP.begin(NTP_LOCAL_PORT);
+    bool ok = ntpRound();
+    char line[100];
+    sprintf(line, "[TIME] NTP round %lu: %s, %lu sent, %lu replies, %lu dropped so far", (unsigned long)ntpStatus.rounds,
+            ok ? "synced" : "failed", (unsigned long)ntpStatus.sent, (unsigned long)ntpStatus.replies, (unsigned long)ntpStatus.dropped);
+    Serial.println(line);
+    vTaskDelay(pdMS_TO_TICKS((ok ? NTP_INTERVAL : NTP_RETRY) * 1000UL));
+  }
+}
+
+void ntpBegin()
+{
+  xTaskCreatePinnedToCore(
+      ntpTask,     /* Function to implement the task */
+      "ntp",       /* Name of the task */
+      4096,        /* Stack size in words */
+      NULL,        /* Task input parameter */
+      1,           /* Priority of the task */
+      NULL,        /* Task handle. */
+      0);          /* Core where the task should run */
+}
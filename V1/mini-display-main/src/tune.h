@@ -0,0 +1,104 @@
+// packed note format
+//
+// a note is a pitch plus a note value, not Hz/ms, so it fits in 11 bits:
+//   bits 0-6  pitch, index into pitchTable (0 = rest)
+//   bits 7-9  length as a power-of-two division of a whole note (0 = whole ... 5 = 1/32)
+//   bit 10    dotted (1.5x length)
+// the tempo is stored once per tune, the same way RTTTL does it.
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdint.h>
+#include "pitches.h"
+
+typedef uint16_t note;
+
+typedef struct
+{
+  const note *notes;
+  uint16_t length;
+  uint16_t bpm; // quarter notes per minute
+} tune;
+
+// header of a tune file on flash, followed by its notes
+#define TUNE_MAGIC "TUN1"
+#define TUNE_NAME_LEN 16
+
+typedef struct
+{
+  char magic[4];
+  uint16_t bpm;
+  uint16_t reserved;
+  char name[TUNE_NAME_LEN]; // not necessarily null terminated
+} tuneheader;
+
+constexpr uint16_t pitchTable[] = {
+    REST,
+    NOTE_B0,
+    NOTE_C1, NOTE_CS1, NOTE_D1, NOTE_DS1, NOTE_E1, NOTE_F1, NOTE_FS1, NOTE_G1, NOTE_GS1, NOTE_A1, NOTE_AS1, NOTE_B1,
+    NOTE_C2, NOTE_CS2, NOTE_D2, NOTE_DS2, NOTE_E2, NOTE_F2, NOTE_FS2, NOTE_G2, NOTE_GS2, NOTE_A2, NOTE_AS2, NOTE_B2,
+    NOTE_C3, NOTE_CS3, NOTE_D3, NOTE_DS3, NOTE_E3, NOTE_F3, NOTE_FS3, NOTE_G3, NOTE_GS3, NOTE_A3, NOTE_AS3, NOTE_B3,
+    NOTE_C4, NOTE_CS4, NOTE_D4, NOTE_DS4, NOTE_E4, NOTE_F4, NOTE_FS4, NOTE_G4, NOTE_GS4, NOTE_A4, NOTE_AS4, NOTE_B4,
+    NOTE_C5, NOTE_CS5, NOTE_D5, NOTE_DS5, NOTE_E5, NOTE_F5, NOTE_FS5, NOTE_G5, NOTE_GS5, NOTE_A5, NOTE_AS5, NOTE_B5,
+    NOTE_C6, NOTE_CS6, NOTE_D6, NOTE_DS6, NOTE_E6, NOTE_F6, NOTE_FS6, NOTE_G6, NOTE_GS6, NOTE_A6, NOTE_AS6, NOTE_B6,
+    NOTE_C7, NOTE_CS7, NOTE_D7, NOTE_DS7, NOTE_E7, NOTE_F7, NOTE_FS7, NOTE_G7, NOTE_GS7, NOTE_A7, NOTE_AS7, NOTE_B7,
+    NOTE_C8, NOTE_CS8, NOTE_D8, NOTE_DS8,
+};
+#define NUM_PITCHES (uint8_t)(sizeof(pitchTable) / sizeof(uint16_t))
+
+#define NOTE_PITCH_MASK 0x7f
+#define NOTE_DIV_SHIFT 7
+#define NOTE_DOTTED (1 << 10)
+#define NOTE_MAX_DIV 32
+
+// the sequencer keeps a note's length in 16 bits of ms. a dotted whole note is 360000/bpm ms,
+// which only fits from 6 bpm up, so slower tempos are refused wherever a tune comes in
+#define TUNE_MIN_BPM 6
+#define TUNE_MAX_BPM 900
+static_assert(360000 / TUNE_MIN_BPM <= 0xffff, "a dotted whole note has to fit the sequencer");
+
+inline bool validBpm(uint16_t bpm)
+{
+  return bpm >= TUNE_MIN_BPM && bpm <= TUNE_MAX_BPM;
+}
+
+// never defined: reaching one of these while building a constexpr table fails the build
+uint8_t pitchNotInTable();
+uint8_t divisionNotPowerOfTwo();
+
+constexpr uint8_t pitchIndex(uint16_t freq, uint8_t i = 0)
+{
+  return i == NUM_PITCHES ? pitchNotInTable() : pitchTable[i] == freq ? i : pitchIndex(freq, i + 1);
+}
+
+constexpr uint8_t divisionShift(uint8_t division, uint8_t shift = 0)
+{
+  return (1 << shift) > NOTE_MAX_DIV ? divisionNotPowerOfTwo() : (1 << shift) == division ? shift : divisionShift(division, shift + 1);
+}
+
+// N(NOTE_A4, 8) is an eighth note A4, N(NOTE_A4, 8, true) a dotted eighth
+constexpr note N(uint16_t freq, uint8_t division, bool dotted = false)
+{
+  return pitchIndex(freq) | divisionShift(division) << NOTE_DIV_SHIFT | (dotted ? NOTE_DOTTED : 0);
+}
+
+// same as N() but from a pitch index, for notes that are built at runtime
+inline note packNote(uint8_t pitch, uint8_t shift, bool dotted)
+{
+  return pitch | shift << NOTE_DIV_SHIFT | (dotted ? NOTE_DOTTED : 0);
+}
+
+inline uint16_t noteFreq(note n)
+{
+  uint8_t pitch = n & NOTE_PITCH_MASK;
+  return pitch < NUM_PITCHES ? pitchTable[pitch] : REST;
+}
+
+inline uint32_t noteMs(note n, uint16_t bpm)
+{
+  uint32_t ms = (240000UL / bpm) >> ((n >> NOTE_DIV_SHIFT) & 7); // a whole note is 4 beats
+  return (n & NOTE_DOTTED) ? ms + ms / 2 : ms;
+}
+
+#endif
@@ -0,0 +1,353 @@
+// custom ringtones stored on SPIFFS
+//
+// tunes are uploaded as RTTTL text or as a binary note stream and land in /tunes/<slot>.tun
+// in the same packed format the built-in songs use (see tune.h). uploads are validated and
+// converted chunk by chunk as they arrive, and playback streams the file through the
+// sequencer, so a tune is never held in RAM as a whole.
+//
+// file layout: tuneheader (tune.h) followed by little-endian 16-bit notes up to the end of
+// the file. a binary upload is the exact same layout.
+
+#include <ESPAsyncWebServer.h>
+#include "SPIFFS.h"
+#include "rtttl.h"
+
+#define TUNE_DIR "/tunes"
+#define TUNE_UPLOAD_PATH TUNE_DIR "/upload.tmp"
+#define TUNE_SLOTS 8
+#define TUNE_MAX_NOTES 2048
+#define TUNE_UPLOAD_TIMEOUT 10000 // ms without a chunk before an upload counts as abandoned
+#define CUSTOM_SONG_BASE 10        // alarm song 11 is slot 1, 12 is slot 2, ...
+
+String tunePath(int slot)
+{
+  return String(TUNE_DIR "/") + String(slot) + ".tun";
+}
+
+bool isCustomSong(int song)
+{
+  return song > CUSTOM_SONG_BASE && song <= CUSTOM_SONG_BASE + TUNE_SLOTS;
+}
+
+bool validNote(note n)
+{
+  return (n & NOTE_PITCH_MASK) < NUM_PITCHES && (1 << ((n >> NOTE_DIV_SHIFT) & 7)) <= NOTE_MAX_DIV && !(n >> 11);
+}
+
+// fills in name (null terminated) if slot holds a tune
+bool tuneName(int slot, char *name)
+{
+  File f = SPIFFS.open(tunePath(slot), FILE_READ);
+  tuneheader h;
+  bool ok = f && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && !memcmp(h.magic, TUNE_MAGIC, 4);
+  if (ok)
+  {
+    memcpy(name, h.name, TUNE_NAME_LEN);
+    name[TUNE_NAME_LEN] = 0;
+  }
+  f.close();
+  return ok;
+}
+
+bool deleteTune(int slot)
+{
+  if (slot < 1 || slot > TUNE_SLOTS)
+    return false;
+  return SPIFFS.remove(tunePath(slot));
+}
+
+// ------------------------------------------ UPLOAD ------------------------------------------
+
+typedef enum
+{
+  UPLOAD_IDLE,
+  UPLOAD_SNIFF, // waiting for the first 4 bytes to tell binary from RTTTL
+  UPLOAD_RTTTL,
+  UPLOAD_BINARY,
+  UPLOAD_DONE,
+  UPLOAD_FAILED,
+} uploadstate;
+
+// only one upload at a time, the web server owns it between the first and final chunk
+struct
+{
+  AsyncWebServerRequest *owner;
+  unsigned long lastChunk; // millis() of the last chunk, a dropped client never calls us again
+  uint8_t state;
+  const char *error;
+  int slot;
+  File file;
+  bool headerWritten;
+  tuneheader header;
+  uint8_t headerLen; // sniffing, binary: header bytes received so far
+  uint8_t lowByte;   // binary: first half of a note split across chunks
+  bool haveLowByte;
+  uint16_t count;
+  rtttlparser rtttl;
+  note pending[32];
+  uint8_t pendingLen;
+} tuneUpload;
+
+void uploadFail(const char *error)
+{
+  tuneUpload.state = UPLOAD_FAILED;
+  tuneUpload.error = error;
+}
+
+void uploadFlush()
+{
+  if (tuneUpload.pendingLen == 0)
+    return;
+  size_t bytes = tuneUpload.pendingLen * sizeof(note);
+  if (tuneUpload.file.write((uint8_t *)tuneUpload.pending, bytes) != bytes)
+    uploadFail("flash is full");
+  tuneUpload.pendingLen = 0;
+}
+
+void uploadNote(note n)
+{
+  if (!validNote(n))
+    return uploadFail("invalid note");
+  if (tuneUpload.count == TUNE_MAX_NOTES)
+    return uploadFail("tune is too long");
+
+  if (!tuneUpload.headerWritten)
+  {
+    if (!validBpm(tuneUpload.header.bpm))
+      return uploadFail("invalid tempo");
+    tuneUpload.file.write((uint8_t *)&tuneUpload.header, sizeof(tuneheader));
+    tuneUpload.headerWritten = true;
+  }
+
+  tuneUpload.pending[tuneUpload.pendingLen++] = n;
+  tuneUpload.count++;
+  if (tuneUpload.pendingLen == sizeof(tuneUpload.pending) / sizeof(note))
+    uploadFlush();
+}
+
+void uploadBinary(const uint8_t *data, size_t len)
+{
+  size_t i = 0;
+  while (i < len && tuneUpload.headerLen < sizeof(tuneheader))
+    ((uint8_t *)&tuneUpload.header)[tuneUpload.headerLen++] = data[i++];
+  if (tuneUpload.headerLen < sizeof(tuneheader))
+    return;
+
+  if (memcmp(tuneUpload.header.magic, TUNE_MAGIC, 4) || !validBpm(tuneUpload.header.bpm))
+    return uploadFail("invalid header");
+
+  for (; i < len && tuneUpload.state == UPLOAD_BINARY; i++)
+  {
+    if (!tuneUpload.haveLowByte)
+    {
+      tuneUpload.lowByte = data[i];
+      tuneUpload.haveLowByte = true;
+    }
+    else
+    {
+      tuneUpload.haveLowByte = false;
+      uploadNote(tuneUpload.lowByte | data[i] << 8);
+    }
+  }
+}
+
+void uploadRTTTL(const uint8_t *data, size_t len)
+{
+  note n;
+  for (size_t i = 0; i < len && tuneUpload.state == UPLOAD_RTTTL; i++)
+  {
+    int r = rtttlFeed(tuneUpload.rtttl, (char)data[i], n);
+    if (r < 0)
+      return uploadFail("invalid RTTTL");
+    if (r)
+    {
+      tuneUpload.header.bpm = tuneUpload.rtttl.bpm;
+      uploadNote(n);
+    }
+  }
+}
+
+int freeTuneSlot()
+{
+  for (int slot = 1; slot <= TUNE_SLOTS; slot++)
+    if (!SPIFFS.exists(tunePath(slot)))
+      return slot;
+  return 0;
+}
+
+void uploadBegin(AsyncWebServerRequest *request)
+{
+  tuneUpload.owner = request;
+  tuneUpload.error = NULL;
+  tuneUpload.headerWritten = false;
+  tuneUpload.headerLen = 0;
+  tuneUpload.haveLowByte = false;
+  tuneUpload.count = 0;
+  tuneUpload.pendingLen = 0;
+  memset(&tuneUpload.header, 0, sizeof(tuneheader));
+
+  tuneUpload.slot = freeTuneSlot();
+  if (tuneUpload.slot == 0)
+    return uploadFail("all tune slots are used");
+
+  tuneUpload.file = SPIFFS.open(TUNE_UPLOAD_PATH, FILE_WRITE, true);
+  if (!tuneUpload.file)
+    return uploadFail("cannot open file");
+
+  tuneUpload.state = UPLOAD_SNIFF;
+}
+
+// a binary upload starts with TUNE_MAGIC, anything else is RTTTL. the first chunk can be
+// shorter than that, so the bytes are gathered in the header like uploadBinary() does.
+// returns how many bytes of data it used
+size_t uploadSniff(const String &filename, const uint8_t *data, size_t len, bool final)
+{
+  size_t i = 0;
+  while (i < len && tuneUpload.headerLen < 4)
+    ((uint8_t *)&tuneUpload.header)[tuneUpload.headerLen++] = data[i++];
+  if (tuneUpload.headerLen < 4 && !final)
+    return i;
+
+  if (tuneUpload.headerLen == 4 && !memcmp(tuneUpload.header.magic, TUNE_MAGIC, 4))
+  {
+    tuneUpload.state = UPLOAD_BINARY; // carries on filling the header
+    return i;
+  }
+
+  uint8_t start[4];
+  uint8_t startLen = tuneUpload.headerLen;
+  memcpy(start, &tuneUpload.header, startLen);
+
+  // name the tune after the file, minus the extension
+  tuneUpload.state = UPLOAD_RTTTL;
+  tuneUpload.headerLen = 0;
+  rtttlBegin(tuneUpload.rtttl);
+  memset(&tuneUpload.header, 0, sizeof(tuneheader));
+  memcpy(tuneUpload.header.magic, TUNE_MAGIC, 4);
+  int dot = filename.lastIndexOf('.');
+  String name = dot > 0 ? filename.substring(0, dot) : filename;
+  memcpy(tuneUpload.header.name, name.c_str(), min((size_t)TUNE_NAME_LEN, (size_t)name.length()));
+
+  uploadRTTTL(start, startLen);
+  return i;
+}
+
+// ESPAsyncWebServer upload callback, called once per received chunk
+void handleTuneUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)
+{
+  if (index == 0)
+  {
+    if (tuneUpload.owner != NULL && millis() - tuneUpload.lastChunk < TUNE_UPLOAD_TIMEOUT)
+      return; // someone else is uploading, handleTuneDone() will refuse this one
+    tuneUpload.file.close();
+    uploadBegin(request);
+  }
+  if (tuneUpload.owner != request)
+    return;
+  tuneUpload.lastChunk = millis();
+
+  if (tuneUpload.state == UPLOAD_SNIFF)
+  {
+    size_t used = uploadSniff(filename, data, len, final);
+    data += used;
+    len -= used;
+  }
+  if (tuneUpload.state == UPLOAD_BINARY)
+    uploadBinary(data, len);
+  else if (tuneUpload.state == UPLOAD_RTTTL)
+    uploadRTTTL(data, len);
+
+  if (!final)
+    return;
+
+  if (tuneUpload.state == UPLOAD_RTTTL)
+  {
+    note n;
+    int r = rtttlEnd(tuneUpload.rtttl, n);
+    if (r < 0)
+      uploadFail("invalid RTTTL");
+    else if (r)
+      uploadNote(n);
+  }
+  if (tuneUpload.state == UPLOAD_BINARY && (tuneUpload.headerLen < sizeof(tuneheader) || tuneUpload.haveLowByte))
+    uploadFail("truncated tune");
+  if (tuneUpload.state != UPLOAD_FAILED && tuneUpload.count == 0)
+    uploadFail("tune has no notes");
+  if (tuneUpload.state != UPLOAD_FAILED)
+    uploadFlush();
+
+  tuneUpload.file.close();
+  if (tuneUpload.state != UPLOAD_FAILED && SPIFFS.rename(TUNE_UPLOAD_PATH, tunePath(tuneUpload.slot).c_str()))
+    tuneUpload.state = UPLOAD_DONE;
+  else
+  {
+    if (tuneUpload.state != UPLOAD_FAILED)
+      uploadFail("cannot save tune");
+    SPIFFS.remove(TUNE_UPLOAD_PATH);
+  }
+}
+
+// request handler for POST /tune, runs after the last chunk
+void handleTuneDone(AsyncWebServerRequest *request)
+{
+  if (tuneUpload.owner != request)
+  {
+    if (tuneUpload.owner == NULL)
+      request->send(400, "text/plain", "no file received");
+    else
+      request->send(409, "text/plain", "another upload is in progress");
+    return;
+  }
+
+  if (tuneUpload.state == UPLOAD_DONE)
+  {
+    SLOGI("[CODE] Saved tune to slot %d, notes: %u", tuneUpload.slot, tuneUpload.count);
+    request->send(200, "text/plain", String(CUSTOM_SONG_BASE + tuneUpload.slot));
+  }
+  else
+  {
+    SLOGW("[CODE] Tune upload failed: %s", tuneUpload.error);
+    request->send(400, "text/plain", tuneUpload.error);
+  }
+
+  tuneUpload.owner = NULL;
+  tuneUpload.state = UPLOAD_IDLE;
+}
+
+// ------------------------------------------ PLAYBACK ------------------------------------------
+
+// notesource over a tune file, reads straight from flash into the sequencer ring
+typedef struct
+{
+  File file;
+} filecursor;
+
+int fileRead(void *ctx, note *buf, int max)
+{
+  filecursor *c = (filecursor *)ctx;
+  int n = c->file.read((uint8_t *)buf, max * sizeof(note)) / sizeof(note);
+  for (int i = 0; i < n; i++)
+    if (!validNote(buf[i]))
+      buf[i] = REST; // a corrupted file plays silence instead of garbage
+  return n;
+}
+
+bool fileRewind(void *ctx)
+{
+  filecursor *c = (filecursor *)ctx;
+  return c->file.seek(sizeof(tuneheader)) && c->file.size() > sizeof(tuneheader);
+}
+
+bool fileSource(filecursor &c, int slot, notesource &src)
+{
+  c.file.close();
+  c.file = SPIFFS.open(tunePath(slot), FILE_READ);
+  tuneheader h;
+  if (!c.file || c.file.read((uint8_t *)&h, sizeof(h)) != sizeof(h) || memcmp(h.magic, TUNE_MAGIC, 4) || !validBpm(h.bpm))
+  {
+    c.file.close();
+    return false;
+  }
+  src = {fileRead, fileRewind, &c, h.bpm};
+  return true;
+}
@@ -0,0 +1,89 @@
+// time zones
+//
+// the system clock stays on UTC (no TZ variable, nothing parses POSIX TZ strings). local time
+// is UTC plus the offset of the selected zone at that moment, found by a binary search in the
+// zone's transition table. the tables are constexpr arrays in tzdata.h, generated from the tz
+// database by tools/gen_tz.py, and cover 2024-2050.
+//
+// the zone is picked on the settings page and kept in NVS by name, so regenerating the tables
+// with zones added or reordered doesn't change anyone's selection.
+
+#include <Preferences.h>
+
+#define TZ_DEFAULT "Asia/Kuala_Lumpur" // GMT+8, what the clock was hard-coded to before
+
+typedef struct
+{
+  const char *name;
+  const uint32_t *at;    // UTC the offset starts, ascending, at[0] == 0
+  const int16_t *offset; // minutes east of UTC
+  uint16_t count;
+  int16_t standard;      // minutes, the zone's offset without DST
+} tzzone;
+
+#include "tzdata.h"
+
+#define TZ_ZONES (sizeof(tzZones) / sizeof(tzZones[0]))
+
+const tzzone *tzZone = &tzZones[0];
+Preferences tzPrefs;
+
+// seconds to add to utc for the local time
+int32_t tzOffset(time_t utc)
+{
+  const tzzone *z = tzZone;
+  uint16_t lo = 0, hi = z->count; // last entry with at <= utc is in [lo, hi)
+  while (hi - lo > 1)
+  {
+    uint16_t mid = (lo + hi) / 2;
+    if ((uint32_t)utc >= z->at[mid])
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return z->offset[lo] * 60;
+}
+
+time_t tzLocal(time_t utc)
+{
+  return utc + tzOffset(utc);
+}
+
+// broken-down local time now
+tm tzNow()
+{
+  time_t local = tzLocal(time(NULL));
+  tm t;
+  gmtime_r(&local, &t);
+  return t;
+}
+
+int tzFind(const char *name)
+{
+  for (size_t i = 0; i < TZ_ZONES; i++)
+    if (strcmp(tzZones[i].name, name) == 0)
+      return (int)i;
+  return -1;
+}
+
+// switches to the named zone and remembers it, false if we don't have it
+bool tzSelect(const char *name)
+{
+  int i = tzFind(name);
+  if (i < 0)
+    return false;
+  tzZone = &tzZones[i];
+  tzPrefs.putString("zone", name);
+  return true;
+}
+
+void tzBegin()
+{
+  tzPrefs.begin("tz", false);
+  int i = tzFind(tzPrefs.getString("zone", TZ_DEFAULT).c_str());
+  tzZone = &tzZones[i < 0 ? tzFind(TZ_DEFAULT) : i];
+
+  char line[80];
+  sprintf(line, "[TIME] Time zone %s, standard time UTC%+d min", tzZone->name, tzZone->standard);
+  Serial.println(line);
+}
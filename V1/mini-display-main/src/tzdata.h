@@ -0,0 +1,386 @@
+// generated by tools/gen_tz.py from tzdata 2025b, 2024-2050. do not edit
+
+constexpr uint32_t tzAt_Pacific_Honolulu[] = {0};
+constexpr int16_t tzOff_Pacific_Honolulu[] = {-600};
+constexpr uint32_t tzAt_America_Anchorage[] = {
+    0, 1710068400, 1730628000, 1741518000, 1762077600, 1772967600, 1793527200, 1805022000,
+    1825581600, 1836471600, 1857031200, 1867921200, 1888480800, 1899370800, 1919930400, 1930820400,
+    1951380000, 1962874800, 1983434400, 1994324400, 2014884000, 2025774000, 2046333600, 2057223600,
+    2077783200, 2088673200, 2109232800, 2120122800, 2140682400, 2152177200, 2172736800, 2183626800,
+    2204186400, 2215076400, 2235636000, 2246526000, 2267085600, 2277975600, 2298535200, 2309425200,
+    2329984800, 2341479600, 2362039200, 2372929200, 2393488800, 2404378800, 2424938400, 2435828400,
+    2456388000, 2467278000, 2487837600, 2499332400, 2519892000, 2530782000, 2551341600,
+};
+constexpr int16_t tzOff_America_Anchorage[] = {
+    -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480,
+    -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480,
+    -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480, -540, -480,
+    -540, -480, -540, -480, -540, -480, -540,
+};
+constexpr uint32_t tzAt_America_Los_Angeles[] = {
+    0, 1710064800, 1730624400, 1741514400, 1762074000, 1772964000, 1793523600, 1805018400,
+    1825578000, 1836468000, 1857027600, 1867917600, 1888477200, 1899367200, 1919926800, 1930816800,
+    1951376400, 1962871200, 1983430800, 1994320800, 2014880400, 2025770400, 2046330000, 2057220000,
+    2077779600, 2088669600, 2109229200, 2120119200, 2140678800, 2152173600, 2172733200, 2183623200,
+    2204182800, 2215072800, 2235632400, 2246522400, 2267082000, 2277972000, 2298531600, 2309421600,
+    2329981200, 2341476000, 2362035600, 2372925600, 2393485200, 2404375200, 2424934800, 2435824800,
+    2456384400, 2467274400, 2487834000, 2499328800, 2519888400, 2530778400, 2551338000,
+};
+constexpr int16_t tzOff_America_Los_Angeles[] = {
+    -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420,
+    -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420,
+    -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420, -480, -420,
+    -480, -420, -480, -420, -480, -420, -480,
+};
+constexpr uint32_t tzAt_America_Denver[] = {
+    0, 1710061200, 1730620800, 1741510800, 1762070400, 1772960400, 1793520000, 1805014800,
+    1825574400, 1836464400, 1857024000, 1867914000, 1888473600, 1899363600, 1919923200, 1930813200,
+    1951372800, 1962867600, 1983427200, 1994317200, 2014876800, 2025766800, 2046326400, 2057216400,
+    2077776000, 2088666000, 2109225600, 2120115600, 2140675200, 2152170000, 2172729600, 2183619600,
+    2204179200, 2215069200, 2235628800, 2246518800, 2267078400, 2277968400, 2298528000, 2309418000,
+    2329977600, 2341472400, 2362032000, 2372922000, 2393481600, 2404371600, 2424931200, 2435821200,
+    2456380800, 2467270800, 2487830400, 2499325200, 2519884800, 2530774800, 2551334400,
+};
+constexpr int16_t tzOff_America_Denver[] = {
+    -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360,
+    -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360,
+    -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360, -420, -360,
+    -420, -360, -420, -360, -420, -360, -420,
+};
+constexpr uint32_t tzAt_America_Phoenix[] = {0};
+constexpr int16_t tzOff_America_Phoenix[] = {-420};
+constexpr uint32_t tzAt_America_Chicago[] = {
+    0, 1710057600, 1730617200, 1741507200, 1762066800, 1772956800, 1793516400, 1805011200,
+    1825570800, 1836460800, 1857020400, 1867910400, 1888470000, 1899360000, 1919919600, 1930809600,
+    1951369200, 1962864000, 1983423600, 1994313600, 2014873200, 2025763200, 2046322800, 2057212800,
+    2077772400, 2088662400, 2109222000, 2120112000, 2140671600, 2152166400, 2172726000, 2183616000,
+    2204175600, 2215065600, 2235625200, 2246515200, 2267074800, 2277964800, 2298524400, 2309414400,
+    2329974000, 2341468800, 2362028400, 2372918400, 2393478000, 2404368000, 2424927600, 2435817600,
+    2456377200, 2467267200, 2487826800, 2499321600, 2519881200, 2530771200, 2551330800,
+};
+constexpr int16_t tzOff_America_Chicago[] = {
+    -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300,
+    -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300,
+    -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300, -360, -300,
+    -360, -300, -360, -300, -360, -300, -360,
+};
+constexpr uint32_t tzAt_America_Mexico_City[] = {0};
+constexpr int16_t tzOff_America_Mexico_City[] = {-360};
+constexpr uint32_t tzAt_America_New_York[] = {
+    0, 1710054000, 1730613600, 1741503600, 1762063200, 1772953200, 1793512800, 1805007600,
+    1825567200, 1836457200, 1857016800, 1867906800, 1888466400, 1899356400, 1919916000, 1930806000,
+    1951365600, 1962860400, 1983420000, 1994310000, 2014869600, 2025759600, 2046319200, 2057209200,
+    2077768800, 2088658800, 2109218400, 2120108400, 2140668000, 2152162800, 2172722400, 2183612400,
+    2204172000, 2215062000, 2235621600, 2246511600, 2267071200, 2277961200, 2298520800, 2309410800,
+    2329970400, 2341465200, 2362024800, 2372914800, 2393474400, 2404364400, 2424924000, 2435814000,
+    2456373600, 2467263600, 2487823200, 2499318000, 2519877600, 2530767600, 2551327200,
+};
+constexpr int16_t tzOff_America_New_York[] = {
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300,
+};
+constexpr uint32_t tzAt_America_Toronto[] = {
+    0, 1710054000, 1730613600, 1741503600, 1762063200, 1772953200, 1793512800, 1805007600,
+    1825567200, 1836457200, 1857016800, 1867906800, 1888466400, 1899356400, 1919916000, 1930806000,
+    1951365600, 1962860400, 1983420000, 1994310000, 2014869600, 2025759600, 2046319200, 2057209200,
+    2077768800, 2088658800, 2109218400, 2120108400, 2140668000, 2152162800, 2172722400, 2183612400,
+    2204172000, 2215062000, 2235621600, 2246511600, 2267071200, 2277961200, 2298520800, 2309410800,
+    2329970400, 2341465200, 2362024800, 2372914800, 2393474400, 2404364400, 2424924000, 2435814000,
+    2456373600, 2467263600, 2487823200, 2499318000, 2519877600, 2530767600, 2551327200,
+};
+constexpr int16_t tzOff_America_Toronto[] = {
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240, -300, -240,
+    -300, -240, -300, -240, -300, -240, -300,
+};
+constexpr uint32_t tzAt_America_Bogota[] = {0};
+constexpr int16_t tzOff_America_Bogota[] = {-300};
+constexpr uint32_t tzAt_America_Santiago[] = {
+    0, 1712458800, 1725768000, 1743908400, 1757217600, 1775358000, 1788667200, 1806807600,
+    1820116800, 1838257200, 1851566400, 1870311600, 1883016000, 1901761200, 1915070400, 1933210800,
+    1946520000, 1964660400, 1977969600, 1996110000, 2009419200, 2027559600, 2040868800, 2059614000,
+    2072318400, 2091063600, 2104372800, 2122513200, 2135822400, 2153962800, 2167272000, 2185412400,
+    2198721600, 2217466800, 2230171200, 2248916400, 2262225600, 2280366000, 2293675200, 2311815600,
+    2325124800, 2343265200, 2356574400, 2374714800, 2388024000, 2406769200, 2419473600, 2438218800,
+    2451528000, 2469668400, 2482977600, 2501118000, 2514427200, 2532567600, 2545876800,
+};
+constexpr int16_t tzOff_America_Santiago[] = {
+    -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240,
+    -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240,
+    -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240, -180, -240,
+    -180, -240, -180, -240, -180, -240, -180,
+};
+constexpr uint32_t tzAt_America_Sao_Paulo[] = {0};
+constexpr int16_t tzOff_America_Sao_Paulo[] = {-180};
+constexpr uint32_t tzAt_America_Argentina_Buenos_Aires[] = {0};
+constexpr int16_t tzOff_America_Argentina_Buenos_Aires[] = {-180};
+constexpr uint32_t tzAt_Atlantic_Reykjavik[] = {0};
+constexpr int16_t tzOff_Atlantic_Reykjavik[] = {0};
+constexpr uint32_t tzAt_UTC[] = {0};
+constexpr int16_t tzOff_UTC[] = {0};
+constexpr uint32_t tzAt_Europe_London[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_London[] = {
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0,
+};
+constexpr uint32_t tzAt_Europe_Lisbon[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Lisbon[] = {
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60, 0, 60,
+    0, 60, 0, 60, 0, 60, 0,
+};
+constexpr uint32_t tzAt_Europe_Berlin[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Berlin[] = {
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60,
+};
+constexpr uint32_t tzAt_Europe_Paris[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Paris[] = {
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60,
+};
+constexpr uint32_t tzAt_Europe_Madrid[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Madrid[] = {
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60,
+};
+constexpr uint32_t tzAt_Europe_Rome[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Rome[] = {
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120, 60, 120,
+    60, 120, 60, 120, 60, 120, 60,
+};
+constexpr uint32_t tzAt_Europe_Athens[] = {
+    0, 1711846800, 1729990800, 1743296400, 1761440400, 1774746000, 1792890000, 1806195600,
+    1824944400, 1837645200, 1856394000, 1869094800, 1887843600, 1901149200, 1919293200, 1932598800,
+    1950742800, 1964048400, 1982797200, 1995498000, 2014246800, 2026947600, 2045696400, 2058397200,
+    2077146000, 2090451600, 2108595600, 2121901200, 2140045200, 2153350800, 2172099600, 2184800400,
+    2203549200, 2216250000, 2234998800, 2248304400, 2266448400, 2279754000, 2297898000, 2311203600,
+    2329347600, 2342653200, 2361402000, 2374102800, 2392851600, 2405552400, 2424301200, 2437606800,
+    2455750800, 2469056400, 2487200400, 2500506000, 2519254800, 2531955600, 2550704400,
+};
+constexpr int16_t tzOff_Europe_Athens[] = {
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120,
+};
+constexpr uint32_t tzAt_Europe_Istanbul[] = {0};
+constexpr int16_t tzOff_Europe_Istanbul[] = {180};
+constexpr uint32_t tzAt_Europe_Moscow[] = {0};
+constexpr int16_t tzOff_Europe_Moscow[] = {180};
+constexpr uint32_t tzAt_Africa_Lagos[] = {0};
+constexpr int16_t tzOff_Africa_Lagos[] = {60};
+constexpr uint32_t tzAt_Africa_Cairo[] = {
+    0, 1714082400, 1730408400, 1745532000, 1761858000, 1776981600, 1793307600, 1809036000,
+    1824757200, 1840485600, 1856206800, 1871935200, 1887656400, 1903384800, 1919710800, 1934834400,
+    1951160400, 1966888800, 1982610000, 1998338400, 2014059600, 2029788000, 2045509200, 2061237600,
+    2076958800, 2092687200, 2109013200, 2124136800, 2140462800, 2156191200, 2171912400, 2187640800,
+    2203362000, 2219090400, 2234811600, 2250540000, 2266866000, 2281989600, 2298315600, 2313439200,
+    2329765200, 2345493600, 2361214800, 2376943200, 2392664400, 2408392800, 2424114000, 2439842400,
+    2456168400, 2471292000, 2487618000, 2503346400, 2519067600, 2534796000, 2550517200,
+};
+constexpr int16_t tzOff_Africa_Cairo[] = {
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180, 120, 180,
+    120, 180, 120, 180, 120, 180, 120,
+};
+constexpr uint32_t tzAt_Africa_Johannesburg[] = {0};
+constexpr int16_t tzOff_Africa_Johannesburg[] = {120};
+constexpr uint32_t tzAt_Africa_Nairobi[] = {0};
+constexpr int16_t tzOff_Africa_Nairobi[] = {180};
+constexpr uint32_t tzAt_Asia_Dubai[] = {0};
+constexpr int16_t tzOff_Asia_Dubai[] = {240};
+constexpr uint32_t tzAt_Asia_Tehran[] = {0};
+constexpr int16_t tzOff_Asia_Tehran[] = {210};
+constexpr uint32_t tzAt_Asia_Karachi[] = {0};
+constexpr int16_t tzOff_Asia_Karachi[] = {300};
+constexpr uint32_t tzAt_Asia_Kolkata[] = {0};
+constexpr int16_t tzOff_Asia_Kolkata[] = {330};
+constexpr uint32_t tzAt_Asia_Kathmandu[] = {0};
+constexpr int16_t tzOff_Asia_Kathmandu[] = {345};
+constexpr uint32_t tzAt_Asia_Dhaka[] = {0};
+constexpr int16_t tzOff_Asia_Dhaka[] = {360};
+constexpr uint32_t tzAt_Asia_Bangkok[] = {0};
+constexpr int16_t tzOff_Asia_Bangkok[] = {420};
+constexpr uint32_t tzAt_Asia_Jakarta[] = {0};
+constexpr int16_t tzOff_Asia_Jakarta[] = {420};
+constexpr uint32_t tzAt_Asia_Kuala_Lumpur[] = {0};
+constexpr int16_t tzOff_Asia_Kuala_Lumpur[] = {480};
+constexpr uint32_t tzAt_Asia_Singapore[] = {0};
+constexpr int16_t tzOff_Asia_Singapore[] = {480};
+constexpr uint32_t tzAt_Asia_Shanghai[] = {0};
+constexpr int16_t tzOff_Asia_Shanghai[] = {480};
+constexpr uint32_t tzAt_Asia_Hong_Kong[] = {0};
+constexpr int16_t tzOff_Asia_Hong_Kong[] = {480};
+constexpr uint32_t tzAt_Asia_Manila[] = {0};
+constexpr int16_t tzOff_Asia_Manila[] = {480};
+constexpr uint32_t tzAt_Asia_Taipei[] = {0};
+constexpr int16_t tzOff_Asia_Taipei[] = {480};
+constexpr uint32_t tzAt_Asia_Seoul[] = {0};
+constexpr int16_t tzOff_Asia_Seoul[] = {540};
+constexpr uint32_t tzAt_Asia_Tokyo[] = {0};
+constexpr int16_t tzOff_Asia_Tokyo[] = {540};
+constexpr uint32_t tzAt_Australia_Perth[] = {0};
+constexpr int16_t tzOff_Australia_Perth[] = {480};
+constexpr uint32_t tzAt_Australia_Adelaide[] = {
+    0, 1712421000, 1728145800, 1743870600, 1759595400, 1775320200, 1791045000, 1806769800,
+    1822494600, 1838219400, 1853944200, 1869669000, 1885998600, 1901723400, 1917448200, 1933173000,
+    1948897800, 1964622600, 1980347400, 1996072200, 2011797000, 2027521800, 2043246600, 2058971400,
+    2075301000, 2091025800, 2106750600, 2122475400, 2138200200, 2153925000, 2169649800, 2185374600,
+    2201099400, 2216824200, 2233153800, 2248878600, 2264603400, 2280328200, 2296053000, 2311777800,
+    2327502600, 2343227400, 2358952200, 2374677000, 2390401800, 2406126600, 2422456200, 2438181000,
+    2453905800, 2469630600, 2485355400, 2501080200, 2516805000, 2532529800, 2548254600,
+};
+constexpr int16_t tzOff_Australia_Adelaide[] = {
+    630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570,
+    630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570,
+    630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570, 630, 570,
+    630, 570, 630, 570, 630, 570, 630,
+};
+constexpr uint32_t tzAt_Australia_Brisbane[] = {0};
+constexpr int16_t tzOff_Australia_Brisbane[] = {600};
+constexpr uint32_t tzAt_Australia_Sydney[] = {
+    0, 1712419200, 1728144000, 1743868800, 1759593600, 1775318400, 1791043200, 1806768000,
+    1822492800, 1838217600, 1853942400, 1869667200, 1885996800, 1901721600, 1917446400, 1933171200,
+    1948896000, 1964620800, 1980345600, 1996070400, 2011795200, 2027520000, 2043244800, 2058969600,
+    2075299200, 2091024000, 2106748800, 2122473600, 2138198400, 2153923200, 2169648000, 2185372800,
+    2201097600, 2216822400, 2233152000, 2248876800, 2264601600, 2280326400, 2296051200, 2311776000,
+    2327500800, 2343225600, 2358950400, 2374675200, 2390400000, 2406124800, 2422454400, 2438179200,
+    2453904000, 2469628800, 2485353600, 2501078400, 2516803200, 2532528000, 2548252800,
+};
+constexpr int16_t tzOff_Australia_Sydney[] = {
+    660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600,
+    660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600,
+    660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600, 660, 600,
+    660, 600, 660, 600, 660, 600, 660,
+};
+constexpr uint32_t tzAt_Pacific_Auckland[] = {
+    0, 1712412000, 1727532000, 1743861600, 1758981600, 1775311200, 1790431200, 1806760800,
+    1821880800, 1838210400, 1853330400, 1869660000, 1885384800, 1901714400, 1916834400, 1933164000,
+    1948284000, 1964613600, 1979733600, 1996063200, 2011183200, 2027512800, 2042632800, 2058962400,
+    2074687200, 2091016800, 2106136800, 2122466400, 2137586400, 2153916000, 2169036000, 2185365600,
+    2200485600, 2216815200, 2232540000, 2248869600, 2263989600, 2280319200, 2295439200, 2311768800,
+    2326888800, 2343218400, 2358338400, 2374668000, 2389788000, 2406117600, 2421842400, 2438172000,
+    2453292000, 2469621600, 2484741600, 2501071200, 2516191200, 2532520800, 2547640800,
+};
+constexpr int16_t tzOff_Pacific_Auckland[] = {
+    780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720,
+    780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720,
+    780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720, 780, 720,
+    780, 720, 780, 720, 780, 720, 780,
+};
+
+constexpr tzzone tzZones[] = {
+    {"Pacific/Honolulu", tzAt_Pacific_Honolulu, tzOff_Pacific_Honolulu, 1, -600},
+    {"America/Anchorage", tzAt_America_Anchorage, tzOff_America_Anchorage, 55, -540},
+    {"America/Los_Angeles", tzAt_America_Los_Angeles, tzOff_America_Los_Angeles, 55, -480},
+    {"America/Denver", tzAt_America_Denver, tzOff_America_Denver, 55, -420},
+    {"America/Phoenix", tzAt_America_Phoenix, tzOff_America_Phoenix, 1, -420},
+    {"America/Chicago", tzAt_America_Chicago, tzOff_America_Chicago, 55, -360},
+    {"America/Mexico_City", tzAt_America_Mexico_City, tzOff_America_Mexico_City, 1, -360},
+    {"America/New_York", tzAt_America_New_York, tzOff_America_New_York, 55, -300},
+    {"America/Toronto", tzAt_America_Toronto, tzOff_America_Toronto, 55, -300},
+    {"America/Bogota", tzAt_America_Bogota, tzOff_America_Bogota, 1, -300},
+    {"America/Santiago", tzAt_America_Santiago, tzOff_America_Santiago, 55, -240},
+    {"America/Sao_Paulo", tzAt_America_Sao_Paulo, tzOff_America_Sao_Paulo, 1, -180},
+    {"America/Argentina/Buenos_Aires", tzAt_America_Argentina_Buenos_Aires, tzOff_America_Argentina_Buenos_Aires, 1, -180},
+    {"Atlantic/Reykjavik", tzAt_Atlantic_Reykjavik, tzOff_Atlantic_Reykjavik, 1, 0},
+    {"UTC", tzAt_UTC, tzOff_UTC, 1, 0},
+    {"Europe/London", tzAt_Europe_London, tzOff_Europe_London, 55, 0},
+    {"Europe/Lisbon", tzAt_Europe_Lisbon, tzOff_Europe_Lisbon, 55, 0},
+    {"Europe/Berlin", tzAt_Europe_Berlin, tzOff_Europe_Berlin, 55, 60},
+    {"Europe/Paris", tzAt_Europe_Paris, tzOff_Europe_Paris, 55, 60},
+    {"Europe/Madrid", tzAt_Europe_Madrid, tzOff_Europe_Madrid, 55, 60},
+    {"Europe/Rome", tzAt_Europe_Rome, tzOff_Europe_Rome, 55, 60},
+    {"Europe/Athens", tzAt_Europe_Athens, tzOff_Europe_Athens, 55, 120},
+    {"Europe/Istanbul", tzAt_Europe_Istanbul, tzOff_Europe_Istanbul, 1, 180},
+    {"Europe/Moscow", tzAt_Europe_Moscow, tzOff_Europe_Moscow, 1, 180},
+    {"Africa/Lagos", tzAt_Africa_Lagos, tzOff_Africa_Lagos, 1, 60},
+    {"Africa/Cairo", tzAt_Africa_Cairo, tzOff_Africa_Cairo, 55, 120},
+    {"Africa/Johannesburg", tzAt_Africa_Johannesburg, tzOff_Africa_Johannesburg, 1, 120},
+    {"Africa/Nairobi", tzAt_Africa_Nairobi, tzOff_Africa_Nairobi, 1, 180},
+    {"Asia/Dubai", tzAt_Asia_Dubai, tzOff_Asia_Dubai, 1, 240},
+    {"Asia/Tehran", tzAt_Asia_Tehran, tzOff_Asia_Tehran, 1, 210},
+    {"Asia/Karachi", tzAt_Asia_Karachi, tzOff_Asia_Karachi, 1, 300},
+    {"Asia/Kolkata", tzAt_Asia_Kolkata, tzOff_Asia_Kolkata, 1, 330},
+    {"Asia/Kathmandu", tzAt_Asia_Kathmandu, tzOff_Asia_Kathmandu, 1, 345},
+    {"Asia/Dhaka", tzAt_Asia_Dhaka, tzOff_Asia_Dhaka, 1, 360},
+    {"Asia/Bangkok", tzAt_Asia_Bangkok, tzOff_Asia_Bangkok, 1, 420},
+    {"Asia/Jakarta", tzAt_Asia_Jakarta, tzOff_Asia_Jakarta, 1, 420},
+    {"Asia/Kuala_Lumpur", tzAt_Asia_Kuala_Lumpur, tzOff_Asia_Kuala_Lumpur, 1, 480},
+    {"Asia/Singapore", tzAt_Asia_Singapore, tzOff_Asia_Singapore, 1, 480},
+    {"Asia/Shanghai", tzAt_Asia_Shanghai, tzOff_Asia_Shanghai, 1, 480},
+    {"Asia/Hong_Kong", tzAt_Asia_Hong_Kong, tzOff_Asia_Hong_Kong, 1, 480},
+    {"Asia/Manila", tzAt_Asia_Manila, tzOff_Asia_Manila, 1, 480},
+    {"Asia/Taipei", tzAt_Asia_Taipei, tzOff_Asia_Taipei, 1, 480},
+    {"Asia/Seoul", tzAt_Asia_Seoul, tzOff_Asia_Seoul, 1, 540},
+    {"Asia/Tokyo", tzAt_Asia_Tokyo, tzOff_Asia_Tokyo, 1, 540},
+    {"Australia/Perth", tzAt_Australia_Perth, tzOff_Australia_Perth, 1, 480},
+    {"Australia/Adelaide", tzAt_Australia_Adelaide, tzOff_Australia_Adelaide, 55, 570},
+    {"Australia/Brisbane", tzAt_Australia_Brisbane, tzOff_Australia_Brisbane, 1, 600},
+    {"Australia/Sydney", tzAt_Australia_Sydney, tzOff_Australia_Sydney, 55, 600},
+    {"Pacific/Auckland", tzAt_Pacific_Auckland, tzOff_Pacific_Auckland, 55, 720},
+};
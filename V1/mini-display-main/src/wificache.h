@@ -0,0 +1,252 @@
+// fast WiFi reconnect
+//
+// a plain WiFi.begin(ssid, pwd) scans every channel for the network and then waits for DHCP,
+// which takes seconds. after a good connection we keep the AP's BSSID and channel, and the
+// DHCP lease with its length, in NVS. the next connect goes straight to that AP on that
+// channel and, if we're still within T1 of the lease (half of it, before a client would even
+// ask to renew), skips DHCP with a static config. once that's connected DHCP is started
+// again, so the router renews the lease in the background and the cache gets the new one. if
+// a directed connect doesn't work within WIFI_FAST_TIMEOUT the cache is dropped and it's a
+// full scan and DHCP again.
+//
+// the lease age needs the real time, which the ESP32 keeps over a restart but not over a
+// power cut, so after a cold start only the BSSID/channel part is used.
+//
+// connect times are counted per path in log2 buckets, kept in NVS and served on GET /wifistats.
+
+#include <WiFi.h>
+#include <Preferences.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_netif.h>
+#include <lwip/dhcp.h>
+
+#define WIFI_CACHE_VERSION 2
+#define WIFI_FAST_TIMEOUT 3000  // ms before a directed connect falls back to a full one
+#define WIFI_HIST_BUCKETS 9     // <125ms, <250ms, .. <16s, >=16s
+#define WIFI_HIST_FIRST_MS 125
+
+typedef enum
+{
+  WIFI_PATH_STATIC, // cached BSSID/channel and lease
+  WIFI_PATH_DIRECT, // cached BSSID/channel, DHCP
+  WIFI_PATH_FULL,   // scan and DHCP
+  WIFI_PATHS
+} wifipath;
+
+const char *wifiPathNames[WIFI_PATHS] = {"static", "direct", "full"};
+
+typedef struct
+{
+  uint8_t version;
+  char ssid[33];
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip, gateway, subnet, dns1, dns2;
+  uint32_t leaseTime;    // unix time DHCP handed out the lease, 0 while not known
+  uint32_t leaseSeconds; // how long the router gave it to us for
+} wificache;
+
+typedef struct
+{
+  uint32_t counts[WIFI_PATHS][WIFI_HIST_BUCKETS];
+  uint32_t fallbacks; // directed connects that didn't work
+} wifistats;
+
+wificache wifiCache;
+wifistats wifiStats;
+Preferences wifiPrefs;
+
+wifipath wifiPath;
+unsigned long wifiStartMillis;     // of the current attempt
+unsigned long wifiConnectedMillis; // 0 while not connected
+uint32_t wifiLastMs;               // how long the last connect took
+unsigned long wifiLeaseMillis;     // when the lease in use was handed out (or asked for)
+bool wifiRenewing;                 // DHCP restarted after a static connect, no lease yet
+String wifiSSID, wifiPwd;
+
+bool wifiCacheValid(const char *ssid)
+{
+  return wifiCache.version == WIFI_CACHE_VERSION && wifiCache.channel && strcmp(wifiCache.ssid, ssid) == 0;
+}
+
+// the lease the DHCP client on the station holds, s. 0 while it isn't bound
+uint32_t wifiLeaseSeconds()
+{
+  esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  struct netif *lwip = netif ? (struct netif *)esp_netif_get_netif_impl(netif) : NULL;
+  struct dhcp *dhcp = lwip ? netif_dhcp_data(lwip) : NULL;
+  return dhcp && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+}
+
+// the unix time of wifiLeaseMillis, 0 before the clock is set
+uint32_t wifiLeaseDate()
+{
+  time_t now = time(NULL);
+  if (now < (time_t)HIST_VALID_AFTER)
+    return 0;
+  return now - (millis() - wifiLeaseMillis) / 1000;
+}
+
+void wifiCacheDrop()
+{
+  wifiCache = {};
+  wifiPrefs.remove("cache");
+}
+
+uint8_t wifiBucket(uint32_t ms)
+{
+  uint8_t b = 0;
+  for (uint32_t limit = WIFI_HIST_FIRST_MS; b < WIFI_HIST_BUCKETS - 1 && ms >= limit; limit <<= 1)
+    b++;
+  return b;
+}
+
+void wifiBeginPath(wifipath path)
+{
+  wifiPath = path;
+  wifiStartMillis = millis();
+  if (path == WIFI_PATH_STATIC)
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.subnet),
+                IPAddress(wifiCache.dns1), IPAddress(wifiCache.dns2));
+  else
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // back to DHCP
+
+  if (path == WIFI_PATH_FULL)
+    WiFi.begin(wifiSSID.c_str(), wifiPwd.c_str());
+  else
+    WiFi.begin(wifiSSID.c_str(), wifiPwd.c_str(), wifiCache.channel, wifiCache.bssid);
+}
+
+// starts connecting, takes the fastest path the cache allows. WiFi.mode() is the caller's
+void wifiConnect(const String &ssid, const String &pwd)
+{
+  wifiSSID = ssid;
+  wifiPwd = pwd;
+  wifiConnectedMillis = 0;
+  wifiRenewing = false;
+  if (!wifiCacheValid(ssid.c_str()))
+  {
+    wifiBeginPath(WIFI_PATH_FULL);
+    return;
+  }
+  time_t now = time(NULL);
+  // before T1 the router still counts the address as ours and we'd not even have asked to renew
+  bool leaseFresh = wifiCache.leaseTime && now >= (time_t)wifiCache.leaseTime &&
+                    (uint32_t)(now - wifiCache.leaseTime) < wifiCache.leaseSeconds / 2;
+  wifiBeginPath(leaseFresh ? WIFI_PATH_STATIC : WIFI_PATH_DIRECT);
+}
+
+// remembers the AP and the lease, freshLease when DHCP just handed it out rather than it
+// being the cached one reused
+void wifiCacheSave(bool freshLease)
+{
+  wificache old = wifiCache;
+  wifiCache = {};
+  wifiCache.version = WIFI_CACHE_VERSION;
+  strncpy(wifiCache.ssid, wifiSSID.c_str(), sizeof(wifiCache.ssid) - 1);
+  memcpy(wifiCache.bssid, WiFi.BSSID(), 6);
+  wifiCache.channel = WiFi.channel();
+  wifiCache.ip = WiFi.localIP();
+  wifiCache.gateway = WiFi.gatewayIP();
+  wifiCache.subnet = WiFi.subnetMask();
+  wifiCache.dns1 = WiFi.dnsIP(0);
+  wifiCache.dns2 = WiFi.dnsIP(1);
+  // a lease we reused isn't any newer. a new one is dated when the clock is set, see wifiTick()
+  wifiCache.leaseTime = freshLease ? wifiLeaseDate() : old.leaseTime;
+  wifiCache.leaseSeconds = freshLease ? wifiLeaseSeconds() : old.leaseSeconds;
+  wifiPrefs.putBytes("cache", &wifiCache, sizeof(wifiCache));
+}
+
+// the static path skipped DHCP, so nothing would renew the lease and the router would give
+// the address away at its end. the client is started again on the connected station and
+// renews in the background, wifiTick() picks up the new lease
+void wifiRenewLease()
+{
+  esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  esp_err_t err = netif ? esp_netif_dhcpc_start(netif) : ESP_FAIL;
+  wifiRenewing = err == ESP_OK || err == ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED;
+  wifiLeaseMillis = millis();
+  if (!wifiRenewing)
+    Serial.println("[WIFI] Couldn't restart DHCP, the cached lease runs out");
+}
+
+// call while connecting: true once connected. falls back to a full connect when a
+// directed one doesn't work
+bool wifiPoll()
+{
+  if (wifiConnectedMillis)
+    return true;
+  if (WiFi.status() == WL_CONNECTED)
+  {
+    wifiConnectedMillis = millis();
+    wifiLastMs = wifiConnectedMillis - wifiStartMillis;
+    wifiStats.counts[wifiPath][wifiBucket(wifiLastMs)]++;
+    wifiPrefs.putBytes("stats", &wifiStats, sizeof(wifiStats));
+    wifiLeaseMillis = wifiConnectedMillis;
+    wifiCacheSave(wifiPath != WIFI_PATH_STATIC);
+    if (wifiPath == WIFI_PATH_STATIC)
+      wifiRenewLease();
+
+    char line[80];
+    sprintf(line, "[WIFI] Connected in %lu ms (%s)", (unsigned long)wifiLastMs, wifiPathNames[wifiPath]);
+    Serial.println(line);
+    return true;
+  }
+  if (wifiPath != WIFI_PATH_FULL && millis() - wifiStartMillis > WIFI_FAST_TIMEOUT)
+  {
+    Serial.println("[WIFI] Cached AP didn't answer, scanning");
+    wifiStats.fallbacks++;
+    wifiCacheDrop();
+    WiFi.disconnect();
+    wifiBeginPath(WIFI_PATH_FULL);
+  }
+  return false;
+}
+
+// called every minute: stores the lease DHCP got after a static connect, and dates a lease
+// that came in before the clock was set
+void wifiTick()
+{
+  if (!wifiConnectedMillis)
+    return;
+  if (wifiRenewing)
+  {
+    if (!wifiLeaseSeconds())
+      return;
+    wifiRenewing = false;
+    wifiCacheSave(true); // dated from when DHCP was restarted, a little early is the safe side
+    Serial.println("[WIFI] DHCP lease renewed");
+    return;
+  }
+  if (wifiCache.leaseTime || !wifiCache.leaseSeconds)
+    return;
+  wifiCache.leaseTime = wifiLeaseDate();
+  if (wifiCache.leaseTime)
+    wifiPrefs.putBytes("cache", &wifiCache, sizeof(wifiCache));
+}
+
+// GET /wifistats: connect time histograms per path, bucket i is < 125 << i ms (the last one is the rest)
+void handleWifiStats(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"lastMs\":%lu,\"path\":\"%s\",\"fallbacks\":%lu,\"bucketMs\":%d,\"counts\":{",
+                   (unsigned long)wifiLastMs, wifiPathNames[wifiPath], (unsigned long)wifiStats.fallbacks, WIFI_HIST_FIRST_MS);
+  for (int p = 0; p < WIFI_PATHS; p++)
+  {
+    response->printf("%s\"%s\":[", p ? "," : "", wifiPathNames[p]);
+    for (int b = 0; b < WIFI_HIST_BUCKETS; b++)
+      response->printf("%s%lu", b ? "," : "", (unsigned long)wifiStats.counts[p][b]);
+    response->print("]");
+  }
+  response->print("}}");
+  request->send(response);
+}
+
+void wifiBegin()
+{
+  wifiPrefs.begin("wifi", false);
+  if (wifiPrefs.getBytesLength("cache") == sizeof(wifiCache))
+    wifiPrefs.getBytes("cache", &wifiCache, sizeof(wifiCache));
+  if (wifiPrefs.getBytesLength("stats") == sizeof(wifiStats))
+    wifiPrefs.getBytes("stats", &wifiStats, sizeof(wifiStats));
+}
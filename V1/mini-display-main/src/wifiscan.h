@@ -0,0 +1,164 @@
+// background WiFi scan
+//
+// WiFi.scanNetworks() blocks for seconds, which inside an async web handler crashed the clock.
+// scans run asynchronously from the WiFi supervisor instead (it owns the driver and knows not
+// to scan in the middle of a connect), periodically while the setup AP is up and whenever
+// someone asks for a stale list. the results are deduplicated by SSID (strongest AP wins)
+// into a fixed table, and GET /scan answers from that table right away.
+
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+
+#define WIFI_SCAN_MAX 20         // networks kept
+#define WIFI_SCAN_PERIOD 300000  // ms between scans while the AP is up
+#define WIFI_SCAN_STALE 60000    // ms, an older list gets a new scan when it's asked for
+
+typedef struct
+{
+  char ssid[33];
+  int8_t rssi;
+  uint8_t auth; // wifi_auth_mode_t
+  uint8_t channel;
+} wifinet;
+
+wifinet wifiNets[WIFI_SCAN_MAX];
+uint8_t wifiNetCount;
+unsigned long wifiScanMillis; // when the table was filled, 0 never
+volatile bool wifiScanWanted, wifiScanning;
+portMUX_TYPE wifiScanMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t wifiScanOwner; // the supervisor, asleep until there's something to do
+
+void wifiScanRequest()
+{
+  wifiScanWanted = true;
+  if (wifiScanOwner)
+    xTaskNotify(wifiScanOwner, 0, eNoAction);
+}
+
+// the scan's results into the table, strongest first, one entry per SSID
+void wifiScanCollect(int n)
+{
+  wifinet nets[WIFI_SCAN_MAX];
+  uint8_t count = 0;
+  for (int i = 0; i < n; i++)
+  {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0)
+      continue; // hidden
+    wifinet net = {};
+    strncpy(net.ssid, ssid.c_str(), sizeof(net.ssid) - 1);
+    net.rssi = WiFi.RSSI(i);
+    net.auth = WiFi.encryptionType(i);
+    net.channel = WiFi.channel(i);
+
+    int j = 0;
+    while (j < count && strcmp(nets[j].ssid, net.ssid) != 0)
+      j++;
+    if (j < count)
+    {
+      if (net.rssi <= nets[j].rssi)
+        continue;
+      count--; // take it out, it goes back in at its new place
+      memmove(&nets[j], &nets[j + 1], (count - j) * sizeof(wifinet));
+    }
+    // insertion by rssi, the weakest falls off a full table
+    j = count < WIFI_SCAN_MAX ? count : WIFI_SCAN_MAX - 1;
+    if (count == WIFI_SCAN_MAX && net.rssi <= nets[j].rssi)
+      continue;
+    while (j > 0 && nets[j - 1].rssi < net.rssi)
+    {
+      nets[j] = nets[j - 1];
+      j--;
+    }
+    nets[j] = net;
+    if (count < WIFI_SCAN_MAX)
+      count++;
+  }
+
+  portENTER_CRITICAL(&wifiScanMux);
+  memcpy(wifiNets, nets, sizeof(nets));
+  wifiNetCount = count;
+  wifiScanMillis = millis();
+  portEXIT_CRITICAL(&wifiScanMux);
+
+  char line[60];
+  sprintf(line, "[WIFI] Scan done, %d APs, %d networks", n, count);
+  Serial.println(line);
+}
+
+// called by the supervisor every turn. idle is false while it's connecting
+void wifiScanStep(bool idle, bool apUp)
+{
+  if (wifiScanning)
+  {
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING)
+      return;
+    if (n >= 0)
+      wifiScanCollect(n);
+    WiFi.scanDelete();
+    wifiScanning = false;
+    return;
+  }
+
+  bool due = apUp && (!wifiScanMillis || millis() - wifiScanMillis > WIFI_SCAN_PERIOD);
+  if (!idle || !(wifiScanWanted || due))
+    return;
+  wifiScanWanted = false;
+  wifiScanning = WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING;
+}
+
+// ms until wifiScanStep() has a scan to start without being asked again, UINT32_MAX for never
+uint32_t wifiScanDue(bool apUp)
+{
+  if (wifiScanWanted || (apUp && !wifiScanMillis))
+    return 0;
+  if (!apUp)
+    return UINT32_MAX;
+  uint32_t since = millis() - wifiScanMillis;
+  return since > WIFI_SCAN_PERIOD ? 0 : WIFI_SCAN_PERIOD - since + 1;
+}
+
+// copies s into out as a JSON string body
+void wifiJsonEscape(char *out, const char *s)
+{
+  for (; *s; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      *out++ = '\\';
+    if ((uint8_t)*s < 0x20)
+    {
+      out += sprintf(out, "\\u%04x", (uint8_t)*s);
+      continue;
+    }
+    *out++ = *s;
+  }
+  *out = 0;
+}
+
+// GET /scan: {"age":<s, -1 never>,"scanning":<bool>,"networks":[{"ssid","rssi","auth","ch"},..]}
+// a stale list is still served, with a new scan started for the next request
+void handleScan(AsyncWebServerRequest *request)
+{
+  wifinet nets[WIFI_SCAN_MAX];
+  portENTER_CRITICAL(&wifiScanMux);
+  uint8_t count = wifiNetCount;
+  unsigned long at = wifiScanMillis;
+  memcpy(nets, wifiNets, sizeof(nets));
+  portEXIT_CRITICAL(&wifiScanMux);
+
+  if (!at || millis() - at > WIFI_SCAN_STALE || request->hasParam("refresh"))
+    wifiScanRequest();
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"age\":%ld,\"scanning\":%s,\"networks\":[", at ? (long)((millis() - at) / 1000) : -1L,
+                   wifiScanning || wifiScanWanted ? "true" : "false");
+  char ssid[33 * 6];
+  for (int i = 0; i < count; i++)
+  {
+    wifiJsonEscape(ssid, nets[i].ssid);
+    response->printf("%s{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":%u,\"ch\":%u}", i ? "," : "", ssid, nets[i].rssi, nets[i].auth, nets[i].channel);
+  }
+  response->print("]}");
+  request->send(response);
+}
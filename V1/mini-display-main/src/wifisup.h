@@ -0,0 +1,307 @@
+// WiFi supervisor
+//
+// one task owns the WiFi driver. it connects (through wificache.h, so the fast path is tried
+// first), reconnects when the AP goes away, and backs off between failed attempts
+// exponentially with jitter, so a room full of clocks doesn't hammer a router that just
+// rebooted. when the station has been offline for WIFI_AP_AFTER (or the button asks for it)
+// the setup AP comes up next to it and the station keeps searching. once the station is back
+// the AP goes away again. night mode can switch the radio off altogether with wifiPause().
+// the task only polls while it connects or a scan runs, otherwise it sleeps until a note or
+// its next deadline (a retry, the AP, a periodic scan), and online that's until the link drops.
+//
+// everyone else learns about the connection from wifiEvents and wifiInfo, which the driver's
+// event callback keeps up to date, instead of asking WiFi.status() on every render.
+
+#include <WiFi.h>
+#include "wifiscan.h"
+
+#define WIFI_ATTEMPT_MS 20000    // an attempt that isn't up by then failed
+#define WIFI_BACKOFF_MIN 2000    // ms before the first retry
+#define WIFI_BACKOFF_MAX 300000  // ms, the wait doubles up to this
+#define WIFI_AP_AFTER 60000      // ms offline before the setup AP comes up
+#define WIFI_RSSI_MS 10000       // how often the signal strength is refreshed
+#define WIFI_POLL_MS 100         // supervisor turns while connecting or scanning
+
+// wifiEvents bits
+#define WIFI_EV_ONLINE (1 << 0) // station has an IP
+#define WIFI_EV_AP (1 << 1)     // setup AP is up
+
+// supervisor task notification bits
+#define WIFI_NOTE_LOST (1 << 0) // station lost its connection
+#define WIFI_NOTE_AP (1 << 1)   // open the AP now
+#define WIFI_NOTE_PAUSE (1 << 2) // wifiPaused changed
+
+typedef enum
+{
+  WIFI_SUP_AP_ONLY, // no credentials
+  WIFI_SUP_CONNECTING,
+  WIFI_SUP_WAITING, // backing off
+  WIFI_SUP_ONLINE,
+  WIFI_SUP_OFF, // paused, radio off
+} wifisupstate;
+
+typedef struct
+{
+  volatile uint32_t ip, apIP; // 0 while down
+  volatile int8_t rssi;
+  char ssid[33];
+  uint32_t drops, attempts; // since boot
+} wifiinfo;
+
+EventGroupHandle_t wifiEvents;
+TaskHandle_t wifiTask;
+wifiinfo wifiInfo;
+char wifiAPName[33];
+volatile bool wifiPaused;
+unsigned long wifiRssiMillis;
+
+bool wifiOnline()
+{
+  return xEventGroupGetBits(wifiEvents) & WIFI_EV_ONLINE;
+}
+
+void wifiEvent(arduino_event_id_t event, arduino_event_info_t info)
+{
+  switch (event)
+  {
+  case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    wifiInfo.ip = WiFi.localIP();
+    wifiInfo.rssi = WiFi.RSSI();
+    xEventGroupSetBits(wifiEvents, WIFI_EV_ONLINE);
+    Serial.print("[WIFI] Connected to WiFi network with IP Address: ");
+    Serial.println(WiFi.localIP());
+    break;
+  case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+  case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+    if (xEventGroupGetBits(wifiEvents) & WIFI_EV_ONLINE)
+    {
+      wifiInfo.ip = 0;
+      xEventGroupClearBits(wifiEvents, WIFI_EV_ONLINE);
+      xTaskNotify(wifiTask, WIFI_NOTE_LOST, eSetBits);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void wifiStartAP()
+{
+  WiFi.mode(WIFI_AP_STA); // the station also scans for the settings page
+
+  IPAddress apIP = IPAddress(192, 168, 4, 1);
+  WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
+  // https://github.com/espressif/arduino-esp32/issues/1832
+
+  WiFi.softAP(wifiAPName);
+
+  wifiInfo.apIP = WiFi.softAPIP();
+  xEventGroupSetBits(wifiEvents, WIFI_EV_AP);
+  Serial.print("[WIFI] AP IP address: ");
+  Serial.println(IPAddress(wifiInfo.apIP));
+}
+
+void wifiStopAP()
+{
+  WiFi.softAPdisconnect(true);
+  wifiInfo.apIP = 0;
+  xEventGroupClearBits(wifiEvents, WIFI_EV_AP);
+  Serial.println("[WIFI] AP closed");
+}
+
+// how long the supervisor can sleep before it has something to poll or a deadline comes up.
+// the driver and everyone else wake it earlier with a note (lost connection, AP, pause, scan)
+TickType_t wifiSupWait(wifisupstate state, unsigned long retryAt, unsigned long offlineSince)
+{
+  if (state == WIFI_SUP_CONNECTING || wifiScanning)
+    return pdMS_TO_TICKS(WIFI_POLL_MS);
+  if (state == WIFI_SUP_OFF)
+    return portMAX_DELAY;
+
+  bool apUp = xEventGroupGetBits(wifiEvents) & WIFI_EV_AP;
+  uint32_t ms = wifiScanDue(apUp);
+  if (state == WIFI_SUP_WAITING)
+  {
+    long untilRetry = (long)(retryAt - millis());
+    ms = min(ms, (uint32_t)max(untilRetry, 0L));
+    if (!apUp)
+    {
+      long untilAP = (long)(offlineSince + WIFI_AP_AFTER - millis());
+      ms = min(ms, (uint32_t)max(untilAP, 0L));
+    }
+  }
+  if (ms == UINT32_MAX)
+    return portMAX_DELAY;
+  return pdMS_TO_TICKS(ms) + (ms ? 1 : 0); // rounded up, waking a tick early would only spin
+}
+
+void wifiSupervisor(void *pvParameters)
+{
+  WiFi.setAutoReconnect(false); // retries are ours
+  WiFi.onEvent(wifiEvent);
+  wifiScanOwner = xTaskGetCurrentTaskHandle();
+
+  wifisupstate state = WIFI_SUP_AP_ONLY;
+  uint32_t backoff = WIFI_BACKOFF_MIN;
+  unsigned long offlineSince = millis(), attemptStart = 0, retryAt = 0;
+  TickType_t timeout = 0;
+
+  if (wifiSSID.length() == 0)
+    wifiStartAP();
+  else
+  {
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(WIFI_PS_MIN_MODEM); // modem sleep, the radio wakes for every DTIM beacon
+    wifiConnect(wifiSSID, wifiPwd);
+    attemptStart = millis();
+    wifiInfo.attempts++;
+    state = WIFI_SUP_CONNECTING;
+  }
+
+  while (1)
+  {
+    uint32_t note = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &note, timeout);
+    bool apUp = xEventGroupGetBits(wifiEvents) & WIFI_EV_AP;
+
+    if (wifiPaused && state != WIFI_SUP_OFF)
+    {
+      if (apUp)
+        wifiStopAP();
+      WiFi.disconnect(true);
+      WiFi.mode(WIFI_OFF);
+      state = WIFI_SUP_OFF;
+      Serial.println("[WIFI] Radio off");
+    }
+    else if (!wifiPaused && state == WIFI_SUP_OFF)
+    {
+      Serial.println("[WIFI] Radio back on");
+      offlineSince = millis();
+      backoff = WIFI_BACKOFF_MIN;
+      if (wifiSSID.length() == 0)
+      {
+        wifiStartAP();
+        state = WIFI_SUP_AP_ONLY;
+      }
+      else
+      {
+        WiFi.mode(WIFI_STA);
+        WiFi.setSleep(WIFI_PS_MIN_MODEM);
+        wifiConnect(wifiSSID, wifiPwd);
+        attemptStart = millis();
+        wifiInfo.attempts++;
+        state = WIFI_SUP_CONNECTING;
+      }
+    }
+    apUp = xEventGroupGetBits(wifiEvents) & WIFI_EV_AP;
+
+    if ((note & WIFI_NOTE_AP) && !apUp && state != WIFI_SUP_OFF)
+      wifiStartAP();
+
+    switch (state)
+    {
+    case WIFI_SUP_CONNECTING:
+      if (wifiPoll())
+      {
+        state = WIFI_SUP_ONLINE;
+        backoff = WIFI_BACKOFF_MIN;
+        if (apUp)
+          wifiStopAP();
+      }
+      else if (millis() - attemptStart > WIFI_ATTEMPT_MS)
+      {
+        WiFi.disconnect();
+        uint32_t wait = backoff / 2 + esp_random() % (backoff / 2 + 1); // "equal jitter"
+        backoff = min(backoff * 2, (uint32_t)WIFI_BACKOFF_MAX);
+        retryAt = millis() + wait;
+        state = WIFI_SUP_WAITING;
+        char line[80];
+        sprintf(line, "[WIFI] Couldn't connect to %s, next try in %lu s", wifiInfo.ssid, (unsigned long)(wait / 1000));
+        Serial.println(line);
+      }
+      break;
+
+    case WIFI_SUP_WAITING:
+      if ((long)(millis() - retryAt) >= 0)
+      {
+        wifiConnect(wifiSSID, wifiPwd);
+        attemptStart = millis();
+        wifiInfo.attempts++;
+        state = WIFI_SUP_CONNECTING;
+      }
+      break;
+
+    case WIFI_SUP_ONLINE:
+      if (note & WIFI_NOTE_LOST)
+      {
+        Serial.println("[WIFI] Connection lost, reconnecting");
+        wifiInfo.drops++;
+        offlineSince = millis();
+        wifiConnect(wifiSSID, wifiPwd);
+        attemptStart = millis();
+        wifiInfo.attempts++;
+        state = WIFI_SUP_CONNECTING;
+      }
+      break;
+
+    case WIFI_SUP_AP_ONLY:
+    case WIFI_SUP_OFF:
+      break;
+    }
+
+    if ((state == WIFI_SUP_CONNECTING || state == WIFI_SUP_WAITING) && !(xEventGroupGetBits(wifiEvents) & WIFI_EV_AP) &&
+        millis() - offlineSince > WIFI_AP_AFTER)
+      wifiStartAP();
+
+    if (state != WIFI_SUP_OFF) // a scan would switch the station back on
+      wifiScanStep(state != WIFI_SUP_CONNECTING, xEventGroupGetBits(wifiEvents) & WIFI_EV_AP);
+    timeout = wifiSupWait(state, retryAt, offlineSince);
+  }
+}
+
+// called from loop(): the supervisor sleeps while online, so the signal strength for the
+// display is read here
+void wifiRssiTick()
+{
+  if (!wifiOnline() || millis() - wifiRssiMillis < WIFI_RSSI_MS)
+    return;
+  wifiInfo.rssi = WiFi.RSSI();
+  wifiRssiMillis = millis();
+}
+
+// ask for the setup AP without waiting for WIFI_AP_AFTER, e.g. on a button press
+void wifiRequestAP()
+{
+  if (wifiTask)
+    xTaskNotify(wifiTask, WIFI_NOTE_AP, eSetBits);
+}
+
+// radio off (true) or back on, e.g. for the night
+void wifiPause(bool off)
+{
+  wifiPaused = off;
+  if (wifiTask)
+    xTaskNotify(wifiTask, WIFI_NOTE_PAUSE, eSetBits);
+}
+
+// starts the supervisor. an empty ssid means AP only. apName is the setup AP's SSID
+void wifiSupervise(const String &ssid, const String &pwd, const char *apName)
+{
+  strncpy(wifiInfo.ssid, ssid.c_str(), sizeof(wifiInfo.ssid) - 1);
+  wifiSSID = ssid;
+  wifiPwd = pwd;
+  strncpy(wifiAPName, apName, sizeof(wifiAPName) - 1);
+  xTaskCreatePinnedToCore(
+      wifiSupervisor,       /* Task function. */
+      "WiFi Supervisor",    /* name of task. */
+      4096,                 /* Stack size of task */
+      NULL,                 /* parameter of the task */
+      2,                    /* priority of the task */
+      &wifiTask,            /* Task handle to keep track of created task */
+      0);                   /* pin task to core 0 */
+}
+
+void wifiSupBegin()
+{
+  wifiEvents = xEventGroupCreate();
+}
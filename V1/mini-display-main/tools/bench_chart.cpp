@@ -0,0 +1,184 @@
+/*
+Fills the sensor history (history.h) with weeks of synthetic readings on a PC, asks /chart
+(chart.h) for ranges from an hour to a year at a few point counts, and reports how long each
+answer takes to build and how many bytes go on the wire, next to what /history would send
+for the same buckets. Every answer is decoded and each point checked against the min and max
+of the buckets it covers.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src bench_chart.cpp -o bench_chart
+
+Usage:
+  bench_chart [days]
+
+Readings come every 5 s like the sampler sends them. The byte counts are the body alone, the
+HTTP headers come on top. Exits with 1 if an answer doesn't decode to the buckets it covers
+or is bigger than its point count allows.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "params.h"
+#include "history.h"
+#include "chart.h"
+
+#define START 1767225600UL // 2026-01-01 00:00 UTC
+#define OFFSET (8 * 3600)  // local time zone
+#define PERIOD 5           // s between readings, DHT_PERIOD
+#define RUNS 50            // per range, for the timing
+
+typedef std::chrono::steady_clock bclock;
+
+int failures = 0;
+
+void check(bool ok, const char *what, uint32_t range, int points)
+{
+  if (!ok && failures++ < 10)
+    printf("FAIL %s, range %u s, %d points\n", what, range, points);
+}
+
+uint32_t readVarint(const uint8_t *&p, const uint8_t *end)
+{
+  uint32_t v = 0;
+  for (int shift = 0; p < end && shift < 35; shift += 7)
+  {
+    uint8_t b = *p++;
+    v |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      break;
+  }
+  return v;
+}
+
+// the buckets of one point read straight from the rings, to check the answer against
+chartpoint expected(uint8_t res, uint32_t first, uint32_t last, uint8_t series)
+{
+  chartpoint p = {};
+  for (uint32_t key = first; key <= last; key++)
+  {
+    int16_t lo, hi;
+    histsample s;
+    histbucket b;
+    if (res == HIST_MINUTE ? !histGetMinute(key, s) : !histGetBucket(res, key, b))
+      continue;
+    const histstat &st = series ? b.hum : b.temp;
+    lo = res == HIST_MINUTE ? (series ? s.hum : s.temp) : st.min;
+    hi = res == HIST_MINUTE ? lo : st.max;
+    p.min = p.has ? min(p.min, lo) : lo;
+    p.max = p.has ? max(p.max, hi) : hi;
+    p.has = true;
+  }
+  return p;
+}
+
+// decodes a /chart answer and checks every point
+void checkAnswer(const std::string &body, uint32_t from, uint32_t to, int points)
+{
+  uint32_t range = to - from;
+  chartheader h;
+  check(body.size() >= sizeof(h), "answer has a header", range, points);
+  if (body.size() < sizeof(h))
+    return;
+  memcpy(&h, body.data(), sizeof(h));
+  check(!memcmp(h.magic, CHART_MAGIC, 4) && h.series == 2 && h.points <= points, "header", range, points);
+  check(body.size() <= sizeof(h) + 2 * h.points * 6, "size bounded by the points", range, points);
+
+  uint32_t period = histPeriod[h.res], step = h.step / period;
+  uint32_t first = (h.start + histOffset) / period;
+  uint32_t last = min((to + histOffset) / period, histNewest[h.res]);
+  const uint8_t *p = (const uint8_t *)body.data() + sizeof(h), *end = (const uint8_t *)body.data() + body.size();
+  for (uint8_t series = 0; series < 2; series++)
+  {
+    int16_t prev = 0;
+    for (uint16_t j = 0; j < h.points; j++)
+    {
+      uint32_t a = first + j * step;
+      chartpoint want = expected(h.res, a, min(a + step - 1, last), series);
+      uint32_t zigzag = readVarint(p, end);
+      check(want.has == (zigzag != 0), "point has data", range, points);
+      if (!zigzag)
+        continue;
+      zigzag--;
+      int16_t lo = prev + (int32_t)((zigzag >> 1) ^ -(int32_t)(zigzag & 1));
+      int16_t hi = lo + readVarint(p, end);
+      prev = lo;
+      check(lo == want.min && hi == want.max, "point min/max", range, points);
+    }
+  }
+  check(p == end, "nothing after the last point", range, points);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t days = argc > 1 ? atoi(argv[1]) : 45;
+  histBegin(OFFSET);
+  srand(1);
+  uint32_t end = START + days * 86400;
+  for (uint32_t t = START; t < end; t += PERIOD)
+    histAdd(t, 2500 + (int16_t)(300 * sin(t / 86400.0 * 2 * M_PI)) + rand() % 21 - 10,
+            6000 + (int16_t)(900 * cos(t / 86400.0 * 2 * M_PI)) + rand() % 41 - 20);
+  uint32_t now = end - PERIOD;
+
+  const uint32_t ranges[] = {3600, 6 * 3600, 86400, 7 * 86400, 30 * 86400, 365 * 86400};
+  const int counts[] = {50, CHART_DEFAULT_POINTS, CHART_MAX_POINTS};
+  printf("%-9s %6s %4s %7s %6s %9s %8s\n", "range", "points", "res", "bytes", "B/pt", "/history", "us");
+  for (uint32_t range : ranges)
+    for (int points : counts)
+    {
+      char from[12], to[12], n[8];
+      snprintf(from, sizeof(from), "%u", now - range);
+      snprintf(to, sizeof(to), "%u", now);
+      snprintf(n, sizeof(n), "%d", points);
+
+      std::string body;
+      auto start = bclock::now();
+      for (int i = 0; i < RUNS; i++)
+      {
+        AsyncWebServerRequest request;
+        request.addParam("from", from);
+        request.addParam("to", to);
+        request.addParam("points", n);
+        handleChart(&request);
+        body = request.body();
+      }
+      double us = std::chrono::duration<double, std::micro>(bclock::now() - start).count() / RUNS;
+      checkAnswer(body, now - range, now, points);
+
+      // what the same span costs as /history rows: a minute is 2 values, a bucket 6
+      chartheader h;
+      memcpy(&h, body.data(), sizeof(h));
+      uint32_t period = histPeriod[h.res];
+      uint32_t buckets = min((now + histOffset) / period, histNewest[h.res]) - (h.start + histOffset) / period + 1;
+      size_t raw = sizeof(histheader) + buckets * (h.res == HIST_MINUTE ? 2 : 6) * 2;
+      const char *res = h.res == HIST_MINUTE ? "min" : h.res == HIST_HOUR ? "hour" : "day";
+      printf("%7.1fh %6d %4s %7zu %6.2f %9zu %8.1f\n", range / 3600.0, h.points, res, body.size(),
+             (double)(body.size() - sizeof(h)) / (2 * h.points), raw, us);
+    }
+
+  // a range that ends before it starts
+  AsyncWebServerRequest empty;
+  empty.addParam("from", "2000");
+  empty.addParam("to", "1000");
+  handleChart(&empty);
+  check(empty.sent() && empty.sent()->code == 204, "from after to answers 204", 0, 0);
+
+  // a repeated parameter counts the first time, like everywhere else
+  char from[12];
+  snprintf(from, sizeof(from), "%u", now - 86400);
+  AsyncWebServerRequest twice;
+  twice.addParam("from", from);
+  twice.addParam("points", "10");
+  twice.addParam("points", "400");
+  handleChart(&twice);
+  chartheader h;
+  std::string body = twice.body();
+  memcpy(&h, body.data(), min(body.size(), sizeof(h)));
+  check(body.size() >= sizeof(h) && h.points <= 10, "first points= wins", 86400, 10);
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/*
+Sweeps the fixed-point kernels (fixedpoint.h) over the DHT22's whole range against the float
+code they replace, and reports the max error and how long each takes:
+  fixHeatIndex  against DHT::computeHeatIndex() from the Adafruit library
+  fixDewPoint   against the Magnus formula in float with logf()
+  fixCtoF/FtoC  against c * 1.8 + 32 and back
+  fixFormat     against snprintf("%.2f")
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -I../src bench_fixedpoint.cpp -o bench_fixedpoint
+
+Usage:
+  bench_fixedpoint
+
+The sweep is -40..80C and 0..100% in 0.1 steps, the sensor's range and resolution. The heat
+index is piecewise: Steadman's formula up to 79F and Rothfusz above, and the two don't meet,
+so a reading within rounding of the switch can land on either side in the two versions. Its
+error is reported everywhere and again away from the switch.
+
+The times are this PC's, and they only say what each costs here: with a double-precision
+FPU the float code is about as fast as the integer one. On the ESP32 the FPU is single
+precision, and computeHeatIndex() works in double (its constants and pow() are double), so
+there every one of those operations is a software routine. Exits with 1 if an error is over
+its limit.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <functional>
+
+#include "fixedpoint.h"
+
+#define HI_LIMIT 0.02   // C, heat index away from the switch
+#define DEW_LIMIT 0.01  // C
+#define SWITCH_BAND 0.1 // F either side of Steadman's 79F where the branch may differ
+
+typedef std::chrono::steady_clock bclock;
+
+// DHT::computeHeatIndex(), Celsius in and out
+float floatHeatIndex(float temperature, float percentHumidity)
+{
+  temperature = temperature * 1.8 + 32;
+  float hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) + (percentHumidity * 0.094));
+  if (hi > 79)
+  {
+    hi = -42.379 + 2.04901523 * temperature + 10.14333127 * percentHumidity +
+         -0.22475541 * temperature * percentHumidity +
+         -0.00683783 * pow(temperature, 2) +
+         -0.05481717 * pow(percentHumidity, 2) +
+         0.00122874 * pow(temperature, 2) * percentHumidity +
+         0.00085282 * temperature * pow(percentHumidity, 2) +
+         -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
+    if ((percentHumidity < 13) && (temperature >= 80.0) && (temperature <= 112.0))
+      hi -= ((13.0 - percentHumidity) * 0.25) * sqrt((17.0 - fabs(temperature - 95.0)) * 0.05882);
+    else if ((percentHumidity > 85.0) && (temperature >= 80.0) && (temperature <= 87.0))
+      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+  }
+  return (hi - 32) * 0.55555;
+}
+
+float floatDewPoint(float c, float rh)
+{
+  float gamma = logf(rh / 100) + 17.62f * c / (243.12f + c);
+  return 243.12f * gamma / (17.62f - gamma);
+}
+
+// Steadman's value in F, to tell how close a reading is to the switch
+double steadman(double c, double rh)
+{
+  double f = c * 1.8 + 32;
+  return 0.5 * (f + 61.0 + (f - 68.0) * 1.2 + rh * 0.094);
+}
+
+int failures = 0;
+
+void report(const char *what, double err, double limit, int32_t c, int32_t rh)
+{
+  bool ok = limit <= 0 || err <= limit;
+  printf("%-26s max error %.3f at %.2fC %.2f%%%s\n", what, err, c / 100.0, rh / 100.0, ok ? "" : "  FAIL");
+  failures += !ok;
+}
+
+int main()
+{
+  // errors
+  double hiAll = 0, hiAway = 0, dew = 0, conv = 0;
+  int32_t hiAllAt[2] = {}, hiAwayAt[2] = {}, dewAt[2] = {}, convAt = 0;
+  long switchSide = 0, readings = 0;
+  for (int32_t c = -4000; c <= 8000; c += 10)
+  {
+    double back = fixFtoC(fixCtoF(c)) / 100.0 - c / 100.0;
+    double f = fabs(fixCtoF(c) / 100.0 - (c / 100.0 * 1.8 + 32));
+    if (fabs(back) > conv || f > conv)
+    {
+      conv = fmax(fabs(back), f);
+      convAt = c;
+    }
+    for (int32_t rh = 0; rh <= 10000; rh += 10)
+    {
+      readings++;
+      double err = fabs(fixHeatIndex(c, rh) / 100.0 - floatHeatIndex(c / 100.0f, rh / 100.0f));
+      if (err > hiAll)
+      {
+        hiAll = err;
+        hiAllAt[0] = c, hiAllAt[1] = rh;
+      }
+      if (fabs(steadman(c / 100.0, rh / 100.0) - 79) > SWITCH_BAND)
+      {
+        if (err > hiAway)
+        {
+          hiAway = err;
+          hiAwayAt[0] = c, hiAwayAt[1] = rh;
+        }
+      }
+      else
+        switchSide++;
+      if (rh < 100)
+        continue; // below 1% the log runs off, and the DHT22 doesn't go there
+      err = fabs(fixDewPoint(c, rh) / 100.0 - floatDewPoint(c / 100.0f, rh / 100.0f));
+      if (err > dew)
+      {
+        dew = err;
+        dewAt[0] = c, dewAt[1] = rh;
+      }
+    }
+  }
+  printf("%ld readings, %ld within %.1fF of the heat index switch\n", readings, switchSide, SWITCH_BAND);
+  report("heat index", hiAll, 0, hiAllAt[0], hiAllAt[1]);
+  report("heat index off the switch", hiAway, HI_LIMIT, hiAwayAt[0], hiAwayAt[1]);
+  report("dew point", dew, DEW_LIMIT, dewAt[0], dewAt[1]);
+  report("C to F and back", conv, 0.01, convAt, 0);
+
+  // fixFormat against %.2f, every value a reading can format to
+  long mismatches = 0;
+  for (int32_t v = -100000; v <= 100000; v++)
+  {
+    char a[16], b[16];
+    fixFormat(a, v, 2);
+    snprintf(b, sizeof(b), "%.2f", v / 100.0);
+    if (strcmp(a, b) && mismatches++ < 5)
+      printf("fixFormat %d: \"%s\", %%.2f: \"%s\"\n", v, a, b);
+  }
+  printf("fixFormat against %%.2f: %ld mismatches\n", mismatches);
+  failures += mismatches != 0;
+
+  // times, over the same sweep
+  volatile float fsink = 0;
+  volatile int32_t isink = 0;
+  auto time = [](std::function<void(int32_t, int32_t)> fn)
+  {
+    long n = 0;
+    auto start = bclock::now();
+    for (int32_t c = -4000; c <= 8000; c += 10)
+      for (int32_t rh = 100; rh <= 10000; rh += 10, n++)
+        fn(c, rh);
+    return std::chrono::duration<double, std::nano>(bclock::now() - start).count() / n;
+  };
+  double fHi = time([&](int32_t c, int32_t rh)
+                    { fsink = fsink + floatHeatIndex(c / 100.0f, rh / 100.0f); });
+  double xHi = time([&](int32_t c, int32_t rh)
+                    { isink = isink + fixHeatIndex(c, rh); });
+  double fDew = time([&](int32_t c, int32_t rh)
+                     { fsink = fsink + floatDewPoint(c / 100.0f, rh / 100.0f); });
+  double xDew = time([&](int32_t c, int32_t rh)
+                     { isink = isink + fixDewPoint(c, rh); });
+  printf("heat index: float %.1f ns, fixed %.1f ns (%.1fx)\n", fHi, xHi, fHi / xHi);
+  printf("dew point:  float %.1f ns, fixed %.1f ns (%.1fx)\n", fDew, xDew, fDew / xDew);
+
+  char buf[16];
+  auto start = bclock::now();
+  for (int32_t v = -100000; v <= 100000; v++)
+    snprintf(buf, sizeof(buf), "%.2f", v / 100.0);
+  double fFmt = std::chrono::duration<double, std::nano>(bclock::now() - start).count() / 200001;
+  start = bclock::now();
+  for (int32_t v = -100000; v <= 100000; v++)
+    fixFormat(buf, v, 2);
+  double xFmt = std::chrono::duration<double, std::nano>(bclock::now() - start).count() / 200001;
+  printf("format:     %%.2f %.1f ns, fixFormat %.1f ns (%.1fx)\n", fFmt, xFmt, fFmt / xFmt);
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+/*
+Fills the sensor history (history.h) with weeks of synthetic readings on a PC, checks the
+hourly and daily rollups against the same numbers recomputed from the readings, and times
+inserts, bucket lookups and the /history export.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src bench_history.cpp -o bench_history
+
+Usage:
+  bench_history [days]
+
+Readings come every 5 s like the sampler sends them. There's no datalog partition, so
+nothing goes to flash and the times are the RAM side alone. Exits with 1 if a rollup or an
+export doesn't match.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#include "params.h"
+#include "history.h"
+
+#define START 1767225600UL // 2026-01-01 00:00 UTC
+#define OFFSET (8 * 3600)  // local time zone
+#define PERIOD 5           // s between readings, DHT_PERIOD
+
+typedef std::chrono::steady_clock bclock;
+
+double nsSince(bclock::time_point t)
+{
+  return std::chrono::duration<double, std::nano>(bclock::now() - t).count();
+}
+
+// a day/night swing with some noise, x100
+int16_t tempAt(uint32_t t) { return 2500 + (int16_t)(300 * sin(t / 86400.0 * 2 * M_PI)) + rand() % 21 - 10; }
+int16_t humAt(uint32_t t) { return 6000 + (int16_t)(900 * cos(t / 86400.0 * 2 * M_PI)) + rand() % 41 - 20; }
+
+int failures = 0;
+
+void check(bool ok, const char *what, uint32_t key)
+{
+  if (!ok && failures++ < 10)
+    printf("FAIL %s at key %u\n", what, key);
+}
+
+// per minute: the sum and count of the readings it got, to recompute everything from
+std::map<uint32_t, std::pair<int32_t, int32_t>> reference;
+
+// the rollup of one hour or day, recomputed from the readings
+void checkRollup(uint8_t res, uint32_t key)
+{
+  uint32_t minutes = histPeriod[res] / 60;
+  int32_t sum = 0, n = 0;
+  int16_t lo = INT16_MAX, hi = INT16_MIN;
+  for (uint32_t m = key * minutes; m < (key + 1) * minutes; m++)
+  {
+    auto it = reference.find(m);
+    if (it == reference.end())
+      continue;
+    int16_t avg = it->second.first / it->second.second;
+    sum += avg;
+    n++;
+    lo = min(lo, avg);
+    hi = max(hi, avg);
+  }
+  histbucket b;
+  bool found = histGetBucket(res, key, b);
+  check(found == (n > 0), "rollup exists", key);
+  if (found && n)
+    check(b.temp.min == lo && b.temp.max == hi && b.temp.avg == sum / n, res == HIST_HOUR ? "hour rollup" : "day rollup", key);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t days = argc > 1 ? atoi(argv[1]) : 45;
+  histBegin(OFFSET);
+
+  // inserts
+  std::vector<double> insertNs;
+  uint32_t end = START + days * 86400;
+  srand(1);
+  for (uint32_t t = START; t < end; t += PERIOD)
+  {
+    int16_t temp = tempAt(t), hum = humAt(t);
+    auto start = bclock::now();
+    histAdd(t, temp, hum);
+    insertNs.push_back(nsSince(start));
+    auto &r = reference[(t + OFFSET) / 60];
+    r.first += temp;
+    r.second++;
+  }
+  std::vector<double> sorted = insertNs;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (double ns : insertNs)
+    total += ns;
+  printf("insert: %zu readings, mean %.0f ns, p99 %.0f ns, max %.0f ns\n", insertNs.size(), total / insertNs.size(),
+         sorted[sorted.size() * 99 / 100], sorted.back());
+
+  // every rollup still in its ring against the readings. the newest minute is still open and
+  // not in its hour and day yet
+  reference.erase(histNewest[HIST_MINUTE]);
+  for (uint32_t h = histNewest[HIST_HOUR] - HIST_HOURS + 1; h <= histNewest[HIST_HOUR]; h++)
+    checkRollup(HIST_HOUR, h);
+  for (uint32_t d = histNewest[HIST_DAY] - HIST_DAYS + 1; d <= histNewest[HIST_DAY]; d++)
+    checkRollup(HIST_DAY, d);
+  histbucket b;
+  check(histGetBucket(HIST_HOUR, histNewest[HIST_HOUR] - HIST_HOURS + 1, b), "oldest hour still kept", 0);
+  check(!histGetBucket(HIST_HOUR, histNewest[HIST_HOUR] - HIST_HOURS, b), "hour before that rolled out", 0);
+
+  // lookups, one slot each whatever the key
+  const int lookups = 1000000;
+  volatile int32_t sink = 0;
+  for (uint8_t res = HIST_MINUTE; res < HIST_LEVELS; res++)
+  {
+    uint32_t newest = histNewest[res];
+    auto start = bclock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+      uint32_t key = newest - (uint32_t)(rand() % histSize[res]);
+      if (res == HIST_MINUTE)
+      {
+        histsample s;
+        if (histGetMinute(key, s))
+          sink = sink + s.temp;
+      }
+      else if (histGetBucket(res, key, b))
+        sink = sink + b.temp.avg;
+    }
+    printf("lookup %-6s %6.1f ns\n", res == HIST_MINUTE ? "minute" : res == HIST_HOUR ? "hour" : "day", nsSince(start) / lookups);
+  }
+
+  // the /history export of each ring, read out in TCP-sized chunks like the server does
+  const char *names[] = {"minute", "hour", "day"};
+  for (uint8_t res = HIST_MINUTE; res < HIST_LEVELS; res++)
+  {
+    AsyncWebServerRequest request;
+    request.addParam("res", names[res]);
+    auto start = bclock::now();
+    handleHistory(&request);
+    std::string body = request.body();
+    double ns = nsSince(start);
+
+    histheader h;
+    memcpy(&h, body.data(), sizeof(h));
+    check(body.size() == sizeof(h) + (size_t)h.count * h.stride * 2 && h.count == histSize[res], "export size", res);
+    int16_t last[6];
+    memcpy(last, body.data() + body.size() - h.stride * 2, h.stride * 2);
+    int16_t want = res == HIST_MINUTE ? histMinutes[histNewest[res] % HIST_MINUTES].temp
+                                      : (res == HIST_HOUR ? histHours[histNewest[res] % HIST_HOURS] : histDays[histNewest[res] % HIST_DAYS]).temp.avg;
+    check(last[res == HIST_MINUTE ? 0 : 1] == want, "export ends with the newest bucket", res);
+    printf("export %-6s %6zu bytes in %7.1f us\n", names[res], body.size(), ns / 1000);
+  }
+
+  printf("memory: %zu bytes of rings\n", sizeof(histMinutes) + sizeof(histHours) + sizeof(histDays));
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
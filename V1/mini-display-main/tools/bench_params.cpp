@@ -0,0 +1,198 @@
+/*
+Measures what parsing a web handler's query parameters costs, the old way (hasParam() and
+getParam(name) for every key, as the /init handler used to) against params.h's single pass,
+and checks that the single pass takes the same parameters the old way did.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -Ihost -I../src bench_params.cpp -o bench_params
+
+Usage:
+  bench_params [iterations]
+
+Prints ns per request for a few request shapes the pages send. Exits with 1 if a check fails:
+an unknown name whose hash collides with a key, a repeated key (the first one wins) and POST
+parameters (ignored) have to come out like they did with getParam(name).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "params.h"
+
+// the /init handler before params.h, minus what it did with the values
+void oldInitParams(AsyncWebServerRequest *request, initparams &q)
+{
+  q = {};
+  if (request->hasParam("name") && request->hasParam("pwd"))
+  {
+    q.name = &request->getParam("name")->value();
+    q.pwd = &request->getParam("pwd")->value();
+    q.seen |= INIT_NAME | INIT_PWD;
+  }
+  if (request->hasParam("apikey"))
+  {
+    q.apikey = &request->getParam("apikey")->value();
+    q.seen |= INIT_APIKEY;
+  }
+  if (request->hasParam("city") && request->hasParam("ccode"))
+  {
+    q.city = &request->getParam("city")->value();
+    q.ccode = &request->getParam("ccode")->value();
+    q.seen |= INIT_CITY | INIT_CCODE;
+  }
+  if (request->hasParam("time"))
+  {
+    q.time = &request->getParam("time")->value();
+    q.seen |= INIT_TIME;
+  }
+  if (request->hasParam("repeats") && request->hasParam("alarmtime") && request->hasParam("song"))
+  {
+    q.repeats = request->getParam("repeats")->value().toInt();
+    q.alarmtime = &request->getParam("alarmtime")->value();
+    q.song = request->getParam("song")->value().toInt();
+    q.seen |= INIT_REPEATS | INIT_ALARMTIME | INIT_SONG;
+  }
+  if (request->hasParam("alarmdel"))
+  {
+    q.alarmdel = request->getParam("alarmdel")->value().toInt();
+    q.seen |= INIT_ALARMDEL;
+  }
+  if (request->hasParam("tunedel"))
+  {
+    q.tunedel = request->getParam("tunedel")->value().toInt();
+    q.seen |= INIT_TUNEDEL;
+  }
+  if (request->hasParam("tz"))
+  {
+    q.tz = &request->getParam("tz")->value();
+    q.seen |= INIT_TZ;
+  }
+  if (request->hasParam("night"))
+  {
+    q.night = &request->getParam("night")->value();
+    q.seen |= INIT_NIGHT;
+  }
+}
+
+typedef struct
+{
+  const char *what;
+  const char *params[8][2];
+} shape;
+
+const shape shapes[] = {
+    {"wifi form", {{"name", "home"}, {"pwd", "hunter22"}}},
+    {"alarm form", {{"repeats", "127"}, {"alarmtime", "06:45"}, {"song", "2"}}},
+    {"browser time", {{"time", "1760000000"}}},
+    {"settings form", {{"apikey", "0123456789abcdef0123456789abcdef"}, {"city", "Singapore"}, {"ccode", "SG"}, {"tz", "Asia/Singapore"}, {"night", "23:00-07:00"}}},
+    {"unknown keys", {{"utm_source", "x"}, {"fbclid", "y"}, {"_", "1760000000"}, {"song", "1"}}},
+};
+
+void build(AsyncWebServerRequest &r, const shape &s)
+{
+  for (const auto &p : s.params)
+    if (p[0])
+      r.addParam(p[0], p[1]);
+}
+
+template <typename F>
+double nsPerCall(long iterations, F fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++)
+    fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAIL %s\n", what);
+    failures++;
+  }
+}
+
+void checks()
+{
+  // an unknown name that hashes like "name"
+  static_assert(paramHash("j53g3ra") == paramHash("name"), "j53g3ra collides with name");
+  {
+    AsyncWebServerRequest r;
+    r.addParam("j53g3ra", "evil");
+    r.addParam("pwd", "x");
+    initparams q;
+    parseInitParams(&r, q);
+    check(!q.has(INIT_NAME) && q.has(INIT_PWD), "a colliding unknown name is not taken as name");
+  }
+  {
+    AsyncWebServerRequest r;
+    r.addParam("j53g3ra", "evil");
+    r.addParam("name", "home");
+    initparams q;
+    parseInitParams(&r, q);
+    check(q.has(INIT_NAME) && *q.name == "home", "the real name after a colliding one is taken");
+  }
+  {
+    AsyncWebServerRequest r;
+    r.addParam("song", "2");
+    r.addParam("song", "7");
+    r.addParam("output", "5");
+    r.addParam("output", "6");
+    initparams q;
+    parseInitParams(&r, q);
+    gpioparams g;
+    parseGpioParams(&r, g);
+    check(q.song == 2 && g.song == 2 && g.output == 5, "the first of a repeated key wins");
+  }
+  {
+    AsyncWebServerRequest r;
+    r.addParam("value", "40", true);
+    r.addParam("value", "60");
+    r.addParam("value", "80");
+    int v = 0;
+    check(parseSliderValue(&r, v) && v == 60, "slider skips POST and takes the first value");
+  }
+  for (const shape &s : shapes)
+  {
+    AsyncWebServerRequest r;
+    build(r, s);
+    initparams a, b;
+    oldInitParams(&r, a);
+    parseInitParams(&r, b);
+    // the old handler only took keys in their groups, compare what both agree a group is
+    const uint16_t groups[] = {INIT_NAME | INIT_PWD, INIT_APIKEY, INIT_CITY | INIT_CCODE, INIT_TIME,
+                               INIT_REPEATS | INIT_ALARMTIME | INIT_SONG, INIT_TZ, INIT_NIGHT};
+    for (uint16_t g : groups)
+      check(a.has(g) == b.has(g), s.what);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  long iterations = argc > 1 ? atol(argv[1]) : 200000;
+
+  checks();
+
+  printf("%-14s %6s %10s %10s %8s\n", "request", "params", "old ns", "new ns", "speedup");
+  for (const shape &s : shapes)
+  {
+    AsyncWebServerRequest r;
+    build(r, s);
+    initparams q;
+    volatile uint16_t sink = 0;
+    double before = nsPerCall(iterations, [&]
+                              { oldInitParams(&r, q); sink = sink + q.seen; });
+    double after = nsPerCall(iterations, [&]
+                             { parseInitParams(&r, q); sink = sink + q.seen; });
+    printf("%-14s %6zu %10.1f %10.1f %7.1fx\n", s.what, r.params(), before, after, before / after);
+  }
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Generates src/tzdata.h, the UTC offset transitions of the zones the settings page offers, from
+the tz database of the machine it runs on (Python 3.9+ zoneinfo).
+
+Usage (from this folder):
+  python3 gen_tz.py [-o ../src/tzdata.h] [--from 2024] [--to 2050]
+
+Each zone gets two arrays: the UTC times its offset changes and the offset (minutes) from then
+on. The first entry is at 0 with the offset the zone had on 1 January of --from. After --to
+the last offset sticks, so run this again long before then, or when a country changes its
+rules (the header says which tzdata it was built from).
+
+To offer another zone, add it to ZONES. Order is the order of the list on the settings page.
+"""
+
+import argparse
+import datetime
+import os
+import re
+import zoneinfo
+
+ZONES = [
+    "Pacific/Honolulu",
+    "America/Anchorage",
+    "America/Los_Angeles",
+    "America/Denver",
+    "America/Phoenix",
+    "America/Chicago",
+    "America/Mexico_City",
+    "America/New_York",
+    "America/Toronto",
+    "America/Bogota",
+    "America/Santiago",
+    "America/Sao_Paulo",
+    "America/Argentina/Buenos_Aires",
+    "Atlantic/Reykjavik",
+    "UTC",
+    "Europe/London",
+    "Europe/Lisbon",
+    "Europe/Berlin",
+    "Europe/Paris",
+    "Europe/Madrid",
+    "Europe/Rome",
+    "Europe/Athens",
+    "Europe/Istanbul",
+    "Europe/Moscow",
+    "Africa/Lagos",
+    "Africa/Cairo",
+    "Africa/Johannesburg",
+    "Africa/Nairobi",
+    "Asia/Dubai",
+    "Asia/Tehran",
+    "Asia/Karachi",
+    "Asia/Kolkata",
+    "Asia/Kathmandu",
+    "Asia/Dhaka",
+    "Asia/Bangkok",
+    "Asia/Jakarta",
+    "Asia/Kuala_Lumpur",
+    "Asia/Singapore",
+    "Asia/Shanghai",
+    "Asia/Hong_Kong",
+    "Asia/Manila",
+    "Asia/Taipei",
+    "Asia/Seoul",
+    "Asia/Tokyo",
+    "Australia/Perth",
+    "Australia/Adelaide",
+    "Australia/Brisbane",
+    "Australia/Sydney",
+    "Pacific/Auckland",
+]
+
+
+def offset_at(zone, t):
+    return int(datetime.datetime.fromtimestamp(t, zone).utcoffset().total_seconds())
+
+
+def transitions(name, start, end):
+    zone = zoneinfo.ZoneInfo(name)
+    t = int(datetime.datetime(start, 1, 1, tzinfo=datetime.timezone.utc).timestamp())
+    stop = int(datetime.datetime(end + 1, 1, 1, tzinfo=datetime.timezone.utc).timestamp())
+    out = [(0, offset_at(zone, t))]
+    day = 86400
+    while t < stop:
+        if offset_at(zone, t + day) != offset_at(zone, t):
+            lo, hi = t, t + day  # offset changes in (lo, hi]
+            while hi - lo > 1:
+                mid = (lo + hi) // 2
+                if offset_at(zone, mid) == offset_at(zone, lo):
+                    lo = mid
+                else:
+                    hi = mid
+            out.append((hi, offset_at(zone, hi)))
+        t += day
+    for at, off in out:
+        assert off % 60 == 0, f"{name} has an offset of {off}s"
+    return out
+
+
+def array(ctype, name, values, per_line=8):
+    if len(values) <= per_line:
+        return [f"constexpr {ctype} {name}[] = {{{', '.join(values)}}};"]
+    rows = [", ".join(values[i:i + per_line]) for i in range(0, len(values), per_line)]
+    return [f"constexpr {ctype} {name}[] = {{"] + [f"    {r}," for r in rows] + ["};"]
+
+
+def tzdata_version():
+    try:
+        with open(os.path.join(zoneinfo.TZPATH[0], "tzdata.zi")) as f:
+            m = re.match(r"# version (\S+)", f.readline())
+            return m.group(1) if m else "unknown"
+    except (OSError, IndexError):
+        return "unknown"
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("-o", default=os.path.join(os.path.dirname(__file__), "..", "src", "tzdata.h"))
+    ap.add_argument("--from", dest="start", type=int, default=2024)
+    ap.add_argument("--to", dest="end", type=int, default=2050)
+    args = ap.parse_args()
+
+    lines = [
+        f"// generated by tools/gen_tz.py from tzdata {tzdata_version()}, {args.start}-{args.end}. do not edit",
+        "",
+    ]
+    entries = []
+    total = 0
+    for name in ZONES:
+        tr = transitions(name, args.start, args.end)
+        ident = re.sub(r"[^A-Za-z0-9]", "_", name)
+        lines += array("uint32_t", f"tzAt_{ident}", [str(at) for at, _ in tr])
+        lines += array("int16_t", f"tzOff_{ident}", [str(off // 60) for _, off in tr], 16)
+        std = min(off for _, off in tr) // 60
+        entries.append(f'    {{"{name}", tzAt_{ident}, tzOff_{ident}, {len(tr)}, {std}}},')
+        total += len(tr)
+
+    lines += ["", "constexpr tzzone tzZones[] = {"] + entries + ["};", ""]
+    with open(args.o, "w") as f:
+        f.write("\n".join(lines))
+    print(f"{len(ZONES)} zones, {total} transitions, {total * 6} bytes of tables")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,45 @@
+// a 128x64 SSD1306 frame buffer, for the host checks in tools/. only what the firmware headers
+// draw with: the buffer in the panel's layout (one byte = 8 rows of a column), the rotation and
+// drawPixel(). nothing is sent anywhere.
+
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define BLACK 0
+#define WHITE 1
+
+class Adafruit_SSD1306
+{
+  uint8_t buffer[128 * 64 / 8];
+  uint8_t rotation = 0;
+
+public:
+  Adafruit_SSD1306() { clearDisplay(); }
+
+  uint8_t *getBuffer() { return buffer; }
+  void clearDisplay() { memset(buffer, 0, sizeof(buffer)); }
+  void setRotation(uint8_t r) { rotation = r & 3; }
+  uint8_t getRotation() const { return rotation; }
+  int16_t width() const { return rotation & 1 ? 64 : 128; }
+  int16_t height() const { return rotation & 1 ? 128 : 64; }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color)
+  {
+    if (x < 0 || y < 0 || x >= width() || y >= height())
+      return;
+    int16_t t;
+    switch (rotation)
+    {
+    case 1: t = x; x = 127 - y; y = t; break;
+    case 2: x = 127 - x; y = 63 - y; break;
+    case 3: t = x; x = y; y = 63 - t; break;
+    }
+    uint8_t &b = buffer[x + (y / 8) * 128];
+    b = color ? b | 1 << (y & 7) : b & ~(1 << (y & 7));
+  }
+};
+
+#endif
@@ -0,0 +1,154 @@
+// just enough of the Arduino core for the firmware headers the host checks in tools/ include.
+// it isn't a port: what the headers don't use isn't here, and timing is the PC's.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "rtos.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+
+#define constrain(v, lo, hi) ((v) < (lo) ? (lo) : (v) > (hi) ? (hi) : (v))
+
+class String
+{
+  std::string s;
+
+public:
+  String(const char *c = "") : s(c ? c : "") {}
+  String(const std::string &c) : s(c) {}
+  explicit String(int v) : s(std::to_string(v)) {}
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool reserve(unsigned int n)
+  {
+    s.reserve(n);
+    return true;
+  }
+  long toInt() const { return atol(s.c_str()); }
+  int lastIndexOf(char c) const
+  {
+    size_t i = s.rfind(c);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned int from, unsigned int to = ~0u) const
+  {
+    from = min(from, length());
+    return String(s.substr(from, min(to, length()) - min(from, to)));
+  }
+  bool concat(const char *c, unsigned int n)
+  {
+    s.append(c, n);
+    return true;
+  }
+  String &operator+=(const char *c)
+  {
+    s += c;
+    return *this;
+  }
+  String &operator+=(const String &c)
+  {
+    s += c.s;
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s += c;
+    return *this;
+  }
+  bool operator==(const char *c) const { return s == c; }
+  bool operator!=(const char *c) const { return s != c; }
+  bool operator==(const String &c) const { return s == c.s; }
+  bool operator!=(const String &c) const { return s != c.s; }
+  String operator+(const String &c) const { return String(s + c.s); }
+  String operator+(const char *c) const { return String(s + c); }
+};
+
+// and this, so micros() and millis() read the simulated clock
+uint64_t (*hostMicrosHook)() = NULL;
+
+inline uint64_t hostMicros()
+{
+  if (hostMicrosHook)
+    return hostMicrosHook();
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() { return (unsigned long)hostMicros(); }
+inline unsigned long millis() { return (unsigned long)(hostMicros() / 1000); }
+inline void delay(uint32_t ms) { vTaskDelay(ms); }
+
+// the LEDC as piezo.h drives it: a check that listens to the buzzer sets this, it gets every
+// tone written, 0 Hz for silence
+void (*hostToneHook)(uint8_t channel, uint32_t freq) = NULL;
+
+inline uint32_t ledcSetup(uint8_t, uint32_t freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline uint32_t ledcWriteTone(uint8_t channel, uint32_t freq)
+{
+  if (hostToneHook)
+    hostToneHook(channel, freq);
+  return freq;
+}
+
+// a check that reads what the firmware prints sets this, it sees every write before muted does
+void (*hostSerialHook)(const char *s, size_t n) = NULL;
+
+class HardwareSerial
+{
+public:
+  bool muted = false; // a check that would drown in the firmware's log sets this
+
+  size_t write(const uint8_t *b, size_t n)
+  {
+    if (hostSerialHook)
+      hostSerialHook((const char *)b, n);
+    return muted ? n : fwrite(b, 1, n, stdout);
+  }
+  size_t print(const char *s)
+  {
+    if (hostSerialHook)
+      hostSerialHook(s, strlen(s));
+    return muted ? strlen(s) : fputs(s, stdout);
+  }
+  size_t println(const char *s)
+  {
+    if (hostSerialHook)
+    {
+      hostSerialHook(s, strlen(s));
+      hostSerialHook("\r\n", 2);
+    }
+    return muted ? strlen(s) + 1 : printf("%s\n", s);
+  }
+  size_t printf(const char *fmt, ...)
+  {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = muted ? vsnprintf(NULL, 0, fmt, ap) : vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void flush() { fflush(stdout); }
+};
+
+HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,147 @@
+// the request and response side of ESPAsyncWebServer, for the host checks in tools/. a request
+// is built by hand with addParam() and looked up the way the library does it, walking the list
+// in order. whatever a handler sends is kept on the request, and body() reads it out in the
+// chunks the library would hand to the TCP stack.
+
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#define HOST_TCP_CHUNK 1436 // one TCP segment
+
+class AsyncWebParameter
+{
+  String _name, _value;
+  bool _post, _file;
+
+public:
+  AsyncWebParameter(const String &name, const String &value, bool post = false, bool file = false)
+      : _name(name), _value(value), _post(post), _file(file) {}
+  const String &name() const { return _name; }
+  const String &value() const { return _value; }
+  bool isPost() const { return _post; }
+  bool isFile() const { return _file; }
+};
+
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerResponse
+{
+public:
+  int code = 200;
+  String contentType;
+  size_t length = 0;
+  AwsResponseFiller filler; // set for beginResponse(type, len, filler)
+  std::string content;      // everything else
+
+  virtual ~AsyncWebServerResponse() {}
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse
+{
+public:
+  size_t write(const uint8_t *b, size_t n)
+  {
+    content.append((const char *)b, n);
+    return n;
+  }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t printf(const char *fmt, ...)
+  {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return write((const uint8_t *)buf, n < 0 ? 0 : std::min((size_t)n, sizeof(buf) - 1));
+  }
+};
+
+class AsyncWebServerRequest
+{
+  std::vector<AsyncWebParameter *> _params;
+  AsyncWebServerResponse *_sent = NULL;
+
+public:
+  ~AsyncWebServerRequest()
+  {
+    for (AsyncWebParameter *p : _params)
+      delete p;
+    delete _sent;
+  }
+
+  void addParam(const char *name, const char *value, bool post = false)
+  {
+    _params.push_back(new AsyncWebParameter(name, value, post));
+  }
+
+  size_t params() const { return _params.size(); }
+  AsyncWebParameter *getParam(size_t i) const { return i < _params.size() ? _params[i] : NULL; }
+
+  bool hasParam(const String &name, bool post = false, bool file = false) const
+  {
+    return getParam(name, post, file) != NULL;
+  }
+  AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const
+  {
+    for (AsyncWebParameter *p : _params)
+      if (p->name() == name && p->isPost() == post && p->isFile() == file)
+        return p;
+    return NULL;
+  }
+
+  AsyncResponseStream *beginResponseStream(const String &type)
+  {
+    AsyncResponseStream *r = new AsyncResponseStream;
+    r->contentType = type;
+    return r;
+  }
+  AsyncWebServerResponse *beginResponse(const String &type, size_t len, AwsResponseFiller filler)
+  {
+    AsyncWebServerResponse *r = new AsyncWebServerResponse;
+    r->contentType = type;
+    r->length = len;
+    r->filler = filler;
+    return r;
+  }
+
+  void send(AsyncWebServerResponse *r)
+  {
+    delete _sent;
+    _sent = r;
+  }
+  void send(int code, const String &type = String(), const String &content = String())
+  {
+    AsyncWebServerResponse *r = new AsyncWebServerResponse;
+    r->code = code;
+    r->contentType = type;
+    r->content = content.c_str();
+    send(r);
+  }
+
+  AsyncWebServerResponse *sent() const { return _sent; }
+
+  // what went out on the wire, after the headers
+  std::string body(size_t chunk = HOST_TCP_CHUNK) const
+  {
+    if (!_sent)
+      return std::string();
+    if (!_sent->filler)
+      return _sent->content;
+    std::string out;
+    std::vector<uint8_t> buf(chunk);
+    while (out.size() < _sent->length)
+    {
+      size_t n = _sent->filler(buf.data(), std::min(chunk, _sent->length - out.size()), out.size());
+      if (n == 0)
+        break;
+      out.append((const char *)buf.data(), n);
+    }
+    return out;
+  }
+};
+
+#endif
@@ -0,0 +1,63 @@
+// NVS preferences in RAM, for the host checks in tools/. every Preferences object opened on the
+// same namespace sees the same keys, so a check can "restart" by opening a new one, and
+// hostPrefsClear() forgets everything like a fresh chip.
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+inline std::map<std::string, std::vector<uint8_t>> &hostPrefs()
+{
+  static std::map<std::string, std::vector<uint8_t>> all;
+  return all;
+}
+
+inline void hostPrefsClear() { hostPrefs().clear(); }
+
+class Preferences
+{
+  std::string ns;
+
+  std::string key(const char *k) const { return ns + "/" + k; }
+
+public:
+  bool begin(const char *name, bool readOnly = false)
+  {
+    (void)readOnly;
+    ns = name;
+    return true;
+  }
+  void end() {}
+
+  size_t putBytes(const char *k, const void *value, size_t len)
+  {
+    const uint8_t *p = (const uint8_t *)value;
+    hostPrefs()[key(k)].assign(p, p + len);
+    return len;
+  }
+  size_t getBytesLength(const char *k) const
+  {
+    auto it = hostPrefs().find(key(k));
+    return it == hostPrefs().end() ? 0 : it->second.size();
+  }
+  size_t getBytes(const char *k, void *buf, size_t maxLen) const
+  {
+    auto it = hostPrefs().find(key(k));
+    if (it == hostPrefs().end() || it->second.size() > maxLen)
+      return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  size_t putString(const char *k, const String &value) { return putBytes(k, value.c_str(), value.length()); }
+  String getString(const char *k, const String &def = String()) const
+  {
+    auto it = hostPrefs().find(key(k));
+    return it == hostPrefs().end() ? def : String(std::string(it->second.begin(), it->second.end()));
+  }
+  bool remove(const char *k) { return hostPrefs().erase(key(k)) != 0; }
+};
+
+#endif
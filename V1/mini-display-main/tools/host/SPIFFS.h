@@ -0,0 +1,103 @@
+// SPIFFS as a map of paths to bytes, for the host checks in tools/. files are flat like on
+// SPIFFS (a "directory" is just part of the name), a write past hostFsCapacity bytes in all
+// comes back short like a full flash, and hostFiles can be read and filled by the check.
+
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+std::map<std::string, std::shared_ptr<std::string>> hostFiles;
+size_t hostFsCapacity = 1 << 20;
+
+inline size_t hostFsUsed()
+{
+  size_t used = 0;
+  for (auto &f : hostFiles)
+    used += f.second->size();
+  return used;
+}
+
+class File
+{
+  std::shared_ptr<std::string> d;
+  size_t pos = 0;
+  bool writable = false;
+
+public:
+  File() {}
+  File(std::shared_ptr<std::string> data, bool write, bool append) : d(data), pos(append ? data->size() : 0), writable(write) {}
+
+  operator bool() const { return d != nullptr; }
+
+  size_t read(uint8_t *b, size_t n)
+  {
+    if (!d || writable)
+      return 0;
+    n = min(n, d->size() - min(pos, d->size()));
+    memcpy(b, d->data() + pos, n);
+    pos += n;
+    return n;
+  }
+  size_t write(const uint8_t *b, size_t n)
+  {
+    if (!d || !writable)
+      return 0;
+    n = min(n, hostFsCapacity - min(hostFsCapacity, hostFsUsed()));
+    d->replace(pos, min(n, d->size() - pos), (const char *)b, n);
+    pos += n;
+    return n;
+  }
+  bool seek(uint32_t p)
+  {
+    if (!d || p > d->size())
+      return false;
+    pos = p;
+    return true;
+  }
+  size_t size() const { return d ? d->size() : 0; }
+  void close() { d.reset(); }
+};
+
+class HostSPIFFS
+{
+public:
+  bool begin(bool = false) { return true; }
+
+  File open(const String &path, const char *mode = FILE_READ, bool create = false)
+  {
+    auto f = hostFiles.find(path.c_str());
+    if (*mode == 'r')
+      return f == hostFiles.end() ? File() : File(f->second, false, false);
+    if (f == hostFiles.end() || *mode == 'w')
+    {
+      hostFiles[path.c_str()] = std::make_shared<std::string>();
+      f = hostFiles.find(path.c_str());
+    }
+    return File(f->second, true, *mode == 'a');
+  }
+  bool exists(const String &path) { return hostFiles.count(path.c_str()) != 0; }
+  bool remove(const String &path) { return hostFiles.erase(path.c_str()) != 0; }
+  bool rename(const String &from, const String &to)
+  {
+    auto f = hostFiles.find(from.c_str());
+    if (f == hostFiles.end())
+      return false;
+    std::shared_ptr<std::string> data = f->second;
+    hostFiles.erase(f);
+    hostFiles[to.c_str()] = data;
+    return true;
+  }
+  size_t totalBytes() { return hostFsCapacity; }
+  size_t usedBytes() { return hostFsUsed(); }
+};
+
+HostSPIFFS SPIFFS;
+
+#endif
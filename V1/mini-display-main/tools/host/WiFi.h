@@ -0,0 +1,10 @@
+// the WiFi library headers the firmware includes, for the host checks in tools/. there is no
+// radio, only what WiFiUdp.h fakes.
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include "WiFiUdp.h"
+
+#endif
@@ -0,0 +1,82 @@
+// WiFiUDP on a fake network, for the host checks in tools/. what the firmware sends goes to
+// hostUdpSend, which the check points at its fake servers; they answer through hostDeliver()
+// with the micros() the reply arrives at, and parsePacket() only sees it from then on.
+
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+class WiFiUDP;
+
+// where sent packets go: host, port, payload and the socket a reply should be delivered to
+std::function<void(const char *, uint16_t, const std::vector<uint8_t> &, WiFiUDP &)> hostUdpSend;
+
+class WiFiUDP
+{
+  struct packet
+  {
+    uint64_t at; // micros() it arrives at
+    std::vector<uint8_t> data;
+  };
+  std::deque<packet> inbox;
+  std::vector<uint8_t> out, current;
+  size_t readPos = 0;
+  std::string host;
+  uint16_t port = 0;
+
+public:
+  uint8_t begin(uint16_t) { return 1; }
+
+  int beginPacket(const char *h, uint16_t p)
+  {
+    host = h;
+    port = p;
+    out.clear();
+    return 1;
+  }
+  size_t write(const uint8_t *b, size_t n)
+  {
+    size_t at = out.size();
+    out.resize(at + n);
+    memcpy(out.data() + at, b, n);
+    return n;
+  }
+  int endPacket()
+  {
+    if (hostUdpSend)
+      hostUdpSend(host.c_str(), port, out, *this);
+    return 1;
+  }
+
+  // queued by arrival time, so a late reply can't overtake an earlier one
+  void hostDeliver(const std::vector<uint8_t> &data, uint64_t at)
+  {
+    auto it = inbox.end();
+    while (it != inbox.begin() && (it - 1)->at > at)
+      --it;
+    inbox.insert(it, packet{at, data});
+  }
+
+  int parsePacket()
+  {
+    if (inbox.empty() || inbox.front().at > micros())
+      return 0;
+    current = inbox.front().data;
+    inbox.pop_front();
+    readPos = 0;
+    return current.size();
+  }
+  int read(uint8_t *b, size_t n)
+  {
+    n = std::min(n, current.size() - readPos);
+    memcpy(b, current.data() + readPos, n);
+    readPos += n;
+    return n;
+  }
+};
+
+#endif
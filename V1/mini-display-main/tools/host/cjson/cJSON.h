@@ -0,0 +1,22 @@
+// cJSON's allocator hooks and nothing else, for the host checks in tools/. there's no parser:
+// sim_arena replays the allocations cJSON makes through whatever the firmware hooked in.
+
+#ifndef HOST_CJSON_H
+#define HOST_CJSON_H
+
+#include <stdlib.h>
+
+typedef struct cJSON_Hooks
+{
+  void *(*malloc_fn)(size_t sz);
+  void (*free_fn)(void *ptr);
+} cJSON_Hooks;
+
+cJSON_Hooks hostCJSONHooks = {malloc, free};
+
+inline void cJSON_InitHooks(cJSON_Hooks *hooks)
+{
+  hostCJSONHooks = hooks ? *hooks : cJSON_Hooks{malloc, free};
+}
+
+#endif
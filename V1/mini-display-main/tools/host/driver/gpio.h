@@ -0,0 +1,50 @@
+// the GPIO matrix as far as the wake-up code uses it, for the host checks in tools/. the check
+// drives hostGpioLow[] itself and reads back what the firmware armed.
+
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#include <stdint.h>
+
+#define HOST_GPIOS 40
+
+typedef int gpio_num_t;
+
+typedef enum
+{
+  GPIO_INTR_DISABLE,
+  GPIO_INTR_POSEDGE,
+  GPIO_INTR_NEGEDGE,
+  GPIO_INTR_ANYEDGE,
+  GPIO_INTR_LOW_LEVEL,
+  GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+bool hostGpioLow[HOST_GPIOS];             // pins pulled low right now
+gpio_int_type_t hostGpioIntr[HOST_GPIOS]; // what the pin interrupts on
+bool hostGpioWake[HOST_GPIOS];            // wakes light sleep on its level
+
+inline esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+{
+  hostGpioIntr[pin] = type;
+  return ESP_OK;
+}
+
+// like ESP-IDF, arming a wake sets the pin's interrupt type to the level
+inline esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type)
+{
+  hostGpioIntr[pin] = type;
+  hostGpioWake[pin] = true;
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_wakeup_disable(gpio_num_t pin)
+{
+  hostGpioWake[pin] = false;
+  return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,67 @@
+// esp_partition on a RAM buffer, for the host checks in tools/. hostPartitionCreate() makes
+// the partition esp_partition_find_first() will return; without it there is none. reads,
+// writes and erases behave like NOR flash: erase sets a sector to 0xFF, writes only clear bits.
+
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_PARTITION_TYPE_DATA 1
+#define ESP_PARTITION_SUBTYPE_ANY 0xff
+
+typedef struct
+{
+  uint32_t size;
+  std::vector<uint8_t> *flash;
+} esp_partition_t;
+
+inline esp_partition_t *&hostPartition()
+{
+  static esp_partition_t *p = NULL;
+  return p;
+}
+
+inline esp_partition_t *hostPartitionCreate(uint32_t size)
+{
+  esp_partition_t *p = new esp_partition_t{size, new std::vector<uint8_t>(size, 0xff)};
+  hostPartition() = p;
+  return p;
+}
+
+inline const esp_partition_t *esp_partition_find_first(int, int, const char *)
+{
+  return hostPartition();
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *p, size_t addr, void *buf, size_t len)
+{
+  if (addr + len > p->size)
+    return ESP_FAIL;
+  memcpy(buf, p->flash->data() + addr, len);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *p, size_t addr, const void *buf, size_t len)
+{
+  if (addr + len > p->size)
+    return ESP_FAIL;
+  for (size_t i = 0; i < len; i++)
+    (*p->flash)[addr + i] &= ((const uint8_t *)buf)[i];
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t addr, size_t len)
+{
+  if (addr + len > p->size || addr % 4096 || len % 4096)
+    return ESP_FAIL;
+  memset(p->flash->data() + addr, 0xff, len);
+  return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,82 @@
+// light sleep on the simulated clock (esp_timer.h), for the host checks in tools/. sleeping lets
+// time pass a ms at a time through vTaskDelay()'s hook until the timer runs out or an armed pin
+// is low. while hostAsleep is set the check shouldn't fire interrupts, the chip doesn't see edges.
+
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+typedef enum
+{
+  ESP_SLEEP_WAKEUP_UNDEFINED,
+  ESP_SLEEP_WAKEUP_ALL,
+  ESP_SLEEP_WAKEUP_EXT0,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER,
+  ESP_SLEEP_WAKEUP_TOUCHPAD,
+  ESP_SLEEP_WAKEUP_ULP,
+  ESP_SLEEP_WAKEUP_GPIO,
+} esp_sleep_source_t;
+
+bool hostAsleep;
+bool hostSleepGpio;        // esp_sleep_enable_gpio_wakeup()
+uint64_t hostSleepTimerUs; // 0 none
+esp_sleep_source_t hostSleepCause;
+uint64_t hostSleptUs;      // all light sleep so far
+
+inline esp_err_t esp_sleep_enable_gpio_wakeup()
+{
+  hostSleepGpio = true;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us)
+{
+  hostSleepTimerUs = us;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source)
+{
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL)
+    hostSleepTimerUs = 0;
+  if (source == ESP_SLEEP_WAKEUP_GPIO || source == ESP_SLEEP_WAKEUP_ALL)
+    hostSleepGpio = false;
+  return ESP_OK;
+}
+
+inline bool hostGpioWakes()
+{
+  if (hostSleepGpio)
+    for (int i = 0; i < HOST_GPIOS; i++)
+      if (hostGpioWake[i] && (hostGpioIntr[i] == GPIO_INTR_LOW_LEVEL ? hostGpioLow[i] : hostGpioIntr[i] == GPIO_INTR_HIGH_LEVEL && !hostGpioLow[i]))
+        return true;
+  return false;
+}
+
+inline esp_err_t esp_light_sleep_start()
+{
+  int64_t start = hostClock.monoUs;
+  hostAsleep = true;
+  hostSleepCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+  while (!hostSleepCause)
+  {
+    if (hostGpioWakes())
+      hostSleepCause = ESP_SLEEP_WAKEUP_GPIO;
+    else if (hostSleepTimerUs && (uint64_t)(hostClock.monoUs - start) >= hostSleepTimerUs)
+      hostSleepCause = ESP_SLEEP_WAKEUP_TIMER;
+    else if (!hostSleepTimerUs && !hostSleepGpio)
+      abort(); // nothing armed, it would sleep forever
+    else
+      vTaskDelay(1);
+  }
+  hostAsleep = false;
+  hostSleptUs += hostClock.monoUs - start;
+  return ESP_OK;
+}
+
+inline esp_sleep_source_t esp_sleep_get_wakeup_cause() { return hostSleepCause; }
+
+#endif
@@ -0,0 +1,170 @@
+// esp_timer and the system clock on a simulated crystal, for the host checks in tools/. nothing
+// moves until the check calls hostAdvance() with an amount of real time: esp_timer then runs
+// (1 + hostClock.ppb / 1e9) times as fast, and the system clock is esp_timer plus whatever
+// settimeofday() and adjtime() did to it. adjtime() slews by 1/64 of the elapsed time, like
+// ESP-IDF. gettimeofday(), settimeofday(), adjtime() and time() are redirected here so a check
+// never touches the PC's clock; hostSimulate() makes millis() and vTaskDelay() follow esp_timer too.
+// one-shot esp_timers fire from hostAdvance(), on the thread that calls it, which plays the
+// esp_timer task: a callback runs with hostTimerLock held, and esp_timer_stop() takes it, so
+// like on the badge nothing stops a timer halfway through its callback.
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <vector>
+
+#define HOST_SLEW_SHIFT 6 // adjtime() corrects 1 us every 64 us
+
+typedef struct
+{
+  int64_t trueUs;  // real time, unix us
+  int64_t monoUs;  // esp_timer
+  double monoFrac; // fractions of a us esp_timer is owed
+  int64_t sysUs;   // system clock minus esp_timer
+  int64_t slewUs;  // what adjtime() still has to correct
+  int32_t ppb;     // crystal error, positive = runs fast
+} hostclock;
+
+hostclock hostClock;
+
+inline int64_t esp_timer_get_time() { return hostClock.monoUs; }
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  int dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  int64_t at; // esp_timer us it fires at
+  bool armed;
+};
+typedef esp_timer *esp_timer_handle_t;
+
+std::recursive_mutex hostTimerLock;
+std::vector<esp_timer *> hostTimers;
+
+inline int esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+  std::lock_guard<std::recursive_mutex> l(hostTimerLock);
+  *out = new esp_timer{args->callback, args->arg, 0, false};
+  hostTimers.push_back(*out);
+  return 0;
+}
+
+inline int esp_timer_start_once(esp_timer_handle_t t, uint64_t us)
+{
+  std::lock_guard<std::recursive_mutex> l(hostTimerLock);
+  t->at = hostClock.monoUs + (int64_t)us;
+  t->armed = true;
+  return 0;
+}
+
+inline int esp_timer_stop(esp_timer_handle_t t)
+{
+  std::lock_guard<std::recursive_mutex> l(hostTimerLock);
+  bool was = t->armed;
+  t->armed = false;
+  return was ? 0 : -1;
+}
+
+// the esp_timer task: runs every callback that's due, earliest first
+inline void hostRunTimers()
+{
+  std::lock_guard<std::recursive_mutex> l(hostTimerLock);
+  for (;;)
+  {
+    esp_timer *due = NULL;
+    for (esp_timer *t : hostTimers)
+      if (t->armed && t->at <= hostClock.monoUs && (!due || t->at < due->at))
+        due = t;
+    if (!due)
+      return;
+    due->armed = false;
+    due->callback(due->arg);
+  }
+}
+
+// lets us of real time pass
+inline void hostAdvance(int64_t us)
+{
+  hostClock.trueUs += us;
+  double mono = us * (1 + hostClock.ppb / 1e9) + hostClock.monoFrac;
+  int64_t dm = (int64_t)mono;
+  hostClock.monoFrac = mono - dm;
+  hostClock.monoUs += dm;
+
+  int64_t step = dm >> HOST_SLEW_SHIFT;
+  if (hostClock.slewUs < 0)
+    step = -min(step, -hostClock.slewUs);
+  else
+    step = min(step, hostClock.slewUs);
+  hostClock.sysUs += step;
+  hostClock.slewUs -= step;
+  if (!hostTimers.empty())
+    hostRunTimers();
+}
+
+// how far the system clock is from real time, us
+inline int64_t hostClockError() { return hostClock.monoUs + hostClock.sysUs - hostClock.trueUs; }
+
+inline int hostGettimeofday(struct timeval *tv, void *)
+{
+  int64_t us = hostClock.monoUs + hostClock.sysUs;
+  tv->tv_sec = us / 1000000;
+  tv->tv_usec = us % 1000000;
+  return 0;
+}
+
+inline time_t hostTime(time_t *t)
+{
+  time_t now = (hostClock.monoUs + hostClock.sysUs) / 1000000;
+  if (t)
+    *t = now;
+  return now;
+}
+
+inline int hostSettimeofday(const struct timeval *tv, const void *)
+{
+  hostClock.sysUs = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - hostClock.monoUs;
+  return 0;
+}
+
+inline int hostAdjtime(const struct timeval *delta, struct timeval *old)
+{
+  if (old)
+  {
+    old->tv_sec = hostClock.slewUs / 1000000;
+    old->tv_usec = hostClock.slewUs % 1000000;
+  }
+  if (delta)
+    hostClock.slewUs = (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+  return 0;
+}
+
+#define gettimeofday hostGettimeofday
+#define settimeofday hostSettimeofday
+#define adjtime hostAdjtime
+#define time(t) hostTime(t)
+
+// millis() and vTaskDelay() on esp_timer: a delay lets its time pass on the simulated clock
+inline uint64_t hostSimMicros() { return hostClock.monoUs; }
+inline void hostSimDelay(uint32_t ms) { hostAdvance((int64_t)ms * 1000); }
+
+inline void hostSimulate()
+{
+  hostMicrosHook = hostSimMicros;
+  hostDelayHook = hostSimDelay;
+}
+
+#endif
@@ -0,0 +1,277 @@
+// the FreeRTOS calls the firmware headers make, on std::thread. tasks are real threads, so
+// a host check can run the same producers and consumers the badge does; priorities, stack
+// sizes and core pinning are ignored, and a tick is a millisecond.
+
+#ifndef HOST_RTOS_H
+#define HOST_RTOS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+
+// a check on simulated time points this at its clock, delays then let simulated time pass
+void (*hostDelayHook)(uint32_t ms) = NULL;
+
+inline bool hostWait(std::unique_lock<std::mutex> &l, std::condition_variable &cv, TickType_t ticks, const std::function<bool()> &ready)
+{
+  if (ticks == portMAX_DELAY)
+  {
+    cv.wait(l, ready);
+    return true;
+  }
+  return cv.wait_for(l, std::chrono::milliseconds(ticks), ready);
+}
+
+// ------------------------------------------ TASKS ------------------------------------------
+
+struct hosttask
+{
+  hosttask(const char *n) : name(n) {}
+  std::string name;
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notified = 0;
+};
+typedef hosttask *TaskHandle_t;
+
+inline hosttask *&hostCurrentTask()
+{
+  static thread_local hosttask *t = NULL;
+  if (!t)
+    t = new hosttask("main"); // a thread the check started itself
+  return t;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t, void *param,
+                                          UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+  hosttask *t = new hosttask(name);
+  if (handle)
+    *handle = t;
+  std::thread([fn, param, t]
+              {
+    hostCurrentTask() = t;
+    fn(param); })
+      .detach();
+  return pdPASS;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostCurrentTask(); }
+inline const char *pcTaskGetName(TaskHandle_t t) { return (t ? t : hostCurrentTask())->name.c_str(); }
+inline BaseType_t xPortGetCoreID() { return 0; }
+inline void vTaskDelay(TickType_t ticks)
+{
+  if (hostDelayHook)
+    hostDelayHook(ticks);
+  else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline void xTaskNotifyGive(TaskHandle_t t)
+{
+  std::lock_guard<std::mutex> l(t->m);
+  t->notified++;
+  t->cv.notify_one();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *woken)
+{
+  xTaskNotifyGive(t);
+  if (woken)
+    *woken = pdTRUE;
+}
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  hosttask *t = hostCurrentTask();
+  // on simulated time a ms at a time, so whatever the check fires from its clock can notify.
+  // waiting forever is left to real time, it's another task's job to notify
+  bool simulated = hostDelayHook && ticks != portMAX_DELAY;
+  if (simulated)
+    for (TickType_t i = 0; i < ticks; i++)
+    {
+      {
+        std::lock_guard<std::mutex> l(t->m);
+        if (t->notified)
+          break;
+      }
+      hostDelayHook(1);
+    }
+  std::unique_lock<std::mutex> l(t->m);
+  if (simulated)
+    ticks = 0;
+  hostWait(l, t->cv, ticks, [t]
+           { return t->notified != 0; });
+  uint32_t n = t->notified;
+  if (n)
+    t->notified = clear ? 0 : n - 1;
+  return n;
+}
+
+// ------------------------------------------ LOCKS ------------------------------------------
+
+struct hostsemaphore
+{
+  std::timed_mutex m;
+};
+typedef hostsemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new hostsemaphore; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+  if (ticks == portMAX_DELAY)
+  {
+    s->m.lock();
+    return pdTRUE;
+  }
+  return s->m.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+  s->m.unlock();
+  return pdTRUE;
+}
+
+typedef std::mutex portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->lock()
+#define portEXIT_CRITICAL(mux) (mux)->unlock()
+
+// ------------------------------------------ EVENT GROUPS ------------------------------------------
+
+typedef uint32_t EventBits_t;
+
+struct hostevents
+{
+  std::mutex m;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+typedef hostevents *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() { return new hostevents; }
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits)
+{
+  std::lock_guard<std::mutex> l(g->m);
+  g->bits |= bits;
+  g->cv.notify_all();
+  return g->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits)
+{
+  std::lock_guard<std::mutex> l(g->m);
+  EventBits_t old = g->bits;
+  g->bits &= ~bits;
+  return old;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t g)
+{
+  std::lock_guard<std::mutex> l(g->m);
+  return g->bits;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> l(g->m);
+  hostWait(l, g->cv, ticks, [g, bits, all]
+           { return all ? (g->bits & bits) == bits : (g->bits & bits) != 0; });
+  EventBits_t got = g->bits;
+  if (clear)
+    g->bits &= ~bits;
+  return got;
+}
+
+// ------------------------------------------ QUEUES ------------------------------------------
+
+// the storage is allocated once at creation, like FreeRTOS, so a check counting allocations
+// doesn't see one per item
+struct hostqueue
+{
+  std::mutex m;
+  std::condition_variable cv;
+  std::vector<uint8_t> storage;
+  size_t length, size, head = 0, count = 0;
+};
+typedef hostqueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t size)
+{
+  hostqueue *q = new hostqueue;
+  q->length = length;
+  q->size = size;
+  q->storage.resize(length * size);
+  return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> l(q->m);
+  if (!hostWait(l, q->cv, ticks, [q]
+                { return q->count < q->length; }))
+    return pdFALSE;
+  memcpy(&q->storage[(q->head + q->count) % q->length * q->size], item, q->size);
+  q->count++;
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+// called after every item a task takes off a queue. a check on one core sets it to stall
+// there, which opens the window between taking a command and acting on it that preemption
+// would open on the badge
+void (*hostReceiveHook)(QueueHandle_t q) = NULL;
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+  {
+    std::unique_lock<std::mutex> l(q->m);
+    if (!hostWait(l, q->cv, ticks, [q]
+                  { return q->count != 0; }))
+      return pdFALSE;
+    memcpy(item, &q->storage[q->head * q->size], q->size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    q->cv.notify_all();
+  }
+  if (hostReceiveHook)
+    hostReceiveHook(q);
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+  std::lock_guard<std::mutex> l(q->m);
+  return q->count;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t q)
+{
+  std::lock_guard<std::mutex> l(q->m);
+  q->head = q->count = 0;
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+#endif
@@ -0,0 +1,292 @@
+/*
+Renders an alarm song on a PC, through the same sequencer the badge uses, so pitch and rhythm
+can be checked without flashing anything.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -I../src render_song.cpp -o render_song
+
+Usage:
+  render_song <song> [-o out.wav] [-r report.csv] [-c capture.txt] [-t tolerance_ms]
+
+  <song>   1-3 for a built-in song, or a .rtttl/.txt ringtone, or a .tun file pulled off SPIFFS
+  -o       writes the song as a 16-bit mono WAV, square wave like the LEDC output
+  -r       writes the timing report as CSV ("-" for stdout)
+  -c       compares a captured timeline instead of the sequencer's own one. one event per line:
+           "<start in us> <frequency in Hz>", e.g. logged from piezoTick() or a logic analyser
+  -t       exits with 1 if any note starts further than this many ms from where it should
+
+The report has one line per note: when it should start and how long it should last according
+to the note value and tempo (nominal), when it actually started and lasted, and the drift
+between the two. The summary at the end goes to stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+
+#include "songs.h"
+#include "sequencer.h"
+#include "rtttl.h"
+
+#define SAMPLE_RATE 22050
+#define AMPLITUDE 9000
+
+typedef struct
+{
+  uint16_t freq;
+  double nominalStart, nominalMs; // from the note value, in exact ms
+  double start, ms;               // what the engine (or the capture) did
+} event;
+
+bool loadFile(const char *path, std::vector<note> &notes, uint16_t &bpm)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  std::string data;
+  char buf[512];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  fclose(f);
+
+  if (data.size() >= sizeof(tuneheader) && !memcmp(data.data(), TUNE_MAGIC, 4))
+  {
+    tuneheader h;
+    memcpy(&h, data.data(), sizeof(h));
+    bpm = h.bpm;
+    for (size_t i = sizeof(h); i + 1 < data.size(); i += 2)
+      notes.push_back((uint8_t)data[i] | (uint8_t)data[i + 1] << 8);
+    return validBpm(bpm);
+  }
+
+  notes.resize(4096);
+  int count = rtttlCompile(data.c_str(), notes.data(), notes.size(), bpm);
+  if (count < 0)
+    return false;
+  notes.resize(count);
+  return true;
+}
+
+double nominalMs(note n, uint16_t bpm)
+{
+  double ms = 240000.0 / bpm / (1 << ((n >> NOTE_DIV_SHIFT) & 7));
+  return (n & NOTE_DOTTED) ? ms * 1.5 : ms;
+}
+
+// plays the tune through seqFill/seqStep exactly like piezoTick() does
+void runSequencer(const tune &t, std::vector<event> &events)
+{
+  sequencer s;
+  tablecursor c;
+  seqStart(s, tableSource(c, t), false, 0);
+  seqFill(s);
+
+  uint16_t freq;
+  uint32_t duration;
+  double now = 0;
+  size_t i = 0;
+  while (seqStep(s, freq, duration))
+  {
+    if (i < events.size())
+    {
+      events[i].start = now;
+      events[i].ms = duration;
+    }
+    i++;
+    now += duration;
+    if (seqNeedsFill(s))
+      seqFill(s);
+  }
+}
+
+bool loadCapture(const char *path, std::vector<event> &events)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+
+  std::vector<double> starts;
+  double us;
+  unsigned freq;
+  while (fscanf(f, "%lf %u", &us, &freq) == 2)
+    starts.push_back(us / 1000.0);
+  fclose(f);
+
+  if (starts.size() < events.size() + 1)
+  {
+    fprintf(stderr, "capture has %zu events, need %zu plus the final stop\n", starts.size(), events.size() + 1);
+    return false;
+  }
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    events[i].start = starts[i] - starts[0];
+    events[i].ms = starts[i + 1] - starts[i];
+  }
+  return true;
+}
+
+void put16(FILE *f, uint16_t v)
+{
+  fputc(v & 0xff, f);
+  fputc(v >> 8, f);
+}
+
+void put32(FILE *f, uint32_t v)
+{
+  put16(f, v & 0xffff);
+  put16(f, v >> 16);
+}
+
+bool writeWav(const char *path, const std::vector<event> &events)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+
+  const event &last = events.back();
+  uint32_t frames = (uint32_t)ceil((last.start + last.ms) * SAMPLE_RATE / 1000.0);
+
+  fwrite("RIFF", 1, 4, f);
+  put32(f, 36 + frames * 2);
+  fwrite("WAVEfmt ", 1, 8, f);
+  put32(f, 16);
+  put16(f, 1); // PCM
+  put16(f, 1); // mono
+  put32(f, SAMPLE_RATE);
+  put32(f, SAMPLE_RATE * 2);
+  put16(f, 2);
+  put16(f, 16);
+  fwrite("data", 1, 4, f);
+  put32(f, frames * 2);
+
+  size_t e = 0;
+  double phase = 0;
+  for (uint32_t i = 0; i < frames; i++)
+  {
+    double t = i * 1000.0 / SAMPLE_RATE;
+    while (e + 1 < events.size() && t >= events[e + 1].start)
+      e++;
+    int16_t sample = 0;
+    if (events[e].freq && t < events[e].start + events[e].ms)
+    {
+      phase += (double)events[e].freq / SAMPLE_RATE;
+      phase -= floor(phase);
+      sample = phase < 0.5 ? AMPLITUDE : -AMPLITUDE; // 50% duty, same as ledcWriteTone()
+    }
+    put16(f, sample);
+  }
+
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *wavPath = NULL, *reportPath = NULL, *capturePath = NULL;
+  double tolerance = -1;
+  const char *songArg = NULL;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      wavPath = argv[++i];
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+      reportPath = argv[++i];
+    else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+      capturePath = argv[++i];
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+      tolerance = atof(argv[++i]);
+    else
+      songArg = argv[i];
+  }
+  if (!songArg)
+  {
+    fprintf(stderr, "usage: %s <song> [-o out.wav] [-r report.csv] [-c capture.txt] [-t tolerance_ms]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<note> notes;
+  uint16_t bpm;
+  int builtin = atoi(songArg);
+  if (builtin >= 1 && builtin <= NUM_SONGS && strlen(songArg) <= 2)
+  {
+    const tune &t = songs[builtin - 1];
+    notes.assign(t.notes, t.notes + t.length);
+    bpm = t.bpm;
+  }
+  else if (!loadFile(songArg, notes, bpm))
+  {
+    fprintf(stderr, "cannot load %s\n", songArg);
+    return 2;
+  }
+  if (notes.empty())
+  {
+    fprintf(stderr, "%s has no notes\n", songArg);
+    return 2;
+  }
+
+  std::vector<event> events(notes.size());
+  double nominal = 0;
+  for (size_t i = 0; i < notes.size(); i++)
+  {
+    events[i].freq = noteFreq(notes[i]);
+    events[i].nominalStart = nominal;
+    events[i].nominalMs = nominalMs(notes[i], bpm);
+    nominal += events[i].nominalMs;
+  }
+
+  if (capturePath)
+  {
+    if (!loadCapture(capturePath, events))
+      return 2;
+  }
+  else
+  {
+    tune t = {notes.data(), (uint16_t)notes.size(), bpm};
+    runSequencer(t, events);
+  }
+
+  FILE *report = NULL;
+  if (reportPath)
+    report = strcmp(reportPath, "-") ? fopen(reportPath, "w") : stdout;
+  if (reportPath && !report)
+  {
+    fprintf(stderr, "cannot write %s\n", reportPath);
+    return 2;
+  }
+  if (report)
+    fprintf(report, "note,freq_hz,nominal_start_ms,nominal_ms,start_ms,duration_ms,drift_ms\n");
+
+  double maxDrift = 0;
+  size_t worst = 0;
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    const event &e = events[i];
+    double drift = e.start - e.nominalStart;
+    if (fabs(drift) > fabs(maxDrift))
+    {
+      maxDrift = drift;
+      worst = i;
+    }
+    if (report)
+      fprintf(report, "%zu,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", i, e.freq, e.nominalStart, e.nominalMs, e.start, e.ms, drift);
+  }
+  if (report && report != stdout)
+    fclose(report);
+
+  const event &last = events.back();
+  fprintf(stderr, "%zu notes at %u bpm, nominal %.1f ms, played %.1f ms, max drift %.3f ms at note %zu\n",
+          events.size(), bpm, last.nominalStart + last.nominalMs, last.start + last.ms, maxDrift, worst);
+
+  if (wavPath && !writeWav(wavPath, events))
+  {
+    fprintf(stderr, "cannot write %s\n", wavPath);
+    return 2;
+  }
+
+  return (tolerance >= 0 && fabs(maxDrift) > tolerance) ? 1 : 0;
+}
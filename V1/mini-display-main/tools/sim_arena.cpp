@@ -0,0 +1,434 @@
+/*
+Replays weeks of the badge's heap traffic through the request arenas (arena.h) and a simulated
+first-fit heap, once with the weather fetches in arena scopes like the firmware does and once
+without (everything on the heap, like before the arenas), and compares how fragmented the
+heap gets and whether a large payload can still be allocated.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src sim_arena.cpp -o sim_arena
+
+Usage:
+  sim_arena [weeks] [seed]
+
+The traffic: loop() fetches the weather every minute (HTTP client buffers on the heap, the
+payload from arenaAlloc(), then the cJSON tree through the hooks arenaBegin() installs, in the
+order cJSON allocates and frees its nodes and strings, sizes as on the 32-bit badge), the
+settings page changes the city about once a day (the same fetch on the web server's task),
+web requests come and go with their own heap objects, WiFi and lwIP take packet buffers for a
+few ms about once a second, and now and then something takes a block for hours (WiFi, DHCP,
+scans). The heap is HEAP_SIZE bytes of what's left after WiFi and
+the web server, first-fit with a header per block like ESP-IDF's multi_heap.
+
+Reported per mode: the heap allocations each fetch makes for its arena, payload and tree, the
+arenas' high-water marks and fallbacks, the least free heap, the smallest largest-free-block, the most
+free bytes outside the largest block (stranded, which doesn't depend on the heap's size), the
+worst fragmentation (1 - largest block / free) and how often an HTTP_MAX_PAYLOAD allocation at
+a random time about once an hour failed. The heap is looked at after every event, mid-fetch
+too. Both modes get the same heap, the arena buffers come out of it while a fetch's scope is
+open and count as one of its allocations. Exits with 1 if an arena had to fall back to
+the heap, the probe failed with arenas, or the arenas stranded more than STRANDED_SLACK times
+what the heap alone did.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "cjson/cJSON.h"
+
+// ------------------------------------------ HEAP ------------------------------------------
+
+#define HEAP_SIZE (48 * 1024)
+#define HEAP_HEADER 8 // per block
+#define HEAP_ALIGN 4
+#define HEAP_MIN_SPLIT 16
+#define HTTP_MAX_PAYLOAD 8192 // main.cpp's, a payload bigger than this is read through a String
+#define STRANDED_SLACK 1.1    // how much worse than heap only is still noise between seeds
+
+uint8_t heapMem[HEAP_SIZE] __attribute__((aligned(8)));
+std::map<uint32_t, uint32_t> heapFree, heapUsed; // block offset -> size with header
+uint64_t heapAllocs;
+
+void heapReset(uint32_t size)
+{
+  heapFree.clear();
+  heapUsed.clear();
+  heapFree[0] = size;
+}
+
+void *simMalloc(size_t n)
+{
+  heapAllocs++;
+  uint32_t need = (n + HEAP_HEADER + HEAP_ALIGN - 1) & ~(uint32_t)(HEAP_ALIGN - 1);
+  for (auto it = heapFree.begin(); it != heapFree.end(); ++it)
+  {
+    if (it->second < need)
+      continue;
+    uint32_t at = it->first, size = it->second;
+    heapFree.erase(it);
+    if (size - need >= HEAP_MIN_SPLIT)
+    {
+      heapFree[at + need] = size - need;
+      size = need;
+    }
+    heapUsed[at] = size;
+    return heapMem + at + HEAP_HEADER;
+  }
+  return NULL;
+}
+
+void simFree(void *p)
+{
+  if (!p)
+    return;
+  uint32_t at = (uint8_t *)p - heapMem - HEAP_HEADER;
+  auto used = heapUsed.find(at);
+  if (used == heapUsed.end())
+  {
+    printf("FAIL free of a block that isn't allocated\n");
+    exit(1);
+  }
+  uint32_t size = used->second;
+  heapUsed.erase(used);
+  auto next = heapFree.lower_bound(at);
+  if (next != heapFree.end() && at + size == next->first)
+  {
+    size += next->second;
+    next = heapFree.erase(next);
+  }
+  if (next != heapFree.begin())
+  {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == at)
+    {
+      prev->second += size;
+      return;
+    }
+  }
+  heapFree[at] = size;
+}
+
+typedef struct
+{
+  uint32_t free, largest, fragments;
+} heapstats;
+
+heapstats heapStats()
+{
+  heapstats s = {0, 0, (uint32_t)heapFree.size()};
+  for (auto &f : heapFree)
+  {
+    s.free += f.second;
+    s.largest = max(s.largest, f.second);
+  }
+  return s;
+}
+
+// arena.h's heap fallback goes to the simulated heap
+#define malloc simMalloc
+#define free simFree
+#include "arena.h"
+#undef malloc
+#undef free
+
+// ------------------------------------------ CJSON ------------------------------------------
+
+#define CJSON_NODE 40 // sizeof(cJSON) on the badge
+
+// what cJSON_Parse() allocated for one item
+struct cnode
+{
+  void *node = NULL, *key = NULL, *str = NULL;
+  std::vector<cnode> kids;
+};
+
+const char *jsonSkip(const char *p)
+{
+  while (*p == ' ' || *p == '\n')
+    p++;
+  return p;
+}
+
+// a string without escapes, into a block of its length + 1 like parse_string()
+const char *jsonString(const char *p, void **out)
+{
+  const char *end = strchr(p + 1, '"');
+  size_t len = end - p - 1;
+  char *s = (char *)hostCJSONHooks.malloc_fn(len + 1);
+  if (s)
+  {
+    memcpy(s, p + 1, len);
+    s[len] = 0;
+  }
+  *out = s;
+  return end + 1;
+}
+
+// parse_value(): objects and arrays get a node per member, then the member's key and value
+const char *jsonValue(const char *p, cnode &n)
+{
+  p = jsonSkip(p);
+  if (*p == '{' || *p == '[')
+  {
+    char close = *p == '{' ? '}' : ']';
+    p = jsonSkip(p + 1);
+    while (*p != close)
+    {
+      n.kids.emplace_back();
+      cnode &kid = n.kids.back();
+      kid.node = hostCJSONHooks.malloc_fn(CJSON_NODE);
+      if (close == '}')
+        p = jsonSkip(jsonString(jsonSkip(p), &kid.key)) + 1; // the ':'
+      p = jsonSkip(jsonValue(p, kid));
+      if (*p == ',')
+        p = jsonSkip(p + 1);
+    }
+    return p + 1;
+  }
+  if (*p == '"')
+    return jsonString(p, &n.str);
+  while (*p && *p != ',' && *p != '}' && *p != ']')
+    p++; // number, true, false, null
+  return p;
+}
+
+void jsonParse(const char *text, cnode &root)
+{
+  root.node = hostCJSONHooks.malloc_fn(CJSON_NODE);
+  jsonValue(text, root);
+}
+
+// cJSON_Delete(): each member's subtree, then its value string, key and node
+void jsonDelete(cnode &n)
+{
+  for (cnode &kid : n.kids)
+    jsonDelete(kid);
+  hostCJSONHooks.free_fn(n.str);
+  hostCJSONHooks.free_fn(n.key);
+  hostCJSONHooks.free_fn(n.node);
+}
+
+// OpenWeatherMap current weather, as the badge gets it
+const char *weatherJSON =
+    "{\"coord\":{\"lon\":100.3354,\"lat\":5.4112},\"weather\":[{\"id\":%d,\"main\":\"%s\",\"description\":\"%s\",\"icon\":\"%s\"}],"
+    "\"base\":\"stations\",\"main\":{\"temp\":299.12,\"feels_like\":301.4,\"temp_min\":298.03,\"temp_max\":299.12,\"pressure\":1009,"
+    "\"humidity\":83,\"sea_level\":1009,\"grnd_level\":1008},\"visibility\":10000,\"wind\":{\"speed\":2.06,\"deg\":240%s},%s"
+    "\"clouds\":{\"all\":75},\"dt\":1767225600,\"sys\":{\"type\":1,\"id\":9429,\"country\":\"MY\",\"sunrise\":1767222000,"
+    "\"sunset\":1767265000},\"timezone\":28800,\"id\":1735106,\"name\":\"%s\",\"cod\":200}";
+
+typedef struct
+{
+  int id;
+  const char *main, *desc, *icon;
+} weathertype;
+
+const weathertype weathers[] = {
+    {800, "Clear", "clear sky", "01d"},
+    {803, "Clouds", "broken clouds", "04n"},
+    {520, "Rain", "light intensity shower rain", "09d"},
+    {202, "Thunderstorm", "thunderstorm with heavy rain", "11d"},
+};
+const char *cities[] = {"George Town", "Kuala Lumpur", "Singapore", "Ho Chi Minh City"};
+
+// ------------------------------------------ TRAFFIC ------------------------------------------
+
+typedef std::multimap<int64_t, std::function<void()>> timeline;
+
+timeline events;
+bool scoped; // the fetches open arena scopes, like the firmware
+hosttask loopTask("loopTask"), webTask("async_tcp");
+int city;
+uint32_t fetches, failedFetches;
+uint64_t weatherAllocs; // heap allocations for the arena buffer, the payload and the tree
+
+void as(hosttask &t) { hostCurrentTask() = &t; }
+
+double expRand(double mean) { return -mean * log((rand() + 1.0) / (RAND_MAX + 2.0)); }
+
+// readWeatherAPI() and httpGETRequest() on task: the request and its headers take a few hundred
+// ms, the body goes into the payload, then the tree lives while the values are copied out.
+// other tasks' allocations land in between
+void fetch(hosttask &task, int64_t t)
+{
+  as(task);
+  uint64_t allocs = heapAllocs;
+  arenascope *scope = scoped ? new arenascope : NULL;
+  weatherAllocs += heapAllocs - allocs;
+  // the HTTP client's strings and the TCP connection
+  std::vector<void *> client = {simMalloc(96), simMalloc(64), simMalloc(180)};
+  fetches++;
+
+  const weathertype &w = weathers[rand() % 4];
+  char *json = new char[1024];
+  snprintf(json, 1024, weatherJSON, w.id, w.main, w.desc, w.icon, rand() % 3 ? "" : ",\"gust\":4.1",
+           rand() % 4 ? "" : "\"rain\":{\"1h\":0.25},", cities[city]);
+
+  int64_t body = t + 150 + rand() % 200, parsed = body + 5 + rand() % 20;
+  events.emplace(body, [&task, scope, client, json, parsed]
+                 {
+    as(task);
+    uint64_t allocs = heapAllocs;
+    size_t len = strlen(json);
+    char *payload = (char *)arenaAlloc(len + 1);
+    void *segment = simMalloc(1460); // the body's pbuf, until readBytes() has it
+    if (payload)
+      memcpy(payload, json, len + 1);
+    delete[] json;
+    simFree(segment);
+    for (void *p : client)
+      simFree(p); // http.end()
+    if (!payload)
+    {
+      failedFetches++;
+      delete scope;
+      return;
+    }
+
+    cnode *tree = new cnode;
+    jsonParse(payload, *tree);
+    arenaFree(payload);
+    weatherAllocs += heapAllocs - allocs - 1;
+    events.emplace(parsed, [&task, scope, tree]
+                   {
+      as(task);
+      jsonDelete(*tree); // jsObj going out of scope
+      delete tree;
+      delete scope; }); });
+}
+
+void webRequest(int64_t t)
+{
+  as(webTask);
+  std::vector<void *> blocks = {simMalloc(280)}; // the request
+  for (int i = rand() % 5; i > 0; i--)
+    blocks.push_back(simMalloc(16 + rand() % 33)); // parameter Strings
+  blocks.push_back(simMalloc(512 + rand() % 3585)); // the response
+  events.emplace(t + 20 + rand() % 780, [blocks]() mutable
+                 {
+    std::random_shuffle(blocks.begin(), blocks.end(), [](int n) { return rand() % n; });
+    for (void *p : blocks)
+      simFree(p); });
+}
+
+typedef struct
+{
+  uint32_t minFree, minLargest, maxFragments, maxStranded;
+  double worstFrag, meanStranded;
+  uint32_t probes, probeFailures;
+} runstats;
+
+runstats run(int weeks, int seed, bool withArenas)
+{
+  srand(seed);
+  uint32_t heapSize = HEAP_SIZE;
+  heapReset(heapSize);
+  for (arena &a : arenas)
+    a = {};
+  events.clear();
+  scoped = withArenas;
+  city = 0;
+  fetches = failedFetches = 0;
+  weatherAllocs = 0;
+  runstats r = {heapSize, heapSize, 0, 0, 0, 0, 0, 0};
+
+  int64_t end = (int64_t)weeks * 7 * 86400000;
+  for (int64_t t = 0; t < end; t += 60000)
+    events.emplace(t + 5000, [t]
+                   { fetch(loopTask, t + 5000); });
+  for (int64_t t = expRand(180000); t < end; t += expRand(180000))
+    events.emplace(t, [t]
+                   { webRequest(t); });
+  for (int64_t t = expRand(86400000); t < end; t += expRand(86400000))
+    events.emplace(t, [t]
+                   {
+      city = (city + 1) % 4;
+      fetch(webTask, t); });
+  for (int64_t t = expRand(1800000); t < end; t += expRand(1800000))
+    events.emplace(t, [t]
+                   {
+      void *p = simMalloc(24 + rand() % 677);
+      events.emplace(t + (int64_t)expRand(4 * 3600000.0), [p]
+                     { simFree(p); }); });
+  for (int64_t t = expRand(1000); t < end; t += expRand(1000))
+    events.emplace(t, [t]
+                   {
+      bool kept = rand() % 40 == 0;
+      void *p = simMalloc(kept ? 24 + rand() % 97 : 60 + rand() % 1541);
+      events.emplace(t + 1 + (int64_t)expRand(kept ? 2 * 3600000.0 : 80), [p]
+                     { simFree(p); }); });
+  for (int64_t t = expRand(3600000); t < end; t += expRand(3600000))
+    events.emplace(t, [&r]
+                   {
+      void *p = simMalloc(HTTP_MAX_PAYLOAD);
+      r.probes++;
+      r.probeFailures += !p;
+      simFree(p); });
+
+  // the heap after every event, so the moments in the middle of a fetch count too
+  uint64_t strandedSum = 0, samples = 0;
+  while (!events.empty() && events.begin()->first < end)
+  {
+    auto e = events.begin();
+    std::function<void()> f = e->second;
+    events.erase(e);
+    f();
+    heapstats s = heapStats();
+    r.minFree = min(r.minFree, s.free);
+    r.minLargest = min(r.minLargest, s.largest);
+    r.maxFragments = max(r.maxFragments, s.fragments);
+    r.worstFrag = max(r.worstFrag, 1 - (double)s.largest / s.free);
+    r.maxStranded = max(r.maxStranded, s.free - s.largest);
+    strandedSum += s.free - s.largest;
+    samples++;
+  }
+  r.meanStranded = (double)strandedSum / samples;
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  int weeks = argc > 1 ? atoi(argv[1]) : 4;
+  int seed = argc > 2 ? atoi(argv[2]) : 1;
+  Serial.muted = true;
+  arenaBegin();
+
+  printf("%-10s %8s %9s %10s %10s %10s %9s %9s %9s %9s %10s %6s %9s\n", "", "fetches", "per fetch", "loop high", "web high",
+         "fallbacks", "min free", "min block", "stranded", "mean", "worst frag", "pieces", "8K fails");
+  runstats modes[2];
+  for (int m = 0; m < 2; m++)
+  {
+    bool withArenas = m == 1;
+    runstats r = run(weeks, seed, withArenas);
+    modes[m] = r;
+    uint32_t fallbacks = 0;
+    size_t high[2] = {0, 0};
+    for (const arena &a : arenas)
+    {
+      fallbacks += a.fallbacks;
+      if (a.task)
+        high[a.task == &webTask] = a.high;
+    }
+    printf("%-10s %8u %9.1f %8u B %8u B %10u %7u B %7u B %7u B %7.0f B %9.1f%% %6u %4u/%u\n", withArenas ? "arenas" : "heap only",
+           fetches, (double)weatherAllocs / fetches, (unsigned)high[0], (unsigned)high[1], fallbacks, r.minFree, r.minLargest,
+           r.maxStranded, r.meanStranded, r.worstFrag * 100, r.maxFragments, r.probeFailures, r.probes);
+    if (withArenas && (fallbacks || failedFetches))
+      printf("FAIL %u allocations fell back to the heap, %u fetches failed\n", fallbacks, failedFetches);
+  }
+  printf("%d weeks, %u byte heap. per fetch: heap allocations for the arena buffer, payload and tree,\n"
+         "min block: smallest largest free block, stranded: most free bytes outside the largest block (and the mean),\n"
+         "worst frag: 1 - largest block / free, pieces: most free blocks\n",
+         weeks, HEAP_SIZE);
+
+  uint32_t fallbacks = 0;
+  for (const arena &a : arenas)
+    fallbacks += a.fallbacks;
+  bool ok = !fallbacks && !failedFetches && !modes[1].probeFailures && modes[1].maxStranded <= modes[0].maxStranded * STRANDED_SLACK;
+  if (!ok)
+    printf("checks failed\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+Runs the clock drift model (drift.h) on a simulated crystal whose error follows a synthetic
+temperature curve, and measures how far the clock wanders in a week without NTP, with the
+model and without it.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src sim_drift.cpp -o sim_drift
+
+Usage:
+  sim_drift [seed]
+
+Each scenario has a crystal (ppm against temperature) and a room (daily swing plus slower
+weather). The badge first learns for a while, from hourly NTP syncs or from browser epochs
+every two days (whole seconds, up to half a second of page latency), restarts, and then runs
+a week offline with driftTick() every minute. With night mode it light-sleeps every night,
+when esp_timer runs RTC_SLOW_PPB off and there's no NTP, and that mustn't end up in the model. The offline week is a few degrees warmer than
+anything it learned at, so the model has to extrapolate at the edges. Exits with 1 if a
+compensated clock ends the week more than OFFLINE_LIMIT_US off.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+
+// what drift.h needs of dhtsampler.h and power.h
+typedef enum
+{
+  DHT_NO_DATA,
+  DHT_GOOD,
+  DHT_STALE,
+} dhtquality;
+
+typedef struct
+{
+  int16_t temp;
+  uint8_t quality;
+} dhtsnapshot;
+
+dhtsnapshot simDHT = {0, DHT_NO_DATA};
+dhtsnapshot dhtLatest() { return simDHT; }
+
+typedef struct
+{
+  uint32_t sleeps;
+} powerstats;
+
+powerstats powerStats;
+
+#include "drift.h"
+
+#define START 1767225600000000LL // 2026-01-01 00:00 UTC, us
+#define MINUTE 60000000LL
+#define OFFLINE_DAYS 7
+#define OFFLINE_LIMIT_US 2000000 // "seconds per week"
+#define RTC_SLOW_PPB 150000      // esp_timer in light sleep, on the RTC slow clock
+
+typedef struct
+{
+  const char *name;
+  double ppm25, curve; // ppm at 25C, and the parabola's ppm / C^2 (quartz turns over at ~25C)
+  double agingPpmDay;  // slow shift over the whole run
+  double roomC, swingC;
+  bool browser; // learns from browser epochs instead of NTP
+  bool nights;  // night mode while learning: light sleep 23:00-07:00, no NTP
+  int learnDays;
+} scenario;
+
+const scenario scenarios[] = {
+    {"typical crystal, NTP", 12, -0.034, 0, 22, 3, false, false, 14},
+    {"fast crystal, warm room", 38, -0.040, 0, 27, 4, false, false, 14},
+    {"slow crystal, cold room", -25, -0.030, 0, 15, 3, false, false, 14},
+    {"aging crystal, NTP", 12, -0.034, 0.02, 22, 3, false, false, 14},
+    {"typical crystal, browser only", 12, -0.034, 0, 22, 3, true, false, 30},
+    {"typical crystal, NTP, night mode", 12, -0.034, 0, 22, 3, false, true, 14},
+};
+
+double crystalPpm(const scenario &s, double tempC, double day)
+{
+  return s.ppm25 + s.curve * (tempC - 25) * (tempC - 25) + s.agingPpmDay * day;
+}
+
+// the room at minute m: a daily swing, and weather that drifts over a few days
+double roomTemp(const scenario &s, uint32_t m, double warmer)
+{
+  double day = m / 1440.0;
+  return s.roomC + warmer + s.swingC * sin(2 * M_PI * (day - 0.3)) + 1.5 * sin(2 * M_PI * day / 4.7) + (rand() % 21 - 10) / 100.0;
+}
+
+// restarts the badge: the model comes back from NVS, the rest starts over
+void simRestart()
+{
+  driftModel = {};
+  driftAnchor = {};
+  driftLastTick = 0;
+  driftPendingNs = 0;
+  driftBegin();
+}
+
+// a week offline from the current state, returns the worst error and the final one in us
+void offlineWeek(const scenario &s, uint32_t &m, bool compensate, int64_t &worst, int64_t &final)
+{
+  worst = 0;
+  for (uint32_t end = m + OFFLINE_DAYS * 1440; m < end; m++)
+  {
+    double t = roomTemp(s, m, 3);
+    simDHT.temp = t * 100;
+    hostClock.ppb = crystalPpm(s, t, m / 1440.0) * 1000;
+    hostAdvance(MINUTE);
+    if (compensate)
+      driftTick();
+    worst = max(worst, (int64_t)llabs(hostClockError()));
+  }
+  final = hostClockError();
+}
+
+int main(int argc, char **argv)
+{
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  hostSimulate();
+  Serial.muted = true;
+  simDHT.quality = DHT_GOOD;
+  int failures = 0;
+
+  printf("%-34s %12s %12s %12s %10s\n", "", "uncorrected", "corrected", "worst", "bins");
+  for (const scenario &s : scenarios)
+  {
+    hostPrefsClear();
+    hostClock = {};
+    hostClock.trueUs = hostClock.sysUs = START;
+    simRestart();
+
+    // learning: NTP every hour, or the browser every two days, and the minute ticks
+    uint32_t m = 0;
+    for (; m < (uint32_t)s.learnDays * 1440; m++)
+    {
+      double t = roomTemp(s, m, 0);
+      simDHT.temp = t * 100;
+      hostClock.ppb = crystalPpm(s, t, m / 1440.0) * 1000;
+      bool asleep = s.nights && (m % 1440 >= 23 * 60 || m % 1440 < 7 * 60);
+      if (asleep)
+      {
+        hostClock.ppb = RTC_SLOW_PPB;
+        powerStats.sleeps++;
+      }
+      hostAdvance(MINUTE);
+      driftTick();
+      if (!s.browser && !asleep && m % 60 == 0)
+      {
+        driftReference(hostClock.trueUs, DRIFT_NTP);
+        struct timeval tv = {(time_t)(hostClock.trueUs / 1000000), (suseconds_t)(hostClock.trueUs % 1000000)};
+        settimeofday(&tv, NULL);
+      }
+      if (s.browser && m % 2880 == 0)
+      {
+        // the page's Date.now() / 1000, sent whenever the page got around to it
+        int64_t sent = hostClock.trueUs - rand() % 500000;
+        driftReference(sent / 1000000 * 1000000, DRIFT_BROWSER);
+        struct timeval tv = {(time_t)(sent / 1000000), 0};
+        settimeofday(&tv, NULL);
+      }
+    }
+    int bins = 0;
+    for (int b = 0; b < DRIFT_BINS; b++)
+      bins += driftModel.weight[b] != 0;
+
+    // the same week twice from the same point, once without the model
+    struct timeval tv = {(time_t)(hostClock.trueUs / 1000000), (suseconds_t)(hostClock.trueUs % 1000000)};
+    settimeofday(&tv, NULL);
+    hostclock clock = hostClock;
+    uint32_t start = m;
+    int seed = rand();
+
+    int64_t worstRaw, finalRaw, worst, final;
+    srand(seed);
+    offlineWeek(s, m, false, worstRaw, finalRaw);
+
+    hostClock = clock;
+    m = start;
+    srand(seed);
+    simRestart();
+    offlineWeek(s, m, true, worst, final);
+
+    bool ok = llabs(final) <= OFFLINE_LIMIT_US;
+    failures += !ok;
+    printf("%-34s %10.3f s %10.3f s %10.3f s %10d%s\n", s.name, finalRaw / 1e6, final / 1e6, worst / 1e6, bins, ok ? "" : "  FAIL");
+  }
+  printf("after a week offline, limit %.1f s\n", OFFLINE_LIMIT_US / 1e6);
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+/*
+Runs the flash log (flashlog.h, with datalog.h's compaction policy) on a simulated partition
+and cuts the power at random points: halfway through a record, a sector header, the zeroing of
+a reclaimed sector or an erase. After every cut it mounts the log again like a boot does and
+checks that nothing it had acknowledged is missing and nothing it returns is made up.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src sim_flashlog.cpp -o sim_flashlog
+
+Usage:
+  sim_flashlog [boots] [seed]
+
+Each boot writes what the badge writes (a record per minute, hour, day and weather fetch) for
+up to a few days and usually dies somewhere in between. Half the boots start with the clock
+in 1970 for a while, like after a power cut until NTP answers; the weather is logged with
+that time and compaction runs meanwhile. At the end it reports the cuts by kind, the wear
+spread over the sectors and the write amplification. Exits with 1 if a check fails.
+
+The simulated flash behaves like NOR: an erase sets a sector to 0xFF, writes only clear bits.
+A cut write programs a prefix of its bytes, a cut erase leaves a prefix of the sector erased
+and the rest as it was.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <Arduino.h>
+#include "datalog.h"
+
+#define SECTORS 64                // the datalog partition, 256 KB
+#define START 1767225600UL        // 2026-01-01 00:00 UTC
+
+typedef enum
+{
+  CUT_RECORD,
+  CUT_HEADER,
+  CUT_ZERO, // reclaimed sector's header
+  CUT_ERASE,
+  CUT_KINDS,
+} cutkind;
+
+const char *cutNames[CUT_KINDS] = {"record", "header", "zeroing", "erase"};
+
+typedef struct
+{
+  std::vector<uint8_t> bytes;
+  std::vector<uint32_t> erases; // per sector
+  int cutKind;                  // which operation the power goes in, -1 for a boot that isn't cut
+  long cutAfter;                // how many of them still go through before that
+  bool dead;
+  uint64_t programmed; // bytes written, for the write amplification
+  uint32_t cuts[CUT_KINDS];
+} simflash;
+
+// the operation the power goes in, if this is it. it programs or erases a random prefix
+bool simCut(simflash &f, cutkind kind)
+{
+  if (f.cutKind != kind || f.cutAfter-- > 0)
+    return false;
+  f.dead = true;
+  f.cuts[kind]++;
+  return true;
+}
+
+bool simRead(void *ctx, uint32_t addr, void *buf, size_t len)
+{
+  simflash &f = *(simflash *)ctx;
+  if (f.dead)
+    return false;
+  memcpy(buf, f.bytes.data() + addr, len);
+  return true;
+}
+
+bool simWrite(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+  simflash &f = *(simflash *)ctx;
+  if (f.dead)
+    return false;
+  size_t n = len;
+  if (simCut(f, len == sizeof(flogrecord) ? CUT_RECORD : len == sizeof(flogheader) ? CUT_HEADER : CUT_ZERO))
+    n = rand() % len;
+  for (size_t i = 0; i < n; i++)
+    f.bytes[addr + i] &= ((const uint8_t *)buf)[i];
+  f.programmed += n;
+  return !f.dead;
+}
+
+bool simErase(void *ctx, uint32_t addr)
+{
+  simflash &f = *(simflash *)ctx;
+  if (f.dead)
+    return false;
+  size_t n = FLOG_SECTOR;
+  if (simCut(f, CUT_ERASE))
+    n = rand() % FLOG_SECTOR;
+  memset(f.bytes.data() + addr, 0xff, n);
+  f.erases[addr / FLOG_SECTOR]++;
+  return !f.dead;
+}
+
+// every record the writer got a true back for, keyed by an id in data[4..5]
+typedef struct
+{
+  flogrecord r;
+  uint32_t seq; // of the sector it went into
+} acked;
+
+std::map<uint32_t, flogrecord> attempted; // everything ever passed to flogAppend
+std::vector<acked> acks;
+uint32_t nextId = 1;
+int failures = 0;
+
+void fail(const char *what, uint32_t id, int boot)
+{
+  if (failures++ < 20)
+    printf("FAIL boot %d: %s, record %u\n", boot, what, id);
+}
+
+uint32_t recordId(const flogrecord &r) { return (uint16_t)r.data[4] | (uint32_t)(uint16_t)r.data[5] << 16; }
+
+flogrecord makeRecord(uint8_t type, uint32_t time)
+{
+  uint32_t id = nextId++;
+  flogrecord r = {time, type, 0, {(int16_t)(rand() % 3000), (int16_t)(rand() % 10000), 0, 0, (int16_t)(id & 0xffff), (int16_t)(id >> 16)}, 0};
+  attempted[id] = r;
+  return r;
+}
+
+// what logWriter() does with a record, minus the queue
+bool simLog(flog &log, simflash &flash, flogrecord r, uint32_t clock)
+{
+  if (flogAppend(log, r))
+    acks.push_back({r, log.seq});
+  while (!flash.dead && flogFree(log) < LOG_RESERVE)
+    if (!flogReclaim(log, logKeep, &clock))
+      break;
+  return !flash.dead;
+}
+
+// sectors the log held just before the cut, as a range of sequence numbers
+void liveSeqs(const flog &log, uint32_t &first, uint32_t &last)
+{
+  last = log.seq;
+  first = log.seq - (log.head + log.sectors - log.tail) % log.sectors;
+}
+
+void collect(const flogrecord &r, void *ctx)
+{
+  (*(std::map<uint32_t, int> *)ctx)[recordId(r)]++;
+}
+
+int main(int argc, char **argv)
+{
+  int boots = argc > 1 ? atoi(argv[1]) : 500;
+  srand(argc > 2 ? atoi(argv[2]) : 1);
+
+  simflash flash = {};
+  flash.bytes.assign(SECTORS * FLOG_SECTOR, 0xff);
+  flash.erases.assign(SECTORS, 0);
+  flashdev dev = {simRead, simWrite, simErase, &flash, SECTORS * FLOG_SECTOR};
+
+  uint32_t now = START; // real time, the simulated clock's time only matches it once synced
+  uint64_t userBytes = 0;
+  uint32_t lostRollups = 0, checkedRollups = 0;
+  uint32_t firstSeq = 0, lastSeq = 0; // sectors the log held when the last boot ended
+
+  for (int boot = 0; boot <= boots; boot++) // the last one only mounts and checks
+  {
+    flash.dead = false;
+    flash.cutKind = -1;
+
+    flog log;
+    if (!flogMount(log, dev))
+    {
+      fail("mount failed", 0, boot);
+      break;
+    }
+
+    // what's in the log now against what the last boot had acknowledged
+    std::map<uint32_t, int> found;
+    flogForEach(log, collect, &found);
+    for (const auto &f : found)
+      if (!attempted.count(f.first))
+        fail("a record nobody wrote came back", f.first, boot);
+    for (const acked &a : acks)
+    {
+      uint32_t id = recordId(a.r);
+      bool live = a.seq >= firstSeq && a.seq <= lastSeq;
+      if (live && !found.count(id))
+        fail("an acknowledged record is missing", id, boot);
+      bool rollup = a.r.type == LOG_HOUR || a.r.type == LOG_DAY;
+      uint32_t keep = a.r.type == LOG_HOUR ? LOG_KEEP_HOURS : LOG_KEEP_DAYS;
+      if (rollup && now - a.r.time < keep)
+      {
+        checkedRollups++;
+        if (!found.count(id))
+        {
+          lostRollups++;
+          fail("a rollup compaction should have kept is gone", id, boot);
+        }
+      }
+    }
+    // only keep tracking what is still in the log
+    acks.erase(std::remove_if(acks.begin(), acks.end(), [&](const acked &a)
+                              { return !found.count(recordId(a.r)); }),
+               acks.end());
+    if (boot == boots)
+      break;
+
+    // this boot: how long it runs, whether the clock starts unset, where the power goes
+    uint32_t minutes = 60 + rand() % (4 * 1440);
+    uint32_t unsetFor = rand() % 2 ? 5 + rand() % 180 : 0;
+    if (rand() % 8)
+    {
+      // a sector takes about 200 records, and a header, a zeroing and an erase each
+      flash.cutKind = rand() % CUT_KINDS;
+      flash.cutAfter = rand() % (flash.cutKind == CUT_RECORD ? minutes : minutes / 200 + 1);
+    }
+
+    for (uint32_t m = 0; m < minutes && !flash.dead; m++, now += 60)
+    {
+      bool synced = m >= unsetFor;
+      uint32_t clock = synced ? now : m * 60; // seconds since the boot, in 1970
+      if (m % 10 == 0)
+      {
+        userBytes += sizeof(flogrecord);
+        simLog(log, flash, makeRecord(LOG_WEATHER, clock), clock);
+      }
+      if (!synced)
+        continue; // the history ignores readings without a real time
+      userBytes += sizeof(flogrecord);
+      simLog(log, flash, makeRecord(LOG_MINUTE, now), clock);
+      if (now % 3600 == 0)
+      {
+        userBytes += sizeof(flogrecord);
+        simLog(log, flash, makeRecord(LOG_HOUR, now - 3600), clock);
+      }
+      if (now % 86400 == 0)
+      {
+        userBytes += sizeof(flogrecord);
+        simLog(log, flash, makeRecord(LOG_DAY, now - 86400), clock);
+      }
+    }
+    liveSeqs(log, firstSeq, lastSeq);
+    now += rand() % 1800; // off for a while
+  }
+
+  uint32_t cuts = 0;
+  printf("%d boots, %lu days, %zu records written\n", boots, (now - START) / 86400, attempted.size());
+  printf("power cuts:");
+  for (int k = 0; k < CUT_KINDS; k++)
+  {
+    printf(" %s %u", cutNames[k], flash.cuts[k]);
+    cuts += flash.cuts[k];
+  }
+  printf(" (%u in all)\n", cuts);
+  printf("rollups checked after boots: %u, lost: %u\n", checkedRollups, lostRollups);
+  auto wear = std::minmax_element(flash.erases.begin(), flash.erases.end());
+  printf("erases per sector: %u to %u\n", *wear.first, *wear.second);
+  printf("write amplification: %.2f (flash bytes programmed / record bytes logged)\n", (double)flash.programmed / userBytes);
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
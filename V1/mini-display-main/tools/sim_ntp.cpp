@@ -0,0 +1,199 @@
+/*
+Runs the NTP client (timesync.h) against fake NTP servers on a simulated network and clock,
+and measures how fast and how close it gets to the real time, how many packets that takes,
+and whether the clock ever goes backwards.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src sim_ntp.cpp -o sim_ntp
+
+Usage:
+  sim_ntp [seed]
+
+The clock's crystal is 15 ppm fast, and driftTick() runs every minute like loop() does. Each
+scenario starts the clock off by some amount and runs rounds as ntpTask() schedules them for
+a day (or every few minutes, to catch a round that lands while an earlier slew is still
+running). Each server answers with its own clock error, and the network has per-direction
+delay, jitter and loss. A reply is only seen at the next 1 ms poll, like on the badge.
+
+Reported per scenario: how far the first round's offset is from the real one, how long until the clock is within
+the scenario's bound and stays there, the error over the last 12 hours, packets sent and
+used, and the steps. Exits with 1 if a scenario doesn't converge, a clock that wasn't far
+ahead went backwards, or a clock that was ahead got stepped.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include <WiFi.h>
+
+// what drift.h and timesync.h need of dhtsampler.h, power.h and wifisup.h
+typedef enum
+{
+  DHT_NO_DATA,
+  DHT_GOOD,
+  DHT_STALE,
+} dhtquality;
+
+typedef struct
+{
+  int16_t temp;
+  uint8_t quality;
+} dhtsnapshot;
+
+dhtsnapshot dhtLatest() { return {2200, DHT_GOOD}; }
+
+typedef struct
+{
+  uint32_t sleeps;
+} powerstats;
+
+powerstats powerStats;
+
+#define WIFI_EV_ONLINE (1 << 0)
+EventGroupHandle_t wifiEvents;
+
+#include "drift.h"
+#include "timesync.h"
+
+#define START 1767225600000000LL // 2026-01-01 00:00 UTC, us
+#define MINUTE 60000000LL
+#define CRYSTAL_PPB 15000
+
+typedef struct
+{
+  int64_t errorUs; // the server's own clock
+  int64_t outUs, backUs, jitterUs; // one-way delays, and up to this much more either way
+  int lossPct;
+} fakeserver;
+
+typedef struct
+{
+  const char *name;
+  int64_t startErrorUs; // how far the clock is off at the start, positive = ahead
+  fakeserver servers[NTP_SERVERS];
+  int64_t boundUs;  // converged when within this
+  uint32_t everyS;  // s between rounds once synced, 0 for ntpTask()'s NTP_INTERVAL
+  bool mayStepBack; // far enough ahead that stepping back is right
+} scenario;
+
+#define LAN {0, 2000, 2000, 1500, 0}
+const scenario scenarios[] = {
+    {"clean, 40 ms behind", -40000, {LAN, LAN, LAN}, 5000, 0, false},
+    {"clean, 5 s behind (step)", -5000000, {LAN, LAN, LAN}, 5000, 0, false},
+    {"clean, 20 s ahead (slew)", 20000000, {LAN, LAN, LAN}, 5000, 0, false},
+    {"clean, 2 min ahead (step back)", 120000000, {LAN, LAN, LAN}, 5000, 0, true},
+    {"one server 3 s off", -40000, {{3000000, 2000, 2000, 1500, 0}, LAN, LAN}, 5000, 0, false},
+    {"20% loss, 60 ms jitter", -40000, {{0, 20000, 20000, 60000, 20}, {0, 30000, 30000, 60000, 20}, {0, 25000, 25000, 60000, 20}}, 40000, 0, false},
+    {"asymmetric, 30 ms out 4 ms back", -40000, {{0, 30000, 4000, 1000, 0}, {0, 30000, 4000, 1000, 0}, {0, 30000, 4000, 1000, 0}}, 20000, 0, false},
+    {"20 s ahead, rounds every 5 min", 20000000, {LAN, LAN, LAN}, 5000, 300, false},
+};
+
+const scenario *current;
+
+int64_t jitter(int64_t up) { return up ? rand() % (up + 1) : 0; }
+
+// the fake servers: answer a client packet with receive and transmit times off their clock
+void fakeNTP(const char *host, uint16_t port, const std::vector<uint8_t> &pkt, WiFiUDP &udp)
+{
+  int server = -1;
+  for (size_t i = 0; i < NTP_SERVERS; i++)
+    if (!strcmp(host, ntpServers[i]))
+      server = i;
+  if (server < 0 || port != NTP_PORT || pkt.size() != NTP_PACKET)
+    return;
+  const fakeserver &f = current->servers[server];
+  if (rand() % 100 < f.lossPct || rand() % 100 < f.lossPct)
+    return; // lost on the way out or back
+
+  int64_t out = f.outUs + jitter(f.jitterUs), back = f.backUs + jitter(f.jitterUs), proc = 20 + rand() % 200;
+  std::vector<uint8_t> reply(NTP_PACKET, 0);
+  reply[0] = 0x24; // LI 0, version 4, server
+  reply[1] = 2;    // stratum
+  memcpy(&reply[24], &pkt[40], 8);
+  int64_t t2 = hostClock.trueUs + out + f.errorUs;
+  ntpWriteTime(&reply[32], t2);
+  ntpWriteTime(&reply[40], t2 + proc);
+  udp.hostDeliver(reply, hostClock.monoUs + out + proc + back);
+}
+
+int main(int argc, char **argv)
+{
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  hostSimulate();
+  Serial.muted = true;
+  hostUdpSend = fakeNTP;
+  int failures = 0;
+
+  printf("%-34s %10s %9s %9s %9s %7s %7s %5s %5s\n", "", "1st error", "bound", "within", "last 12h", "packets", "per day", "steps", "back");
+  for (const scenario &s : scenarios)
+  {
+    current = &s;
+    hostPrefsClear();
+    hostClock = {};
+    hostClock.trueUs = START;
+    hostClock.sysUs = START + s.startErrorUs;
+    hostClock.ppb = CRYSTAL_PPB;
+    driftModel = {};
+    driftAnchor = {};
+    driftLastTick = driftPendingNs = 0;
+    driftBegin();
+    ntpStatus = {};
+
+    int64_t firstRound = 0, worstLate = 0, convergedAt = -1;
+    int backwards = 0;
+    uint32_t nextRound = 0, usedAtConvergence = 0;
+    bool synced = false;
+    for (uint32_t m = 0; m < 1440; m++)
+    {
+      if (m >= nextRound)
+      {
+        struct timeval before, after;
+        gettimeofday(&before, NULL);
+        int64_t errBefore = hostClockError();
+        bool ok = ntpRound();
+        gettimeofday(&after, NULL);
+        if ((int64_t)after.tv_sec * 1000000 + after.tv_usec < (int64_t)before.tv_sec * 1000000 + before.tv_usec)
+          backwards++;
+        if (ok && !synced)
+          firstRound = ntpStatus.offset + errBefore; // what it measured against what it should have
+        synced = synced || ok;
+        uint32_t wait = !ok ? NTP_RETRY : s.everyS ? s.everyS : NTP_INTERVAL;
+        nextRound = m + wait / 60;
+      }
+      hostAdvance(MINUTE);
+      driftTick();
+
+      int64_t err = llabs(hostClockError());
+      if (err > s.boundUs)
+        convergedAt = -1;
+      else if (convergedAt < 0)
+      {
+        convergedAt = m + 1;
+        usedAtConvergence = ntpStatus.sent;
+      }
+      if (m >= 720)
+        worstLate = max(worstLate, err);
+    }
+
+    bool ok = convergedAt >= 0 && (s.mayStepBack || backwards == 0) && (s.startErrorUs <= 0 || s.mayStepBack || ntpStatus.stepped == 0);
+    failures += !ok;
+    char converge[16];
+    if (convergedAt < 0)
+      snprintf(converge, sizeof(converge), "never");
+    else
+      snprintf(converge, sizeof(converge), "%u min", (unsigned)convergedAt);
+    printf("%-34s %7.1f ms %6.1f ms %9s %6.2f ms %7u %7u %5u %5d%s\n", s.name, firstRound / 1000.0, s.boundUs / 1000.0, converge,
+           worstLate / 1000.0, usedAtConvergence, ntpStatus.sent, ntpStatus.stepped, backwards, ok ? "" : "  FAIL");
+  }
+  printf("within: minutes until the clock is within the bound and stays there for the rest of the day\n"
+         "packets: sent until then, per day: sent over the whole day\n");
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
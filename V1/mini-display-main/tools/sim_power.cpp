@@ -0,0 +1,347 @@
+/*
+Replays a day of the badge's loop() on a simulated clock through the idle policy (power.h)
+and night mode (night.h), and reports how often loop() woke, how long it was awake, idle and
+light-sleeping, and its duty cycle, like GET /power would. The wakes the other tasks' timers
+add while loop() is idle are counted next to it.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src sim_power.cpp -o sim_power
+
+Usage:
+  sim_power
+
+The loop here is main.cpp's loop() cut down to its timers: the 7-seg every second, the
+sensors every minute, the OLED every minute (not while a song plays or at night), the button
+and the alarms. It blocks between them with powerIdle(powerNextMs()) like loop() does, and
+night mode goes dark with nightDark() and light-sleeps with powerSleep(). The work each pass
+does takes the times below, roughly what the I2C OLED and the bit-banged 7-seg cost on the
+badge. Button presses hold the pin low for BUTTON_MS; one that comes during light sleep wakes
+it by level and the ISR never sees it, like on the chip.
+
+The other tasks that wake on a timer are the DHT sampler, every DHT_PERIOD, and the NTP
+client, every NTP_INTERVAL while WiFi is on (not at night). Each deadline that falls while
+loop() idles is a wake of its own. In powerSleep() everything stands still, and what came
+due runs when loop() wakes, so it adds no wake. The WiFi supervisor sleeps until an event
+while it's online or off, and the log tasks and the piezo only wake on a log line or a song,
+so none of them is counted. Their work isn't in loop()'s duty cycle; "all" adds it.
+
+Exits with 1 if the 7-seg showed a minute more than SEG_LATE_MS late, a press took more than
+PRESS_LIMIT_MS to get to the screen, an alarm didn't ring in its minute, or more than 1% of
+the wakes found nothing due.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include "serlog.h"
+#include "power.h"
+#include "tz.h"
+
+// what night.h needs of history.h
+#define HIST_VALID_AFTER 1672531200UL
+
+#include "night.h"
+
+#define DAY 1767225600L // 2026-01-01, local
+#define BUTTON_PIN 5
+#define BUTTON_MS 120
+#define SEG_LATE_MS 1500
+#define PRESS_LIMIT_MS 500
+
+// us of work per pass
+#define PASS_US 60      // the checks when nothing is due
+#define SEG_US 900      // TM1637, 4 digits bit-banged
+#define SENSORS_US 4000 // print the DHT reading, sparkline, drift tick, WiFi and weather bookkeeping
+#define SCREEN_US 26000 // OLED redraw, 1 KB over I2C at 400 kHz
+#define DARK_US 300     // OLED off, 7-seg dim, WiFi pause
+
+// the other tasks' timers
+#define DHT_PERIOD 5000   // ms, as in dhtsampler.h
+#define NTP_INTERVAL 3600 // s, as in timesync.h
+#define DHT_US 6000       // start pulse and the 40-bit frame, the RMT capture keeps the chip up
+#define NTP_US 40000      // a request and its answer with the radio up
+
+typedef struct
+{
+  const char *name;
+  const char *night;     // window for nightSet()
+  int alarm;             // local minute of the day, -1 none
+  const char *presses[8]; // local HH:MM:SS, NULL ends
+} scenario;
+
+const scenario scenarios[] = {
+    {"no night mode, nothing happens", "", -1, {NULL}},
+    {"no night mode, alarm, presses", "", 7 * 60, {"07:00:25", "08:15:00", "12:30:10", "18:45:30", "21:10:00", "23:40:05", NULL}},
+    {"night 23:00-07:00, alarm, presses", "23:00-07:00", 7 * 60, {"02:14:00", "07:00:25", "08:15:00", "12:30:10", "18:45:30", "23:40:05", NULL}},
+    {"night 23:00-07:00, alarm at 05:30", "23:00-07:00", 5 * 60 + 30, {"01:00:00", "05:30:40", "12:30:10", NULL}},
+    {"night 22:00-08:00, presses at night", "22:00-08:00", -1, {"00:30:00", "00:30:30", "03:00:00", "03:00:59", "05:00:00", "23:59:30", NULL}},
+};
+
+// what main.cpp's loop() keeps
+unsigned long prev_time_millis, prev_temphum_millis, prev_display_millis;
+bool buttonPressed;
+int currSong;
+powerlock songLock;
+
+// the day
+const scenario *current;
+time_t dayStart; // utc of local midnight
+long pressAt[8]; // ms into the day
+int presses;
+bool rang;
+long ringAt = -1;                      // ms into the day the alarm rang
+long pendingPress = -1;                // the press loop() hasn't got to yet
+long worstSegLate, worstPress;         // ms
+uint32_t emptyWakes;
+int shownMinute = -1;
+
+// the other tasks
+typedef struct
+{
+  long period, due; // ms, due in ms into the day
+  uint32_t us;      // work per run
+  bool needsWiFi;
+} tasktimer;
+
+tasktimer taskTimers[] = {{DHT_PERIOD, 0, DHT_US, false}, {NTP_INTERVAL * 1000L, 0, NTP_US, true}};
+uint32_t taskWakes;
+uint64_t taskAwakeUs;
+
+long dayMs() { return (long)(((hostClock.monoUs + hostClock.sysUs) / 1000) - (int64_t)dayStart * 1000); }
+
+void isr()
+{
+  buttonPressed = true;
+  powerWakeFromISR();
+}
+
+// the button: presses and releases since the last look, an edge only interrupts while awake
+long buttonSeen = -1;
+
+void simButton()
+{
+  long now = dayMs();
+  for (int p = 0; p < presses; p++)
+  {
+    if (pressAt[p] > buttonSeen && pressAt[p] <= now)
+    {
+      hostGpioLow[BUTTON_PIN] = true;
+      pendingPress = pressAt[p];
+      if (!hostAsleep && hostGpioIntr[BUTTON_PIN] == GPIO_INTR_NEGEDGE)
+        isr();
+    }
+    if (pressAt[p] + BUTTON_MS > buttonSeen && pressAt[p] + BUTTON_MS <= now)
+      hostGpioLow[BUTTON_PIN] = false;
+  }
+  buttonSeen = now;
+}
+
+// the tasks whose deadlines came. loop() is idle here, so each that runs woke the chip, unless
+// it's light-sleeping: then they run when it wakes
+void simTasks()
+{
+  long now = dayMs();
+  bool woke = false;
+  for (tasktimer &t : taskTimers)
+  {
+    if (now < t.due || (t.needsWiFi && nightActive))
+      continue; // ntp waits for WiFi to come back
+    for (; t.due <= now; t.due += t.period)
+      taskAwakeUs += t.us; // vTaskDelayUntil() catches up on what a sleep missed
+    woke = true;
+  }
+  taskWakes += woke && !hostAsleep;
+}
+
+// time passing in vTaskDelay(), powerIdle() and powerSleep()
+void simDelay(uint32_t ms)
+{
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    hostAdvance(1000);
+    simButton();
+    simTasks();
+  }
+}
+
+void work(uint32_t us)
+{
+  hostAdvance(us);
+  simButton();
+}
+
+// the press got to the screen
+void pressServed()
+{
+  if (pendingPress >= 0)
+    worstPress = max(worstPress, dayMs() - pendingPress);
+  pendingPress = -1;
+}
+
+time_t nextAlarm(time_t utc)
+{
+  if (current->alarm < 0 || rang)
+    return 0;
+  time_t at = dayStart + current->alarm * 60;
+  return at >= utc - 60 ? at : 0;
+}
+
+void loopPass()
+{
+  bool worked = false;
+  time_t utc = time(NULL);
+  time_t local = tzLocal(utc);
+  tm now;
+  gmtime_r(&local, &now);
+
+  bool dark = nightDark(now, utc, nextAlarm(utc), currSong != 0, buttonPressed);
+  if (dark != nightActive)
+  {
+    nightActive = dark;
+    prev_time_millis = 0;
+    work(dark ? DARK_US : SCREEN_US);
+    if (!dark)
+    {
+      prev_display_millis = millis();
+      pressServed();
+    }
+    worked = true;
+  }
+
+  if (millis() - prev_time_millis > 1 * 1000)
+  {
+    work(SEG_US);
+    int minute = now.tm_hour * 60 + now.tm_min;
+    if (minute != shownMinute)
+    {
+      // how long the 7-seg showed the old minute
+      long late = dayMs() - (long)minute * 60000;
+      if (shownMinute >= 0 && late >= 0)
+        worstSegLate = max(worstSegLate, late);
+      shownMinute = minute;
+    }
+    if (currSong == 0 && !rang && minute == current->alarm)
+    {
+      currSong = 1;
+      rang = true;
+      ringAt = dayMs();
+      powerHold(songLock, true);
+    }
+    prev_time_millis = millis();
+    worked = true;
+  }
+
+  if (millis() - prev_temphum_millis > 60 * 1000)
+  {
+    work(SENSORS_US);
+    prev_temphum_millis = millis();
+    worked = true;
+  }
+
+  if (!nightActive && millis() - prev_display_millis > 60 * 1000 && currSong == 0)
+  {
+    work(SCREEN_US);
+    prev_display_millis = millis();
+    worked = true;
+  }
+
+  if (buttonPressed)
+  {
+    buttonPressed = false;
+    if (currSong != 0)
+    {
+      currSong = 0;
+      powerHold(songLock, false);
+    }
+    work(SCREEN_US);
+    prev_display_millis = millis();
+    pressServed();
+    worked = true;
+  }
+
+  work(PASS_US);
+  emptyWakes += !worked;
+
+  const unsigned long last[] = {prev_time_millis, prev_temphum_millis, prev_display_millis};
+  const uint32_t every[] = {1000, 60 * 1000, currSong == 0 ? 60 * 1000U : 0U};
+  if (!nightActive)
+    powerIdle(powerNextMs(millis(), last, every, 3));
+  else if (powerSleep(nightMsToMinute()))
+    buttonPressed = true;
+}
+
+int main()
+{
+  hostSimulate();
+  hostDelayHook = simDelay;
+  Serial.muted = true;
+  tzZone = &tzZones[tzFind("Europe/Berlin")];
+  powerLockCreate(songLock, "song");
+  int failures = 0;
+
+  printf("%-38s %7s %6s %6s %6s %9s %9s %9s %6s %6s %6s %7s %6s\n", "", "wakes", "tasks", "button", "sleeps", "awake", "idle",
+         "asleep", "duty", "all", "empty", "7-seg", "press");
+  for (const scenario &s : scenarios)
+  {
+    current = &s;
+    hostPrefsClear();
+    hostClock = {};
+    dayStart = DAY - tzOffset(DAY);
+    hostClock.trueUs = hostClock.sysUs = (int64_t)dayStart * 1000000;
+    hostSleptUs = 0;
+    nightBegin();
+    nightSet(s.night);
+    nightActive = false;
+    nightAwakeMillis = 0;
+    prev_time_millis = prev_temphum_millis = prev_display_millis = 0;
+    buttonPressed = false;
+    currSong = 0;
+    rang = false;
+    ringAt = pendingPress = -1;
+    worstSegLate = worstPress = 0;
+    emptyWakes = 0;
+    shownMinute = -1;
+    buttonSeen = -1;
+    taskTimers[0].due = DHT_PERIOD;
+    taskTimers[1].due = NTP_INTERVAL * 1000L;
+    taskWakes = 0;
+    taskAwakeUs = 0;
+    presses = 0;
+    for (int p = 0; s.presses[p]; p++)
+    {
+      unsigned h, m, sec;
+      sscanf(s.presses[p], "%u:%u:%u", &h, &m, &sec);
+      pressAt[presses++] = (h * 3600 + m * 60 + sec) * 1000L;
+    }
+    powerBegin(BUTTON_PIN);
+    gpio_set_intr_type(BUTTON_PIN, GPIO_INTR_NEGEDGE); // attachInterrupt(BUTTON_PIN, isr, FALLING)
+    powerArmButton();
+    powerStats = {};
+    powerAwakeSince = esp_timer_get_time();
+
+    while (dayMs() < 86400000L)
+      loopPass();
+
+    powerstats &p = powerStats;
+    uint64_t total = p.awakeUs + p.idleUs;
+    bool alarmOk = s.alarm < 0 || (ringAt >= s.alarm * 60000L && ringAt < (s.alarm + 1) * 60000L);
+    bool ok = worstSegLate <= SEG_LATE_MS && worstPress <= PRESS_LIMIT_MS && alarmOk && emptyWakes * 100 <= p.wakes;
+    failures += !ok;
+    printf("%-38s %7lu %6lu %6lu %6lu %7.1f s %7.1f s %7.1f s %4.1f%% %4.1f%% %6lu %4ld ms %3ld ms%s%s\n", s.name,
+           (unsigned long)p.wakes, (unsigned long)taskWakes, (unsigned long)p.buttonWakes, (unsigned long)p.sleeps, p.awakeUs / 1e6,
+           (p.idleUs - hostSleptUs) / 1e6, hostSleptUs / 1e6, total ? p.awakeUs * 100.0 / total : 100.0,
+           total ? (p.awakeUs + taskAwakeUs) * 100.0 / total : 100.0, (unsigned long)emptyWakes, worstSegLate, worstPress,
+           alarmOk ? "" : "  ALARM", ok ? "" : "  FAIL");
+  }
+  printf("wakes: loop()'s, tasks: the DHT sampler's and NTP's timers while loop() idles (the WiFi supervisor, log tasks and\n"
+         "piezo only wake on events and aren't counted)\n"
+         "idle: CPU idle with WiFi in modem sleep, asleep: powerSleep() light sleep, duty: loop() awake / day, all: with the tasks\n"
+         "empty: wakes with nothing due, 7-seg: latest minute change, press: slowest press to the screen\n");
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/*
+Runs the badge's steady-state work for days on a simulated clock with malloc() hooked, and
+counts the heap allocations each periodic job makes once it's warmed up. There should be none:
+the formatting is into caller buffers (fmt.h, fixedpoint.h), the log is a fixed ring
+(serlog.h), the history and sparklines are static rings.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src soak_heap.cpp -o soak_heap
+
+Usage:
+  soak_heap [days]
+
+The jobs are the firmware's own functions, called the way main.cpp and dhtsampler.h call them
+(those two need the hardware, so the calls are copied here): loop()'s 7-seg tick with its
+time line every second, a DHT read every DHT_PERIOD with its heat index, dew point and
+history entry, and every minute printDHT(), sparkUpdate(), driftTick() and the sensor and
+sparkline screens' formatting and blit. The serial log's drain task and the data log's writer
+run on their own threads (the data log on a RAM partition, compacting as it fills), and
+each second waits for them to catch up.
+WiFi, the weather request and the web server aren't in it (they need the network; the
+request arenas are checked by sim_arena). The first hour is warm-up and isn't counted.
+Exits with 1 if anything allocates after that.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <atomic>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include "esp_partition.h"
+#define SLOG_LEVEL SLOG_DEBUG // the time line too
+#include "serlog.h"
+#include "fmt.h"
+#include "fixedpoint.h"
+#include "tz.h"
+#include "params.h"
+#include "history.h"
+#include <Adafruit_SSD1306.h>
+
+// what drift.h and sparkline.h need of dhtsampler.h and power.h
+#define DHT_PERIOD 5000
+
+typedef enum
+{
+  DHT_NO_DATA,
+  DHT_GOOD,
+  DHT_STALE,
+} dhtquality;
+
+typedef struct
+{
+  int16_t temp, hum, hi, dew;
+  unsigned long millis;
+  uint8_t quality;
+  uint32_t samples, failures;
+  uint8_t lastError;
+} dhtsnapshot;
+
+dhtsnapshot simDHT;
+dhtsnapshot dhtLatest() { return simDHT; }
+
+typedef struct
+{
+  uint32_t sleeps;
+} powerstats;
+
+powerstats powerStats;
+
+#include "drift.h"
+#include "sparkline.h"
+
+#define START 1767225600L // 2026-01-01 00:00 UTC
+#define WARMUP_S 3600
+#define LOG_SIZE (16 * 4096) // small, so the writer compacts
+
+// ------------------------------------------ COUNTING ------------------------------------------
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+
+thread_local bool heapMain;     // the thread the jobs run on
+uint64_t *heapJob;               // its counter for the job running now, NULL while warming up
+std::atomic<bool> heapCounting;  // past the warm-up
+std::atomic<uint64_t> heapOther; // allocations on the other threads (the two log tasks)
+
+void heapCount()
+{
+  if (heapMain)
+  {
+    if (heapJob)
+      (*heapJob)++;
+  }
+  else if (heapCounting)
+    heapOther++;
+}
+
+extern "C" void *malloc(size_t n)
+{
+  heapCount();
+  return __libc_malloc(n);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+  heapCount();
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t n)
+{
+  heapCount();
+  return __libc_realloc(p, n);
+}
+
+extern "C" void free(void *p) { __libc_free(p); }
+
+// ------------------------------------------ JOBS ------------------------------------------
+
+Adafruit_SSD1306 display;
+
+// loop()'s 7-seg update and its time line
+void jobSecond()
+{
+  tm now = tzNow();
+  volatile int seg = 100 * now.tm_hour + now.tm_min; // showNumberDecEx()
+  (void)seg;
+  SLOGD("[CODE] RTC Time: %d/%d/%d (%s), %02d:%02d:%02d", now.tm_mday, now.tm_mon + 1, now.tm_year + 1900, fmtDay(now.tm_wday),
+        now.tm_hour, now.tm_min, now.tm_sec);
+}
+
+// what dhtSampler() does with a good read
+void jobRead()
+{
+  double t = (double)hostClock.trueUs / 86400e6;
+  dhtsnapshot &s = simDHT;
+  s.temp = 2400 + 300 * sin(2 * M_PI * t) + rand() % 20;
+  s.hum = 6000 + 1000 * cos(2 * M_PI * t) + rand() % 50;
+  s.hi = fixHeatIndex(s.temp, s.hum);
+  s.dew = fixDewPoint(s.temp, s.hum);
+  s.millis = millis();
+  s.quality = DHT_GOOD;
+  s.samples++;
+  histAdd(time(NULL), s.temp, s.hum);
+}
+
+// printDHT()
+void jobPrint()
+{
+  dhtsnapshot dht = dhtLatest();
+  char temp[12], hum[12], hi[12], dew[12];
+  fixFormat(temp, dht.temp, 2);
+  fixFormat(hum, dht.hum, 2);
+  fixFormat(hi, dht.hi, 2);
+  fixFormat(dew, dht.dew, 2);
+  SLOGI("[MODULE] DHT READ: %sC, %s%%, %sC, dew point %sC (%s, %lus old, %u failed reads)", temp, hum, hi, dew,
+        dht.quality == DHT_GOOD ? "good" : "stale", (uint32_t)((millis() - dht.millis) / 1000), dht.failures); // unsigned long is 32-bit on the badge
+}
+
+void jobSpark() { sparkUpdate(); }
+
+void jobDrift() { driftTick(); }
+
+// drawSensorData() and drawSparklines(): the numbers, and the plots into the frame buffer
+void jobScreens()
+{
+  dhtsnapshot dht = dhtLatest();
+  char num[12];
+  fixFormat(num, dht.temp, 2);
+  fixFormat(num, dht.hum, 2);
+  fixFormat(num, dht.hi, 2);
+  fixFormat(num, fixDiv(dht.temp, 10), 1);
+  fixFormat(num, fixDiv(dht.hum, 10), 1);
+  sparkBlit(display, sparkTemp);
+  sparkBlit(display, sparkHum);
+}
+
+// time for the serial log's drain task and the data log's writer to catch up
+void jobDrain()
+{
+  while (slogTail != slogHead.load() || uxQueueMessagesWaiting(logQueue))
+    std::this_thread::yield();
+}
+
+typedef struct
+{
+  const char *name;
+  void (*run)();
+  uint32_t everyS;
+  uint64_t runs, allocs;
+} job;
+
+job jobs[] = {
+    {"7-seg tick and time line", jobSecond, 1},
+    {"DHT read, history", jobRead, DHT_PERIOD / 1000},
+    {"printDHT()", jobPrint, 60},
+    {"sparkUpdate()", jobSpark, 60},
+    {"driftTick()", jobDrift, 60},
+    {"sensor and sparkline screens", jobScreens, 60},
+    {"waiting for the log tasks", jobDrain, 1},
+
+};
+
+int main(int argc, char **argv)
+{
+  int days = argc > 1 ? atoi(argv[1]) : 3;
+  heapMain = true;
+  hostSimulate();
+  Serial.muted = true;
+  hostClock.trueUs = hostClock.sysUs = (int64_t)START * 1000000;
+  tzZone = &tzZones[tzFind("Europe/Berlin")];
+  hostPartitionCreate(LOG_SIZE);
+  slogBegin();
+  driftBegin();
+  histBegin(tzOffset(START));
+
+  for (uint32_t s = 0; s < (uint32_t)days * 86400; s++)
+  {
+    if (s == WARMUP_S)
+      heapCounting = true;
+    for (job &j : jobs)
+    {
+      if (s % j.everyS)
+        continue;
+      heapJob = heapCounting ? &j.allocs : NULL;
+      j.run();
+      heapJob = NULL;
+      j.runs += heapCounting;
+    }
+    hostAdvance(1000000);
+  }
+  heapCounting = false;
+
+  uint64_t total = heapOther;
+  printf("%-30s %9s %12s %9s\n", "", "runs", "allocations", "per run");
+  for (const job &j : jobs)
+  {
+    printf("%-30s %9llu %12llu %9.3f\n", j.name, (unsigned long long)j.runs, (unsigned long long)j.allocs, j.runs ? (double)j.allocs / j.runs : 0.0);
+    total += j.allocs;
+  }
+  printf("%-30s %9s %12llu\n", "serial and data log tasks", "", (unsigned long long)heapOther.load());
+  printf("%d days after a %d s warm-up, data log %u of %u sectors free, %lu records dropped\n", days, WARMUP_S, flogFree(logStore),
+         logStore.sectors, (unsigned long)logDropped);
+
+  if (total)
+    printf("%llu allocations in the steady state\n", (unsigned long long)total);
+  return total ? 1 : 0;
+}
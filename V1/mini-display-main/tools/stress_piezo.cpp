@@ -0,0 +1,380 @@
+/*
+Fires thousands of piezo commands from several threads at once into the playback service
+(piezo.h) running on its own task, and checks what comes out of the buzzer against what the
+sequencer says should.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src stress_piezo.cpp -o stress_piezo
+
+Usage:
+  stress_piezo [threads] [commands per thread]
+
+piezoService() runs on its task through the host rtos shim, piezoSend() is called from the
+threads like from the web server, loop() and the alarm code, and this thread plays the
+esp_timer task: it moves the simulated clock a ms at a time and runs piezoTick() when it's
+due. Every tone written to the LEDC is kept with its time. The checks:
+- duplicates coalesce: a song asked for again while it plays isn't restarted, its notes come
+  out exactly as one uninterrupted play
+- previews never cut into a PIEZO_LOOP: while an alarm rings, previews from every thread leave
+  it ringing, note for note
+- a command taken off the queue is never invisible to piezoSend(): STOP and then straight away
+  a PREVIEW, or the same LOOP again, has to end up playing. the service is stalled right after
+  each dequeue (hostReceiveHook) to hold that window open
+- the queue stays bounded and drains: never more than PIEZO_QUEUE_LEN waiting, empty soon
+  after the senders stop
+- STOP latency: during random traffic (bad song numbers too), with the clock standing still,
+  a STOP never waits behind more than the command the service already took (it acts on at
+  most two before the buzzer goes quiet), and the real time it takes stays under
+  STOP_LIMIT_US. that figure is mostly the PC's scheduler, the count is what the badge does
+Exits with 1 if a check fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "serlog.h"
+#include "power.h"
+#include "piezo.h"
+
+#define STOP_LIMIT_US 100000 // real time a STOP may take to silence the buzzer, scheduler jitter included
+#define DRAIN_LIMIT_MS 50   // real time the queue may take to empty once the senders stop
+#define WINDOW_ROUNDS 200
+
+typedef std::chrono::steady_clock clk;
+
+int checks, failures;
+
+void check(const char *what, bool ok)
+{
+  checks++;
+  if (!ok)
+  {
+    failures++;
+    printf("FAIL %s\n", what);
+  }
+}
+
+// ------------------------------------------ THE BUZZER ------------------------------------------
+
+typedef struct
+{
+  int64_t us;
+  uint32_t freq;
+} tone;
+
+std::mutex toneLock;
+std::vector<tone> tones;
+std::atomic<uint32_t> lastFreq;
+
+void toneHook(uint8_t channel, uint32_t freq)
+{
+  std::lock_guard<std::mutex> l(toneLock);
+  tones.push_back({esp_timer_get_time(), freq});
+  lastFreq = freq;
+}
+
+// what came out from us on until until: the last tone written at each time
+std::vector<tone> heard(int64_t from, int64_t until)
+{
+  std::lock_guard<std::mutex> l(toneLock);
+  std::vector<tone> out;
+  for (const tone &t : tones)
+  {
+    if (t.us < from || t.us >= until)
+      continue;
+    if (!out.empty() && out.back().us == t.us)
+      out.back() = t;
+    else
+      out.push_back(t);
+  }
+  return out;
+}
+
+// what the sequencer says song should sound like from us on, until until
+std::vector<tone> expected(int song, bool loop, int64_t us, int64_t until)
+{
+  sequencer seq;
+  tablecursor cursor;
+  seqStart(seq, tableSource(cursor, songs[song - 1]), loop, PIEZO_LOOP_GAP);
+  std::vector<tone> out;
+  uint16_t freq;
+  uint32_t ms;
+  while (us < until)
+  {
+    seqFill(seq);
+    if (!seqStep(seq, freq, ms))
+    {
+      out.push_back({us, 0});
+      break;
+    }
+    out.push_back({us, freq});
+    us += (int64_t)ms * 1000;
+  }
+  return out;
+}
+
+size_t tonesWritten()
+{
+  std::lock_guard<std::mutex> l(toneLock);
+  return tones.size();
+}
+
+// piezoStart() silences the buzzer before anything else, and with the clock standing still
+// no song runs out, so every 0 written is a command the service acted on
+uint32_t startsSince(size_t from)
+{
+  std::lock_guard<std::mutex> l(toneLock);
+  uint32_t n = 0;
+  for (size_t i = from; i < tones.size(); i++)
+    n += tones[i].freq == 0;
+  return n;
+}
+
+bool sameTones(const std::vector<tone> &a, const std::vector<tone> &b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].us != b[i].us || a[i].freq != b[i].freq)
+      return false;
+  return true;
+}
+
+// ------------------------------------------ THE CLOCK ------------------------------------------
+
+bool serviceBusy()
+{
+  std::lock_guard<std::mutex> l(piezoTask->m);
+  return piezoTask->notified != 0 || uxQueueMessagesWaiting(piezoQueue) != 0;
+}
+
+// waits for the service to have taken and acted on everything sent so far
+void settle()
+{
+  for (int quiet = 0; quiet < 3;)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    quiet = serviceBusy() ? 0 : quiet + 1;
+  }
+}
+
+// a ms of the esp_timer task. the service sits above the threads on the badge, so it gets to
+// run before time goes on
+void tick()
+{
+  hostAdvance(1000);
+  for (int i = 0; i < 100 && serviceBusy(); i++)
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+void run(int ms)
+{
+  for (int i = 0; i < ms; i++)
+    tick();
+}
+
+int64_t nowUs() { return esp_timer_get_time(); }
+
+// ------------------------------------------ THE SENDERS ------------------------------------------
+
+uint32_t threads, perThread;
+
+template <typename F>
+void spam(F send, bool clockRuns, uint32_t &maxQueued)
+{
+  std::atomic<uint32_t> done(0);
+  std::vector<std::thread> senders;
+  for (uint32_t t = 0; t < threads; t++)
+    senders.emplace_back([&, t]
+                         {
+      for (uint32_t i = 0; i < perThread; i++)
+      {
+        send(t, i);
+        if (i % 16 == 0)
+          std::this_thread::yield();
+      }
+      done++; });
+  while (done < threads)
+  {
+    maxQueued = max(maxQueued, (uint32_t)uxQueueMessagesWaiting(piezoQueue));
+    if (clockRuns)
+      tick();
+    else
+      std::this_thread::yield();
+  }
+  for (std::thread &s : senders)
+    s.join();
+}
+
+bool playing(uint8_t cmd, int song)
+{
+  xSemaphoreTake(piezoLock, portMAX_DELAY);
+  bool ok = piezoActive && piezoNow.cmd == cmd && piezoNow.song == song;
+  xSemaphoreGive(piezoLock);
+  return ok;
+}
+
+void stallAfterDequeue(QueueHandle_t q)
+{
+  if (q == piezoQueue)
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+int main(int argc, char **argv)
+{
+  threads = argc > 1 ? atoi(argv[1]) : 8;
+  perThread = argc > 2 ? atoi(argv[2]) : 2000;
+  Serial.muted = true;
+  hostToneHook = toneHook;
+  slogBegin();
+  piezoBegin();
+  settle();
+  uint32_t maxQueued = 0;
+  char what[96];
+
+  // a song number that only fits after narrowing never gets queued
+  piezoPlay(CUSTOM_SONG_BASE + 1 + 256);
+  check("song 267 isn't queued", uxQueueMessagesWaiting(piezoQueue) == 0);
+
+  // duplicates: song 1 asked for again and again while it plays. the clock stands still for
+  // them, or the song would end under the senders and rightly start again
+  piezoPlay(1);
+  settle();
+  int64_t start = nowUs();
+  run(100);
+  spam([](uint32_t, uint32_t)
+       { piezoPlay(1); }, false, maxQueued);
+  settle();
+  run(4000);
+  int64_t end = nowUs();
+  std::vector<tone> want = expected(1, false, start, end);
+  check("song 1 asked for from every thread plays once, uninterrupted", sameTones(heard(start, end), want));
+  snprintf(what, sizeof(what), "%u requests for song 1 while it played", threads * perThread);
+  printf("%-52s %zu notes, as one play\n", what, want.size() - 1);
+
+  // previews while an alarm rings
+  piezoLoopSong(2);
+  settle();
+  start = nowUs();
+  bool ringing = true;
+  spam([&](uint32_t t, uint32_t i)
+       {
+    static const int previews[] = {1, 2, 3, CUSTOM_SONG_BASE + 1};
+    piezoPreview(previews[(t + i) % 4]);
+    if (!playing(PIEZO_LOOP, 2))
+      ringing = false; }, true, maxQueued);
+  settle();
+  run(2000);
+  end = nowUs();
+  want = expected(2, true, start, end);
+  check("the alarm rang all through the previews", ringing && playing(PIEZO_LOOP, 2));
+  check("and note for note, repeats and gaps included", sameTones(heard(start, end), want));
+  snprintf(what, sizeof(what), "%u previews while song 2 rang", threads * perThread);
+  printf("%-52s %zu notes, none cut\n", what, want.size());
+
+  // the window between taking a command off the queue and publishing it
+  hostReceiveHook = stallAfterDequeue;
+  int lostPreviews = 0, lostLoops = 0;
+  for (int r = 0; r < WINDOW_ROUNDS; r++)
+  {
+    piezoLoopSong(3);
+    settle();
+    run(50);
+    piezoStop();
+    while (uxQueueMessagesWaiting(piezoQueue))
+      std::this_thread::yield(); // taken, not acted on yet
+    if (r % 2)
+      piezoPreview(1);
+    else
+      piezoLoopSong(3);
+    settle();
+    if (r % 2)
+      lostPreviews += !playing(PIEZO_PREVIEW, 1);
+    else
+      lostLoops += !playing(PIEZO_LOOP, 3);
+    run(10);
+  }
+  hostReceiveHook = NULL;
+  check("a PREVIEW right after STOP of an alarm always plays", !lostPreviews);
+  check("the same LOOP right after STOP always rings again", !lostLoops);
+  printf("%-52s %d previews, %d loops lost of %d each\n", "STOP, then a command as soon as it's dequeued", lostPreviews,
+         lostLoops, WINDOW_ROUNDS / 2);
+
+  // random traffic (bad song numbers too), and every so often the senders hold still and a
+  // STOP goes in
+  std::atomic<bool> paused(false);
+  std::atomic<uint32_t> sent(0), parked(0), finished(0);
+  std::vector<std::thread> senders;
+  for (uint32_t t = 0; t < threads; t++)
+    senders.emplace_back([&, t]
+                         {
+      static const int songNumbers[] = {1, 2, 3, 0, 4, CUSTOM_SONG_BASE + 1, CUSTOM_SONG_BASE + 1 + 256, -5};
+      for (uint32_t i = 0; i < perThread; i++)
+      {
+        if (paused)
+        {
+          parked++;
+          while (paused)
+            std::this_thread::sleep_for(std::chrono::microseconds(100)); // out of the service's way
+          parked--;
+        }
+        uint32_t r = (t * 2654435761u) ^ (i * 40503u);
+        piezoSend(r % 4, songNumbers[(r >> 3) % 8]);
+        sent++;
+        if (i % 16 == 0)
+          std::this_thread::yield();
+      }
+      finished++; });
+  double worstStopUs = 0;
+  uint32_t stops = 0, nextStop = 0, worstStarts = 0;
+  while (finished < threads)
+  {
+    maxQueued = max(maxQueued, (uint32_t)uxQueueMessagesWaiting(piezoQueue));
+    if (sent < nextStop)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    nextStop += max(1u, threads * perThread / 50);
+    paused = true;
+    while (parked + finished < threads)
+      std::this_thread::yield();
+    size_t from = tonesWritten();
+    clk::time_point t = clk::now();
+    piezoStop();
+    double us = 0;
+    while ((serviceBusy() || lastFreq != 0 || piezoActive) && us < 10 * STOP_LIMIT_US) // a lost STOP fails, not hangs
+    {
+      std::this_thread::yield();
+      us = std::chrono::duration<double, std::micro>(clk::now() - t).count();
+    }
+    worstStopUs = max(worstStopUs, us);
+    worstStarts = max(worstStarts, startsSince(from));
+    stops++;
+    paused = false;
+  }
+  for (std::thread &s : senders)
+    s.join();
+
+  clk::time_point t = clk::now();
+  piezoStop();
+  settle();
+  double drainMs = std::chrono::duration<double, std::milli>(clk::now() - t).count();
+  check("silent after the last STOP", lastFreq == 0 && !piezoActive && playing(PIEZO_STOP, 0) == false);
+  check("the queue never held more than PIEZO_QUEUE_LEN", maxQueued <= PIEZO_QUEUE_LEN);
+  check("and it drains once the senders stop", drainMs < DRAIN_LIMIT_MS && !uxQueueMessagesWaiting(piezoQueue));
+  snprintf(what, sizeof(what), "%u random commands", threads * perThread);
+  printf("%-52s %u STOPs, slowest %.0f us to silence, at most %u starts\n", what, stops, worstStopUs, worstStarts);
+  check("no STOP waited behind more than the command already taken", worstStarts <= 2);
+  check("every STOP silenced the buzzer within STOP_LIMIT_US", worstStopUs <= STOP_LIMIT_US);
+
+  printf("%u threads, queue at most %u of %u, %d of %d checks passed\n", threads, maxQueued, PIEZO_QUEUE_LEN,
+         checks - failures, checks);
+  return failures ? 1 : 0;
+}
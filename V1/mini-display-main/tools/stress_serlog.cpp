@@ -0,0 +1,248 @@
+/*
+Hammers the serial log's ring (serlog.h) from several threads at once and checks every line
+that comes out of the drain task, then times a log call against formatting and printing the
+line on the spot like the firmware did before.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src stress_serlog.cpp -o stress_serlog
+
+Usage:
+  stress_serlog [threads] [lines per thread]
+
+The stress runs twice, once with the producers flat out (the ring fills and drops lines) and
+once paced. Each line carries its thread, its number and two strings of up to 70 and 40
+characters made from them, so the checker knows what it should say, what SLOG_TEXT leaves of
+the strings and where the '~' goes. A line has to come out whole, at most once, in the order
+its thread wrote it, and the lines printed plus the drops the drain task reports have to add
+up to the lines written. The threads only race where the scheduler preempts them on a single
+core, so run it on a PC with a few.
+
+The timing is on this thread alone, without the drain task: SLOGI() calls in batches that fit
+the ring, then slogDrainOne() on the same lines, then snprintf() and a write to a muted Serial
+for the old way (the UART at 115200 baud blocked another ~87 us a byte on top). Exits with 1
+if a line is torn, wrong, repeated, out of order or missing.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include "serlog.h"
+
+#define MAX_THREADS 16
+#define BATCH 32 // fits the ring, so the timed calls don't drop
+#define BENCH_LINES 200000
+
+typedef std::chrono::steady_clock clk;
+
+double nsSince(clk::time_point t) { return std::chrono::duration<double, std::nano>(clk::now() - t).count(); }
+
+// the strings line i of thread t carries
+void lineStrings(uint32_t t, uint32_t i, std::string &a, std::string &b)
+{
+  a.assign((i * 7 + t) % 71, 'a' + (i + t) % 26);
+  b.assign((i * 13 + t * 5) % 41, 'A' + (i * 3 + t) % 26);
+  for (size_t k = 0; k < a.size(); k++)
+    a[k] = 'a' + (i + t + k) % 26;
+}
+
+// what the slot's SLOG_TEXT bytes leave of them
+void lineExpected(std::string &a, std::string &b)
+{
+  const size_t room = SLOG_TEXT - 1;
+  size_t used;
+  if (a.size() < room)
+    used = a.size() + 1;
+  else
+  {
+    if (a.size() > room)
+      a = a.substr(0, room - 1) + '~';
+    used = room;
+  }
+  if (b.size() && used == room)
+    b = "~";
+  else if (b.size() > room - used)
+    b = b.substr(0, room - used - 1) + '~';
+}
+
+// ------------------------------------------ CHECKING ------------------------------------------
+
+uint32_t threads, linesPer;
+std::vector<int64_t> lastSeen; // per thread, the last line number printed
+std::vector<std::vector<bool>> seen;
+std::string partial;
+uint64_t printed, dropped, bad;
+
+void badLine(const char *why, const std::string &line)
+{
+  if (bad++ < 10)
+    printf("FAIL %s: %s\n", why, line.c_str());
+}
+
+void checkLine(const std::string &line)
+{
+  unsigned long n;
+  if (sscanf(line.c_str(), "[LOG] %lu lines dropped", &n) == 1)
+  {
+    dropped += n;
+    return;
+  }
+  unsigned t, i, sum;
+  size_t a0 = line.find('<'), a1 = line.find('>', a0 + 1), b0 = line.find('<', a1 + 1), b1 = line.find('>', b0 + 1);
+  if (sscanf(line.c_str(), "[T%u] %u <", &t, &i) != 2 || b1 == std::string::npos ||
+      sscanf(line.c_str() + b1 + 1, " #%u", &sum) != 1)
+    return badLine("torn", line);
+  if (t >= threads || i >= linesPer || sum != t * 1000003u + i)
+    return badLine("wrong numbers", line);
+  std::string a, b;
+  lineStrings(t, i, a, b);
+  lineExpected(a, b);
+  if (line.compare(a0 + 1, a1 - a0 - 1, a) || line.compare(b0 + 1, b1 - b0 - 1, b))
+    return badLine("wrong strings", line);
+  if (seen[t][i])
+    return badLine("printed twice", line);
+  if ((int64_t)i <= lastSeen[t])
+    return badLine("out of order", line);
+  seen[t][i] = true;
+  lastSeen[t] = i;
+  printed++;
+}
+
+// the drain task's writes, a line at a time
+void serialHook(const char *s, size_t n)
+{
+  partial.append(s, n);
+  size_t end;
+  while ((end = partial.find("\r\n")) != std::string::npos)
+  {
+    checkLine(partial.substr(0, end));
+    partial.erase(0, end + 2);
+  }
+}
+
+void producer(uint32_t t, bool paced)
+{
+  std::string a, b;
+  for (uint32_t i = 0; i < linesPer; i++)
+  {
+    lineStrings(t, i, a, b);
+    char sa[80], sb[48]; // on the stack like the firmware's, gone before the drain formats them
+    strcpy(sa, a.c_str());
+    strcpy(sb, b.c_str());
+    SLOGI("[T%u] %u <%s> <%s> #%u", t, i, sa, sb, t * 1000003u + i);
+    if (paced)
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    else if (i % 64 == 0)
+      std::this_thread::yield();
+  }
+}
+
+// everything written is out and the drain task has reported its drops
+void waitIdle()
+{
+  while (slogTail != slogHead.load() || slogDropped.load() || !slogWaiting.load())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+bool stress(bool paced)
+{
+  lastSeen.assign(threads, -1);
+  seen.assign(threads, std::vector<bool>(linesPer));
+  printed = dropped = bad = 0;
+  partial.clear();
+
+  clk::time_point start = clk::now();
+  std::vector<std::thread> producers;
+  for (uint32_t t = 0; t < threads; t++)
+    producers.emplace_back(producer, t, paced);
+  for (std::thread &p : producers)
+    p.join();
+  waitIdle();
+  double s = nsSince(start) / 1e9;
+
+  uint64_t written = (uint64_t)threads * linesPer;
+  bool ok = !bad && partial.empty() && printed + dropped == written;
+  printf("%-10s %8llu %8llu %8llu %6llu %9.0f%s\n", paced ? "paced" : "flat out", (unsigned long long)written,
+         (unsigned long long)printed, (unsigned long long)dropped, (unsigned long long)bad, printed / s, ok ? "" : "  FAIL");
+  if (printed + dropped != written)
+    printf("FAIL %llu lines neither printed nor reported dropped\n", (unsigned long long)(written - printed - dropped));
+  return ok;
+}
+
+// ------------------------------------------ TIMING ------------------------------------------
+
+void bench(const char *name, void (*write)(uint32_t), int (*old)(char *, uint32_t))
+{
+  double callNs = 0, drainNs = 0, oldNs = 0;
+  size_t bytes = 0;
+  char line[SLOG_LINE];
+  for (uint32_t n = 0; n < BENCH_LINES; n += BATCH)
+  {
+    clk::time_point t = clk::now();
+    for (uint32_t i = 0; i < BATCH; i++)
+      write(n + i);
+    callNs += nsSince(t);
+
+    t = clk::now();
+    while (slogDrainOne())
+      ;
+    drainNs += nsSince(t);
+
+    t = clk::now();
+    for (uint32_t i = 0; i < BATCH; i++)
+    {
+      int len = old(line, n + i);
+      Serial.write((const uint8_t *)line, len);
+      bytes += len + 2;
+    }
+    oldNs += nsSince(t);
+  }
+  printf("%-30s %8.0f %8.0f %8.0f %9.0f us\n", name, callNs / BENCH_LINES, drainNs / BENCH_LINES, oldNs / BENCH_LINES,
+         (double)bytes / BENCH_LINES * 1e6 / 11520);
+}
+
+void writeInts(uint32_t i) { SLOGI("[CODE] Pressure: %u  Humidity: %u%%  Line: %u", 1009u, 83u, i); }
+
+int oldInts(char *line, uint32_t i) { return snprintf(line, SLOG_LINE, "[CODE] Pressure: %u  Humidity: %u%%  Line: %u", 1009u, 83u, i); }
+
+char weatherMain[16] = "Thunderstorm", weatherDesc[48] = "thunderstorm with heavy rain";
+
+void writeStrings(uint32_t i) { SLOGI("[CODE] Weather: %s (%s, %u)", weatherMain, weatherDesc, i); }
+
+int oldStrings(char *line, uint32_t i) { return snprintf(line, SLOG_LINE, "[CODE] Weather: %s (%s, %u)", weatherMain, weatherDesc, i); }
+
+int main(int argc, char **argv)
+{
+  threads = argc > 1 ? atoi(argv[1]) : 4;
+  linesPer = argc > 2 ? atoi(argv[2]) : 50000;
+  if (threads < 1 || threads > MAX_THREADS)
+    threads = 4;
+  Serial.muted = true;
+
+  // timing first, with the ring set up by hand and drained on this thread
+  for (uint32_t i = 0; i < SLOG_SLOTS; i++)
+    slogRing[i].seq.store(i);
+  printf("%-30s %8s %8s %8s %10s\n", "ns per line", "SLOGI()", "drain", "old way", "old UART");
+  bench("three integers", writeInts, oldInts);
+  bench("two strings (the weather)", writeStrings, oldStrings);
+  printf("drain: slogDrainOne() formatting and writing it, old way: snprintf() and the write, old UART: the\n"
+         "bytes at 115200 baud that also blocked the caller\n\n");
+
+  slogHead = 0;
+  slogTail = 0;
+  hostSerialHook = serialHook;
+  slogBegin();
+  printf("%-10s %8s %8s %8s %6s %9s\n", "", "written", "printed", "dropped", "bad", "lines/s");
+  bool ok = stress(false);
+  ok = stress(true) && ok;
+  printf("%u threads on %u cores, %u lines each, SLOG_SLOTS %u, SLOG_TEXT %u\n", threads, std::thread::hardware_concurrency(),
+         linesPer, SLOG_SLOTS, SLOG_TEXT);
+  if (!ok)
+    printf("checks failed\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+Runs the DHT22 frame decoder (dhtdecode.h) over pulse traces on a PC: good frames, frames with a
+bad checksum, truncated frames and the sensor not answering, plus a sweep of frames with random
+pulse widths anywhere inside the datasheet's tolerances.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -I../src test_dhtdecode.cpp -o test_dhtdecode
+
+Usage:
+  test_dhtdecode               runs the checks, exits with 1 if any fails
+  test_dhtdecode trace.txt     decodes a recorded trace instead, one pulse per line: "<level> <us>",
+                               e.g. dumped from dhtRMTRead()'s pulses[] or a logic analyser
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "dhtdecode.h"
+
+typedef std::vector<dhtpulse> trace;
+
+const char *statusName(uint8_t s)
+{
+  static const char *names[] = {"ok", "no response", "truncated", "timing", "checksum"};
+  return s < sizeof(names) / sizeof(names[0]) ? names[s] : "?";
+}
+
+int jitter(int us, int spread) { return us - spread + rand() % (2 * spread + 1); }
+
+// what the RMT records for a frame of these 5 bytes: our start pulse, the sensor's response,
+// 40 bits and the end. spread is how far each width may wander from nominal
+trace encode(const uint8_t *bytes, int spread = 0)
+{
+  trace t;
+  t.push_back({0, 2000}); // our start pulse
+  t.push_back({1, (uint16_t)jitter(30, spread / 2)});
+  t.push_back({0, (uint16_t)jitter(80, spread)});
+  t.push_back({1, (uint16_t)jitter(80, spread)});
+  for (int bit = 0; bit < DHT_BITS; bit++)
+  {
+    bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+    t.push_back({0, (uint16_t)jitter(50, spread)});
+    t.push_back({1, (uint16_t)jitter(one ? 70 : 27, one ? spread : spread / 2)});
+  }
+  t.push_back({0, (uint16_t)jitter(50, spread)});
+  return t;
+}
+
+void frameBytes(uint16_t hum10, int16_t temp10, uint8_t *b)
+{
+  uint16_t t = temp10 < 0 ? (uint16_t)(-temp10) | 0x8000 : temp10;
+  b[0] = hum10 >> 8;
+  b[1] = hum10 & 0xff;
+  b[2] = t >> 8;
+  b[3] = t & 0xff;
+  b[4] = b[0] + b[1] + b[2] + b[3];
+}
+
+int failures = 0, checks = 0;
+
+void expect(const char *what, const trace &t, uint8_t status, uint16_t hum10 = 0, int16_t temp10 = 0)
+{
+  checks++;
+  dhtframe f = dhtDecode(t.data(), t.size());
+  bool ok = f.status == status && (status != DHT_DECODE_OK || (f.hum10 == hum10 && f.temp10 == temp10));
+  if (!ok)
+  {
+    printf("FAIL %s: got %s %u/%d, want %s %u/%d\n", what, statusName(f.status), f.hum10, f.temp10,
+           statusName(status), hum10, temp10);
+    failures++;
+  }
+}
+
+// every width shifted the same way, like a long cable's slow rising edges: lows read short
+// and highs read long
+trace skew(trace t, int low, int high)
+{
+  for (dhtpulse &p : t)
+    p.us += p.level ? high : low;
+  return t;
+}
+
+int runChecks()
+{
+  uint8_t b[5];
+
+  frameBytes(652, 351, b);
+  expect("clean frame", encode(b), DHT_DECODE_OK, 652, 351);
+  frameBytes(1000, 0, b);
+  expect("100 % at 0 C", encode(b), DHT_DECODE_OK, 1000, 0);
+  frameBytes(203, -101, b);
+  expect("below freezing", encode(b), DHT_DECODE_OK, 203, -101);
+  frameBytes(0, -400, b);
+  expect("sensor minimum", encode(b), DHT_DECODE_OK, 0, -400);
+  frameBytes(613, 246, b);
+  expect("slow edges", skew(encode(b), -15, 12), DHT_DECODE_OK, 613, 246);
+
+  // checksum errors
+  frameBytes(652, 351, b);
+  b[4] ^= 1;
+  expect("checksum byte off by one", encode(b), DHT_DECODE_CHECKSUM);
+  frameBytes(652, 351, b);
+  trace t = encode(b);
+  t[4 + 2 * 9 + 1].us = 70; // bit 9 is a 0, read as a 1
+  expect("a data bit flipped", t, DHT_DECODE_CHECKSUM);
+  frameBytes(652, 351, b);
+  b[0] ^= 0x10;
+  b[1] ^= 0x10; // the checksum is still the one of the bytes before
+  expect("two data bits flipped", encode(b), DHT_DECODE_CHECKSUM);
+
+  // truncated frames, cut at every pulse from the response on
+  frameBytes(652, 351, b);
+  trace full = encode(b);
+  for (size_t cut = 4; cut < 4 + 2 * DHT_BITS; cut++)
+  {
+    char what[40];
+    sprintf(what, "cut after %zu pulses", cut);
+    expect(what, trace(full.begin(), full.begin() + cut), DHT_DECODE_TRUNCATED);
+  }
+  trace noEnd(full.begin(), full.end() - 1);
+  expect("no end pulse", noEnd, DHT_DECODE_OK, 652, 351);
+
+  // no answer
+  expect("empty capture", trace(), DHT_DECODE_NO_RESPONSE);
+  expect("only our start pulse", trace(full.begin(), full.begin() + 2), DHT_DECODE_NO_RESPONSE);
+  trace slow = full;
+  slow[2].us = 150;
+  slow[3].us = 150;
+  expect("response far too long", trace(slow.begin(), slow.begin() + 4), DHT_DECODE_NO_RESPONSE);
+
+  // timing
+  trace glitch = full;
+  glitch[4 + 2 * 20 + 1].us = 150;
+  expect("high pulse too long", glitch, DHT_DECODE_TIMING);
+  glitch = full;
+  glitch[4 + 2 * 7].us = 5;
+  expect("low pulse too short", glitch, DHT_DECODE_TIMING);
+
+  // random readings with random widths inside the tolerances still decode
+  srand(1);
+  for (int i = 0; i < 10000; i++)
+  {
+    uint16_t hum = rand() % 1001;
+    int16_t temp = rand() % 1201 - 400;
+    frameBytes(hum, temp, b);
+    expect("jittered frame", encode(b, 15), DHT_DECODE_OK, hum, temp);
+  }
+
+  printf("%d of %d checks passed\n", checks - failures, checks);
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+    return runChecks();
+
+  FILE *f = fopen(argv[1], "r");
+  if (!f)
+  {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 2;
+  }
+  trace t;
+  unsigned level, us;
+  while (fscanf(f, "%u %u", &level, &us) == 2)
+    t.push_back({(uint8_t)level, (uint16_t)us});
+  fclose(f);
+
+  dhtframe fr = dhtDecode(t.data(), t.size());
+  printf("%zu pulses: %s, bytes %02x %02x %02x %02x %02x", t.size(), statusName(fr.status), fr.bytes[0], fr.bytes[1],
+         fr.bytes[2], fr.bytes[3], fr.bytes[4]);
+  if (fr.status == DHT_DECODE_OK)
+    printf(", %d.%d %% %s%d.%d C", fr.hum10 / 10, fr.hum10 % 10, fr.temp10 < 0 ? "-" : "", abs(fr.temp10) / 10,
+           abs(fr.temp10) % 10);
+  printf("\n");
+  return fr.status == DHT_DECODE_OK ? 0 : 1;
+}
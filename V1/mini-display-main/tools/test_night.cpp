@@ -0,0 +1,169 @@
+/*
+Checks night mode's state (night.h) on a PC: what it keeps in NVS and how big that is, that a
+restart comes back with the same window and goes dark again straight away, and the rules
+that decide when it's dark: the window across midnight, alarms, songs, the button.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src test_night.cpp -o test_night
+
+Usage:
+  test_night
+
+Night mode light-sleeps rather than deep-sleeps (the button on GPIO5 can't wake deep sleep),
+so RAM survives the night and the only state it saves is the window. Everything else is
+worked out again from the clock on every loop() pass, which is what the restart checks rely
+on. How fast a press gets the screen back from light sleep is in sim_power. Exits with 1 if a
+check fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+
+// what night.h needs of history.h
+#define HIST_VALID_AFTER 1672531200UL
+
+#include "night.h"
+
+#define NOW 1767268800L // 2026-01-01 12:00 UTC
+
+int checks, failures;
+
+void check(const char *what, bool ok)
+{
+  checks++;
+  if (!ok)
+  {
+    failures++;
+    printf("FAIL %s\n", what);
+  }
+}
+
+tm at(int hour, int minute)
+{
+  tm t = {};
+  t.tm_hour = hour;
+  t.tm_min = minute;
+  return t;
+}
+
+// the badge restarting: RAM is gone, NVS stays
+void restart()
+{
+  nightWindow = {0, 0};
+  nightActive = false;
+  nightAwakeMillis = 0;
+  nightBegin();
+}
+
+// one loop() pass of nightStep()
+bool pass(const tm &t, time_t utc, time_t alarm, bool playing, bool &button)
+{
+  nightActive = nightDark(t, utc, alarm, playing, button);
+  return nightActive;
+}
+
+int main()
+{
+  hostSimulate();
+  hostClock.trueUs = hostClock.sysUs = (int64_t)NOW * 1000000;
+  hostAdvance(1000000); // millis() 0 means no press in nightAwakeMillis
+  Preferences nvs;
+  nvs.begin("night", true);
+  bool button = false;
+
+  // what's saved, and that it comes back
+  printf("saved state: %zu bytes (nightwindow), key \"window\" in namespace \"night\"\n", sizeof(nightwindow));
+  check("the window is 4 bytes", sizeof(nightwindow) == 4);
+  restart();
+  check("nothing saved is off", nightWindow.start == nightWindow.end);
+  check("23:00-07:00 parses", nightSet("23:00-07:00"));
+  check("it's saved", nvs.getBytesLength("window") == sizeof(nightwindow));
+  restart();
+  check("it comes back after a restart", nightWindow.start == 23 * 60 && nightWindow.end == 7 * 60);
+  char hhmm[8];
+  nightFormat(hhmm, nightWindow.start);
+  check("start shows as 23:00", !strcmp(hhmm, "23:00"));
+
+  // bad times change nothing, in RAM or NVS
+  const char *bad[] = {"24:00-07:00", "23:60-07:00", "23:00-07:60", "23:00", "23:00-", "night", "-1:00-07:00"};
+  for (const char *b : bad)
+  {
+    char what[48];
+    snprintf(what, sizeof(what), "\"%s\" is refused", b);
+    check(what, !nightSet(b));
+  }
+  restart();
+  check("refused times leave the saved window alone", nightWindow.start == 23 * 60 && nightWindow.end == 7 * 60);
+
+  // a blob of another size (an older or newer build) is ignored, not half read
+  uint8_t old[2] = {0x11, 0x22};
+  nvs.putBytes("window", old, sizeof(old));
+  restart();
+  check("a saved window of the wrong size is ignored", nightWindow.start == 0 && nightWindow.end == 0);
+  check("\"\" parses", nightSet(""));
+  restart();
+  nightFormat(hhmm, nightWindow.start);
+  check("off shows as nothing", !*hhmm);
+
+  // the window, across midnight and within a day
+  nightSet("23:00-07:00");
+  check("22:59 is outside", !nightIn(at(22, 59)));
+  check("23:00 is inside", nightIn(at(23, 0)));
+  check("00:00 is inside", nightIn(at(0, 0)));
+  check("06:59 is inside", nightIn(at(6, 59)));
+  check("07:00 is outside", !nightIn(at(7, 0)));
+  nightSet("13:00-14:30");
+  check("12:59 is outside", !nightIn(at(12, 59)));
+  check("13:00 is inside", nightIn(at(13, 0)));
+  check("14:29 is inside", nightIn(at(14, 29)));
+  check("14:30 is outside", !nightIn(at(14, 30)));
+  nightSet("05:00-05:00");
+  bool never = true;
+  for (int m = 0; m < 1440; m++)
+    never = never && !nightIn(at(m / 60, m % 60));
+  check("start == end is never inside", never);
+
+  // a restart in the middle of the night goes dark on the first pass, outside it doesn't
+  nightSet("23:00-07:00");
+  restart();
+  check("restart at 03:00 is dark at once", pass(at(3, 0), NOW, 0, false, button));
+  restart();
+  check("restart at 12:00 stays up", !pass(at(12, 0), NOW, 0, false, button));
+
+  // what keeps it up inside the window
+  restart();
+  check("clock not set yet stays up", !pass(at(3, 0), HIST_VALID_AFTER - 1, 0, false, button));
+  check("a song playing stays up", !pass(at(3, 0), NOW, 0, true, button));
+  check("an alarm in NIGHT_ALARM_LEAD s stays up", !pass(at(3, 0), NOW, NOW + NIGHT_ALARM_LEAD, false, button));
+  check("an alarm a second later goes dark", pass(at(3, 0), NOW, NOW + NIGHT_ALARM_LEAD + 1, false, button));
+
+  // the button: wakes the screen for NIGHT_AWAKE_MS, and is used up doing it
+  button = true;
+  check("a press at night wakes it", !pass(at(3, 0), NOW, 0, false, button));
+  check("the press is used up", !button);
+  hostAdvance(NIGHT_AWAKE_MS * 1000LL);
+  check("still up NIGHT_AWAKE_MS later", !pass(at(3, 1), NOW, 0, false, button));
+  button = true;
+  check("a press while up keeps it up", !pass(at(3, 1), NOW, 0, false, button));
+  check("and is left for loop()", button);
+  button = false;
+  hostAdvance(NIGHT_AWAKE_MS * 1000LL + 1000);
+  check("dark again after NIGHT_AWAKE_MS", pass(at(3, 2), NOW, 0, false, button));
+  button = true;
+  check("a press outside the window isn't taken", !pass(at(12, 0), NOW, 0, false, button) && button);
+
+  // the sleep until the next minute
+  hostClock.sysUs = (int64_t)NOW * 1000000 + 59999000 - hostClock.monoUs;
+  uint32_t ms = nightMsToMinute();
+  check("1 ms before the minute sleeps 1 ms", ms == 1);
+  hostClock.sysUs = (int64_t)NOW * 1000000 + 60000000 - hostClock.monoUs;
+  ms = nightMsToMinute();
+  check("on the minute sleeps a whole minute", ms == 60000);
+
+  printf("%d of %d checks passed\n", checks - failures, checks);
+  return failures ? 1 : 0;
+}
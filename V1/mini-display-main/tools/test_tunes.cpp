@@ -0,0 +1,242 @@
+/*
+Uploads ringtones through the /tune handlers (tunestore.h) onto a fake SPIFFS, in every way
+a browser or curl can cut them into chunks, and checks what lands on flash and how it plays.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src test_tunes.cpp -o test_tunes
+
+Usage:
+  test_tunes [random splits per tune]
+
+Each tune goes up as RTTTL text and as a binary .tun (header and notes), in one chunk, a byte
+per chunk, with the first chunk 1 to 4 bytes long and in random splits. After each upload the
+answer has to be the new song number, /tunes/N.tun has to hold the header (magic, tempo, the
+name from the file name for RTTTL) and exactly the notes rtttlCompile() makes of the text or
+the binary carried, and playing it through fileSource() and the sequencer has to give the same
+timeline, note for note, as the same notes from a table. Broken uploads (a truncated binary, a
+bad tempo, a few stray bytes, text that isn't RTTTL) have to be refused with nothing left
+behind. Exits with 1 if a check fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "serlog.h"
+#include "sequencer.h"
+#include "songs.h"
+#include "tunestore.h"
+
+int checks, failures;
+
+bool check(const std::string &what, bool ok)
+{
+  checks++;
+  if (!ok && failures++ < 20)
+    printf("FAIL %s\n", what.c_str());
+  return ok;
+}
+
+// ------------------------------------------ TUNES ------------------------------------------
+
+typedef struct
+{
+  const char *filename;
+  std::string data;
+  std::string name;     // what the header should say
+  std::vector<note> notes;
+  uint16_t bpm;
+} upload;
+
+const char *ringtones[] = {
+    "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#,8c#6,8b,d,e,8b,8a,c#,e,2a",
+    "TUN:d=8,o=6,b=140:c,p,c,g5,2c,p,4d#.,d,c,16p,a#5,c,2p", // starts like the magic, one byte off
+    "Tetris:d=4,o=5,b=160:e6,8b,8c6,8d6,16e6,16d6,8c6,8b,a,8a,8c6,e6,8d6,8c6,b,8b,8c6,d6,e6,c6,a,2a,8p,d6,8f6,a6,8g6,8f6,e6,8e6,8c6,e6,8d6,8c6,b,8b,8c6,d6,e6,c6,a,a",
+    "a very long ringtone name:d=16,o=4,b=63:c,c#,d,d#,e,f,f#,g,g#,a,a#,b,c5,32p,2c7.",
+};
+
+upload rtttlUpload(const char *text, const char *filename)
+{
+  upload u;
+  u.filename = filename;
+  u.data = text;
+  std::string f = filename;
+  u.name = f.substr(0, f.rfind('.')).substr(0, TUNE_NAME_LEN);
+  u.notes.resize(TUNE_MAX_NOTES);
+  int n = rtttlCompile(text, u.notes.data(), u.notes.size(), u.bpm);
+  if (n <= 0)
+    printf("FAIL %s doesn't compile\n", filename);
+  u.notes.resize(n < 0 ? 0 : n);
+  return u;
+}
+
+upload binaryUpload(const tune &t, const char *name, const char *filename)
+{
+  upload u;
+  u.filename = filename;
+  u.name = name;
+  u.notes.assign(t.notes, t.notes + t.length);
+  u.bpm = t.bpm;
+  tuneheader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TUNE_MAGIC, 4);
+  h.bpm = t.bpm;
+  memcpy(h.name, name, min(strlen(name), (size_t)TUNE_NAME_LEN));
+  u.data.assign((const char *)&h, sizeof(h));
+  u.data.append((const char *)t.notes, t.length * sizeof(note));
+  return u;
+}
+
+// ------------------------------------------ UPLOADING ------------------------------------------
+
+// what the web server would do with a multipart body cut at cuts: one callback per chunk,
+// then the request handler. returns the status and fills in the answer
+int post(const std::string &filename, const std::string &data, const std::vector<size_t> &cuts, std::string &answer)
+{
+  AsyncWebServerRequest request;
+  std::vector<uint8_t> bytes(data.begin(), data.end());
+  size_t from = 0;
+  for (size_t i = 0; i <= cuts.size(); i++)
+  {
+    size_t to = i < cuts.size() ? cuts[i] : bytes.size();
+    handleTuneUpload(&request, String(filename.c_str()), from, bytes.data() + from, to - from, i == cuts.size());
+    from = to;
+  }
+  handleTuneDone(&request);
+  answer = request.body();
+  return request.sent() ? request.sent()->code : 0;
+}
+
+std::vector<size_t> cutsEvery(size_t n, size_t len)
+{
+  std::vector<size_t> cuts;
+  for (size_t at = n; at < len; at += n)
+    cuts.push_back(at);
+  return cuts;
+}
+
+std::vector<size_t> cutsRandom(size_t len)
+{
+  std::vector<size_t> cuts;
+  for (size_t at = 1 + rand() % 7; at < len; at += 1 + rand() % (rand() % 4 ? 9 : 200))
+    cuts.push_back(at);
+  return cuts;
+}
+
+// ------------------------------------------ PLAYING ------------------------------------------
+
+std::vector<noteevent> play(const notesource &src)
+{
+  sequencer seq;
+  seqStart(seq, src, false, 0);
+  std::vector<noteevent> events;
+  uint16_t freq;
+  uint32_t ms;
+  for (;;)
+  {
+    seqFill(seq);
+    if (!seqStep(seq, freq, ms))
+      return events;
+    events.push_back({freq, (uint16_t)ms});
+  }
+}
+
+bool sameTimeline(const std::vector<noteevent> &a, const std::vector<noteevent> &b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].freq != b[i].freq || a[i].ms != b[i].ms)
+      return false;
+  return true;
+}
+
+// uploads u cut at cuts and checks the file and how it plays
+void checkUpload(const upload &u, const std::vector<size_t> &cuts, const char *how)
+{
+  std::string what = std::string(u.filename) + ", " + how, answer;
+  int code = post(u.filename, u.data, cuts, answer);
+  if (!check(what + ": answered " + std::to_string(code) + " " + answer, code == 200 && answer == "11"))
+    return;
+
+  std::string file = *hostFiles[tunePath(1).c_str()];
+  tuneheader h;
+  memcpy(&h, file.data(), min(file.size(), sizeof(h)));
+  check(what + ": header", file.size() >= sizeof(h) && !memcmp(h.magic, TUNE_MAGIC, 4) && h.bpm == u.bpm &&
+                               std::string(h.name, strnlen(h.name, TUNE_NAME_LEN)) == u.name);
+  check(what + ": notes on flash", file.size() == sizeof(h) + u.notes.size() * sizeof(note) &&
+                                      !memcmp(file.data() + sizeof(h), u.notes.data(), u.notes.size() * sizeof(note)));
+  check(what + ": no upload left behind", !SPIFFS.exists(TUNE_UPLOAD_PATH));
+
+  filecursor fc;
+  notesource fromFile;
+  if (check(what + ": fileSource()", fileSource(fc, 1, fromFile)))
+  {
+    tune t = {u.notes.data(), (uint16_t)u.notes.size(), u.bpm};
+    tablecursor tc;
+    check(what + ": plays like its notes", sameTimeline(play(fromFile), play(tableSource(tc, t))));
+  }
+  fc.file.close();
+  deleteTune(1);
+}
+
+void checkRefused(const char *filename, const std::string &data, const char *why)
+{
+  std::vector<std::vector<size_t>> splits = {{}, cutsEvery(1, data.size()), cutsEvery(3, data.size())};
+  for (const std::vector<size_t> &cuts : splits)
+  {
+    std::string answer;
+    int code = post(filename, data, cuts, answer);
+    check(std::string(filename) + " refused with \"" + why + "\", not " + std::to_string(code) + " " + answer,
+          code == 400 && answer == why && hostFiles.empty());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int randomSplits = argc > 1 ? atoi(argv[1]) : 200;
+  Serial.muted = true;
+  srand(1);
+
+  std::vector<upload> uploads;
+  const char *rtttlFiles[] = {"nokia.txt", "tun.rtttl", "Tetris theme.txt", "a very long ringtone name"};
+  for (int i = 0; i < 4; i++)
+    uploads.push_back(rtttlUpload(ringtones[i], rtttlFiles[i]));
+  const char *binaryNames[] = {"Song one", "Song two", "Song three"};
+  for (int i = 0; i < NUM_SONGS; i++)
+    uploads.push_back(binaryUpload(songs[i], binaryNames[i], "tune.tun"));
+  uploads.push_back(binaryUpload(songs[0], "sixteen chars!!!", "x"));
+
+  int uploadsDone = 0;
+  for (const upload &u : uploads)
+  {
+    size_t len = u.data.size();
+    checkUpload(u, {}, "one chunk");
+    checkUpload(u, cutsEvery(1, len), "a byte per chunk");
+    for (size_t first = 1; first <= 4; first++)
+    {
+      std::string how = "first chunk " + std::to_string(first) + " bytes";
+      std::vector<size_t> cuts = cutsEvery(first, len);
+      cuts.resize(1);
+      checkUpload(u, cuts, how.c_str());
+    }
+    for (int r = 0; r < randomSplits; r++)
+      checkUpload(u, cutsRandom(len), "random chunks");
+    uploadsDone += 6 + randomSplits;
+  }
+
+  upload whole = uploads[4];
+  checkRefused("tune.tun", whole.data.substr(0, whole.data.size() - 1), "truncated tune");
+  checkRefused("tune.tun", whole.data.substr(0, sizeof(tuneheader) - 2), "truncated tune");
+  std::string badTempo = whole.data;
+  badTempo[4] = badTempo[5] = 0;
+  checkRefused("tune.tun", badTempo, "invalid header");
+  checkRefused("stray", "TUN", "invalid RTTTL");
+  checkRefused("text.txt", "hello, this is not a ringtone", "invalid RTTTL");
+
+  printf("%zu tunes, %d uploads in one chunk, bytewise, short first chunks and %d random splits each, %d of %d checks passed\n",
+         uploads.size(), uploadsDone, randomSplits, checks - failures, checks);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+Checks the time zone tables (tz.h, tzdata.h) against the tz database of the machine it runs
+on: for every zone the settings page offers, the offset tzOffset() gives against the one
+localtime_r() gives with TZ set to that zone.
+
+Build (from this folder):
+  g++ -std=c++11 -O2 -pthread -Ihost -I../src test_tz.cpp -o test_tz
+
+Usage:
+  test_tz [zoneinfo folder]
+
+Every hour from the start to the end of the tables is compared, and each DST change the
+system knows of is found to the second and compared one second either side, with the local
+wall clock too. A table built from a different tzdata than the system's can disagree where
+a country changed its rules in between, so the versions are printed first (gen_tz.py
+regenerates the tables). Exits with 1 on any difference.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Arduino.h>
+#include "tz.h"
+
+#define FROM 1704067200L // 2024-01-01 00:00 UTC, the first year of the tables
+#define TO 2556143999L   // 2050-12-31 23:59:59 UTC, the last
+
+// the system's offset for utc in the zone TZ is set to, s east of UTC
+long systemOffset(time_t utc)
+{
+  tm t;
+  localtime_r(&utc, &t);
+  return t.tm_gmtoff;
+}
+
+int failures = 0;
+
+void fail(const tzzone &z, time_t utc, const char *what)
+{
+  if (failures++ < 20)
+  {
+    char when[32];
+    tm t;
+    gmtime_r(&utc, &t);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &t);
+    printf("FAIL %s at %s UTC: %s, table %+d min, system %+ld min\n", z.name, when, what, tzOffset(utc) / 60, systemOffset(utc) / 60);
+  }
+}
+
+// local wall clock both ways, as the display would show it
+void checkWall(const tzzone &z, time_t utc)
+{
+  time_t local = tzLocal(utc);
+  tm ours, sys;
+  gmtime_r(&local, &ours);
+  localtime_r(&utc, &sys);
+  if (ours.tm_year != sys.tm_year || ours.tm_yday != sys.tm_yday || ours.tm_hour != sys.tm_hour || ours.tm_min != sys.tm_min || ours.tm_sec != sys.tm_sec)
+    fail(z, utc, "local time differs");
+}
+
+int main(int argc, char **argv)
+{
+  const char *zoneinfo = argc > 1 ? argv[1] : "/usr/share/zoneinfo";
+  char path[256], version[64] = "unknown";
+  snprintf(path, sizeof(path), "%s/tzdata.zi", zoneinfo);
+  FILE *f = fopen(path, "r");
+  if (f)
+  {
+    if (fscanf(f, "# version %63s", version) != 1)
+      strcpy(version, "unknown");
+    fclose(f);
+  }
+  char tables[64] = "unknown";
+  f = fopen("../src/tzdata.h", "r");
+  if (f)
+  {
+    if (fscanf(f, "// generated by tools/gen_tz.py from tzdata %63s", tables) == 1)
+      tables[strcspn(tables, ",")] = 0;
+    fclose(f);
+  }
+  printf("tables from tzdata %s, system tzdata %s\n", tables, version);
+
+  long hours = 0, changes = 0;
+  for (size_t i = 0; i < TZ_ZONES; i++)
+  {
+    const tzzone &z = tzZones[i];
+    snprintf(path, sizeof(path), "%s/%s", zoneinfo, z.name);
+    FILE *zf = fopen(path, "r");
+    if (!zf)
+    {
+      printf("FAIL %s: not in %s\n", z.name, zoneinfo);
+      failures++;
+      continue;
+    }
+    fclose(zf);
+    setenv("TZ", path, 1);
+    tzset();
+    tzZone = &z;
+
+    int zoneChanges = 0;
+    long prev = systemOffset(FROM);
+    for (time_t t = FROM; t <= TO; t += 3600)
+    {
+      hours++;
+      long now = systemOffset(t);
+      if (tzOffset(t) != now)
+        fail(z, t, "offset differs");
+      if (now != prev)
+      {
+        // the exact second, the first one with the new offset is in (t - 3600, t]
+        time_t lo = t - 3600, hi = t;
+        while (hi - lo > 1)
+        {
+          time_t mid = lo + (hi - lo) / 2;
+          (systemOffset(mid) == now ? hi : lo) = mid;
+        }
+        for (time_t s = hi - 1; s <= hi; s++)
+        {
+          if (tzOffset(s) != systemOffset(s))
+            fail(z, s, "offset differs around a change");
+          checkWall(z, s);
+        }
+        zoneChanges++;
+      }
+      prev = now;
+    }
+    // the table shouldn't have changes the system doesn't
+    if (zoneChanges != z.count - 1)
+    {
+      char what[64];
+      snprintf(what, sizeof(what), "%d changes in the table, %d in the system", z.count - 1, zoneChanges);
+      fail(z, FROM, what);
+    }
+    changes += zoneChanges;
+  }
+  printf("%zu zones, %ld hours and %ld offset changes compared\n", TZ_ZONES, hours, changes);
+
+  if (failures)
+    printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}